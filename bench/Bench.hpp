@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+namespace prsl::Bench {
+
+// Keeps the compiler from optimizing away a computed value
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs the body once and returns the time in nanoseconds
+template <typename F> double measureOnce(F &&body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Runs the body several times and returns the best time in nanoseconds
+template <typename F> double measure(F &&body) {
+  constexpr int repetitions = 5;
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repetitions; ++i)
+    best = std::min(best, measureOnce(body));
+  return best;
+}
+
+// Prints the best time per operation
+template <typename F>
+void run(const std::string &name, size_t operations, F &&body) {
+  double best = measure(body);
+  std::printf("%-44s %10.3f ns/op\n", name.c_str(), best / operations);
+}
+
+// Prints the best throughput of a body processing the given number of bytes
+template <typename F>
+void runThroughput(const std::string &name, size_t bytes, F &&body) {
+  double best = measure(body);
+  std::printf("%-44s %10.1f MB/s\n", name.c_str(), bytes * 1e3 / best);
+}
+
+// Functions with loops, conditions, long names, numbers and both kinds of
+// comments, as generated scripts have them
+inline std::string makeProgram(size_t functions) {
+  std::string source;
+  for (size_t i = 0; i != functions; ++i) {
+    auto n = std::to_string(i);
+    source += "/* Accumulates the values of series " + n +
+              "\n   until the counter runs out */\n"
+              "accumulateSeries" + n + " = func(counter, accumulator) : "
+              "series" + n + " {\n"
+              "  while (counter > 0) {\n"
+              "    // Every step adds the square of the counter\n"
+              "    accumulator = accumulator + counter * counter + " + n +
+              ";\n"
+              "    if (accumulator >= 1000000007)\n"
+              "      accumulator = accumulator - 1000000007;\n"
+              "    counter = counter - 1;\n"
+              "  }\n"
+              "  return accumulator;\n"
+              "}\n"
+              "print accumulateSeries" + n + "(?, 12345);\n\n";
+  }
+  return source;
+}
+
+} // namespace prsl::Bench
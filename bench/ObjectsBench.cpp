@@ -0,0 +1,102 @@
+// Compares the tagged PrslObject with the std::variant representation it
+// replaced, on the operations the interpreter performs most: copying values
+// in and out of frames and int arithmetic with type checks
+
+#include "bench/Bench.hpp"
+#include "prsl/Compiler/Interpreter/Objects.hpp"
+
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using prsl::Interpreter::PrslObject;
+
+struct LegacyFuncObj {
+  int paramsCount;
+};
+
+using LegacyObject = std::variant<int, bool, std::nullptr_t,
+                                  std::shared_ptr<LegacyFuncObj>>;
+
+constexpr size_t valuesCount = 1 << 16;
+constexpr int rounds = 64;
+
+template <typename Object, typename MakeFunc>
+std::vector<Object> makeValues(MakeFunc makeFunc) {
+  std::vector<Object> values;
+  values.reserve(valuesCount);
+  for (size_t i = 0; i < valuesCount; ++i) {
+    // Every 16th value is a function, as when frames hold callables
+    if (i % 16 == 0)
+      values.push_back(makeFunc());
+    else
+      values.push_back(static_cast<int>(i));
+  }
+  return values;
+}
+
+template <typename Object>
+void benchCopy(const std::string &name, const std::vector<Object> &values) {
+  std::vector<Object> copies(values.size());
+  prsl::Bench::run(name, valuesCount * rounds, [&] {
+    for (int round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < values.size(); ++i)
+        copies[i] = values[i];
+      prsl::Bench::doNotOptimize(copies.data());
+    }
+  });
+}
+
+void benchLegacyAdd(const std::vector<LegacyObject> &values) {
+  std::vector<LegacyObject> sums(values.size());
+  prsl::Bench::run("add, std::variant", valuesCount * rounds, [&] {
+    for (int round = 0; round < rounds; ++round) {
+      for (size_t i = 1; i < values.size(); ++i) {
+        const auto &lhs = values[i - 1];
+        const auto &rhs = values[i];
+        if (std::holds_alternative<int>(lhs) &&
+            std::holds_alternative<int>(rhs))
+          sums[i] = std::get<int>(lhs) + std::get<int>(rhs);
+        else
+          sums[i] = nullptr;
+      }
+      prsl::Bench::doNotOptimize(sums.data());
+    }
+  });
+}
+
+void benchTaggedAdd(const std::vector<PrslObject> &values) {
+  std::vector<PrslObject> sums(values.size());
+  prsl::Bench::run("add, tagged PrslObject", valuesCount * rounds, [&] {
+    for (int round = 0; round < rounds; ++round) {
+      for (size_t i = 1; i < values.size(); ++i) {
+        auto lhs = values[i - 1];
+        auto rhs = values[i];
+        if (bothInts(lhs, rhs))
+          sums[i] = lhs.asInt() + rhs.asInt();
+        else
+          sums[i] = nullptr;
+      }
+      prsl::Bench::doNotOptimize(sums.data());
+    }
+  });
+}
+
+} // namespace
+
+int main() {
+  std::printf("sizeof: std::variant %zu bytes, tagged PrslObject %zu bytes\n",
+              sizeof(LegacyObject), sizeof(PrslObject));
+
+  auto function = std::make_shared<LegacyFuncObj>(LegacyFuncObj{1});
+  auto legacy = makeValues<LegacyObject>([&] { return function; });
+  auto tagged =
+      makeValues<PrslObject>([] { return PrslObject::function(0); });
+
+  benchCopy("copy, std::variant", legacy);
+  benchCopy("copy, tagged PrslObject", tagged);
+  benchLegacyAdd(legacy);
+  benchTaggedAdd(tagged);
+}
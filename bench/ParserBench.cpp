@@ -0,0 +1,113 @@
+// Parses a generated program of a few megabytes and measures the time, the
+// heap allocations and the peak heap size it takes to build and free the AST
+
+#include "bench/Bench.hpp"
+#include "prsl/Debug/Logger.hpp"
+#include "prsl/Parser/Parser.hpp"
+#include "prsl/Parser/Scanner.hpp"
+#include "prsl/Parser/TokenStream.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <string>
+
+namespace {
+
+// Heap usage of the whole program. Blocks are counted with the space malloc
+// keeps in front of them
+struct HeapStats {
+  size_t allocations{0};
+  size_t live{0};
+  size_t peak{0};
+};
+HeapStats heap;
+
+size_t footprint(void *ptr) { return malloc_usable_size(ptr) + sizeof(size_t); }
+
+void *allocate(size_t size) {
+  void *ptr = std::malloc(size);
+  if (!ptr)
+    throw std::bad_alloc{};
+  ++heap.allocations;
+  heap.live += footprint(ptr);
+  heap.peak = std::max(heap.peak, heap.live);
+  return ptr;
+}
+
+void deallocate(void *ptr) {
+  if (!ptr)
+    return;
+  heap.live -= footprint(ptr);
+  std::free(ptr);
+}
+
+// The AST and the arena it is in
+struct Program {
+  std::unique_ptr<prsl::AST::Arena> arena;
+  prsl::AST::StmtPtrVariant ast;
+};
+
+Program parse(const std::string &source, prsl::Errors::Logger &logger) {
+  auto arena = std::make_unique<prsl::AST::Arena>();
+  prsl::Scanner::Scanner scanner(source);
+  prsl::Parser::Parser parser(prsl::Parser::TokenStream(scanner), *arena,
+                              logger);
+  auto ast = parser.parse();
+  return {std::move(arena), std::move(ast)};
+}
+
+// Additions of a thousand terms each, which nest as deep in the AST
+std::string makeChains(size_t count) {
+  std::string source;
+  for (size_t i = 0; i != count; ++i) {
+    source += "x = 1";
+    for (int j = 0; j != 1000; ++j)
+      source += " + 1";
+    source += ";\n";
+  }
+  return source;
+}
+
+void bench(const std::string &name, const std::string &source) {
+  prsl::Errors::Logger logger(prsl::Errors::LogLevel::QUIET, std::cerr);
+  prsl::Bench::runThroughput("parse and free, " + name, source.size(),
+                             [&] { parse(source, logger); });
+
+  double teardown = std::numeric_limits<double>::max();
+  for (int i = 0; i != 5; ++i) {
+    auto ast = parse(source, logger);
+    teardown = std::min(teardown, prsl::Bench::measureOnce([&] {
+      auto freed = std::move(ast);
+    }));
+  }
+  std::printf("%-44s %10.3f ms\n", ("free, " + name).c_str(), teardown / 1e6);
+
+  auto before = heap;
+  heap.peak = heap.live;
+  {
+    auto ast = parse(source, logger);
+    prsl::Bench::doNotOptimize(ast.ast);
+  }
+  std::printf("%-44s %10zu allocations, %.1f MB peak\n",
+              ("heap, " + name).c_str(), heap.allocations - before.allocations,
+              (heap.peak - before.live) / 1e6);
+}
+
+} // namespace
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { deallocate(ptr); }
+
+int main() {
+  bench("functions", prsl::Bench::makeProgram(20000));
+  bench("long additions", makeChains(2000));
+}
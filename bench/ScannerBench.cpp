@@ -0,0 +1,282 @@
+// Compares the scanner with the one it replaced, which went one character at
+// a time through std::isalnum, looked keywords up in an unordered_map,
+// skipped comments by recursion and kept lines and columns in every token,
+// and with the parallel one, on a generated program of a few megabytes
+
+#include "bench/Bench.hpp"
+#include "prsl/Parser/ParallelScanner.hpp"
+#include "prsl/Parser/Scanner.hpp"
+#include "prsl/Parser/TokenStream.hpp"
+#include "prsl/Utils/Utils.hpp"
+
+#include <llvm/Support/Threading.h>
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using prsl::Types::Token;
+
+// Tokens as they were, with the positions of both ends
+struct LegacyToken {
+  Token::Type type;
+  std::string_view lexeme;
+  prsl::Utils::FilePos s_pos, e_pos;
+
+  Token::Type getType() const { return type; }
+};
+
+class LegacyScanner {
+public:
+  explicit LegacyScanner(std::string_view filename, std::string_view source)
+      : start(source.data()), current(source.data()), filename(filename) {}
+
+  std::vector<LegacyToken> tokenize() {
+    std::vector<LegacyToken> tokens;
+    while (!isEOL())
+      tokens.emplace_back(tokenizeOne());
+    auto eof_pos = prsl::Utils::FilePos::UNKNOWN(filename);
+    tokens.push_back({Token::Type::EOF_, "", eof_pos, eof_pos});
+    return tokens;
+  }
+
+  LegacyToken tokenizeOne() {
+    skipWhitespace();
+    start = current;
+    if (isEOL())
+      return makeToken(Token::Type::EOF_);
+
+    char c = advance();
+    switch (c) {
+    case '=':
+      return makeToken(match('=') ? Token::Type::EQUAL_EQUAL
+                                  : Token::Type::EQUAL);
+    case ',':
+      return makeToken(Token::Type::COMMA);
+    case ':':
+      return makeToken(Token::Type::COLON);
+    case ';':
+      return makeToken(Token::Type::SEMICOLON);
+    case '(':
+      return makeToken(Token::Type::LEFT_PAREN);
+    case ')':
+      return makeToken(Token::Type::RIGHT_PAREN);
+    case '+':
+      return makeToken(match('+') ? Token::Type::PLUS_PLUS
+                                  : Token::Type::PLUS);
+    case '-':
+      return makeToken(match('-') ? Token::Type::MINUS_MINUS
+                                  : Token::Type::MINUS);
+    case '*':
+      return makeToken(Token::Type::STAR);
+    case '/':
+      if (match('/')) {
+        while (peek() != '\n' && !isEOL())
+          advance();
+      } else if (match('*')) {
+        while (!(peek() == '*' && peekNext() == '/') && !isEOL()) {
+          if (peek() == '\n')
+            line++;
+          advance();
+        }
+        if (isEOL())
+          return makeError("Multiline comment has no termination");
+        advance();
+        advance();
+      } else {
+        return makeToken(Token::Type::SLASH);
+      }
+      return tokenizeOne();
+    case '>':
+      return makeToken(match('=') ? Token::Type::GREATER_EQUAL
+                                  : Token::Type::GREATER);
+    case '<':
+      return makeToken(match('=') ? Token::Type::LESS_EQUAL
+                                  : Token::Type::LESS);
+    case '!':
+      if (match('='))
+        return makeToken(Token::Type::NOT_EQUAL);
+      return makeError("Expect '=' sign");
+    case '{':
+      return makeToken(Token::Type::LEFT_BRACE);
+    case '}':
+      return makeToken(Token::Type::RIGHT_BRACE);
+    case '?':
+      return makeToken(Token::Type::INPUT);
+    default:
+      if (std::isalpha(c))
+        return ident();
+      if (std::isdigit(c) && !(c == '0' && std::isdigit(peekNext())))
+        return number();
+      return makeError("Unknown character");
+    }
+  }
+
+private:
+  LegacyToken ident() {
+    while (std::isalnum(peek()))
+      advance();
+    std::string_view view = {start, static_cast<size_t>(current - start)};
+    auto it = keywords.find(view);
+    if (it == keywords.end())
+      return makeToken(Token::Type::IDENT);
+    return makeToken(it->second);
+  }
+
+  LegacyToken number() {
+    while (std::isdigit(peek()))
+      advance();
+    return makeToken(Token::Type::NUMBER);
+  }
+
+  bool isEOL() { return *current == '\0'; }
+  char advance() {
+    col += 1;
+    return *(current++);
+  }
+  char peek() { return *current; }
+  char peekNext() { return isEOL() ? '\0' : current[1]; }
+  bool match(char expect) {
+    if (isEOL() || peek() != expect)
+      return false;
+    advance();
+    return true;
+  }
+
+  void skipWhitespace() {
+    for (;;) {
+      switch (peek()) {
+      case ' ':
+      case '\r':
+      case '\t':
+        advance();
+        break;
+      case '\n':
+        line++;
+        col = 0;
+        advance();
+        break;
+      default:
+        return;
+      }
+    }
+  }
+
+  LegacyToken makeToken(Token::Type type) {
+    size_t tokenLength = static_cast<size_t>(current - start);
+    auto s_pos = prsl::Utils::FilePos{filename, line,
+                                      static_cast<int>(col - tokenLength)};
+    auto e_pos = prsl::Utils::FilePos{filename, line, col};
+    return {type, std::string_view{start, tokenLength}, s_pos, e_pos};
+  }
+
+  LegacyToken makeError(std::string_view message) const {
+    auto pos = prsl::Utils::FilePos{filename, line, col};
+    return {Token::Type::ERROR, message, pos, pos};
+  }
+
+  const char *start;
+  const char *current;
+  std::string_view filename;
+  int line{1}, col{-1};
+
+  std::unordered_map<std::string_view, Token::Type> keywords = {
+      {"if", Token::Type::IF},       {"else", Token::Type::ELSE},
+      {"while", Token::Type::WHILE}, {"print", Token::Type::PRINT},
+      {"func", Token::Type::FUNC},   {"return", Token::Type::RETURN}};
+};
+
+// Scanning alone, and with the tokens collected as the compiler did
+template <typename Scanner, typename... Args>
+void benchScanner(const std::string &name, const std::string &source,
+                  Args... args) {
+  prsl::Bench::runThroughput("scan, " + name, source.size(), [&] {
+    Scanner scanner(args..., source);
+    size_t count = 0;
+    while (scanner.tokenizeOne().getType() != Token::Type::EOF_)
+      ++count;
+    prsl::Bench::doNotOptimize(count);
+  });
+  prsl::Bench::runThroughput("tokenize, " + name, source.size(), [&] {
+    Scanner scanner(args..., source);
+    auto tokens = scanner.tokenize();
+    prsl::Bench::doNotOptimize(tokens.data());
+  });
+}
+
+// Both scanners have to agree on the tokens, positions aside. The legacy one
+// also returned an EOF after trailing whitespace
+bool sameTokens(const std::string &source) {
+  auto legacy = LegacyScanner("bench.prsl", source).tokenize();
+  std::erase_if(legacy, [](const LegacyToken &token) {
+    return token.type == Token::Type::EOF_;
+  });
+  auto tokens = prsl::Scanner::Scanner(source).tokenize();
+  tokens.pop_back();
+  return std::equal(legacy.begin(), legacy.end(), tokens.begin(),
+                    tokens.end(), [](const LegacyToken &lhs, const Token &rhs) {
+                      return lhs.type == rhs.getType() &&
+                             lhs.lexeme == rhs.getLexeme();
+                    });
+}
+
+// Parallel scanning has to give exactly the same tokens
+bool sameAsParallel(const std::string &source, unsigned threads) {
+  auto tokens = prsl::Scanner::Scanner(source).tokenize();
+  auto parallel = prsl::Scanner::tokenizeParallel(source, threads);
+  return std::equal(tokens.begin(), tokens.end(), parallel.begin(),
+                    parallel.end(), [](const Token &lhs, const Token &rhs) {
+                      return lhs.getType() == rhs.getType() &&
+                             lhs.getLexeme() == rhs.getLexeme() &&
+                             lhs.getLocation() == rhs.getLocation();
+                    });
+}
+
+} // namespace
+
+int main() {
+  // Sources are followed by the NUL of the string
+  auto source = prsl::Bench::makeProgram(20000);
+  std::printf("source: %.1f MB, %zu tokens\n", source.size() / 1e6,
+              prsl::Scanner::Scanner(source).tokenize().size());
+  // Comments around every line end put the parts inside of them
+  auto commented = "/*\n" + source + "*/";
+  if (!sameTokens(source)) {
+    std::printf("scanners disagree on the tokens\n");
+    return 1;
+  }
+  for (unsigned threads : {2, 3, 8, 61}) {
+    if (!sameAsParallel(source, threads) ||
+        !sameAsParallel(commented, threads)) {
+      std::printf("parallel scanning on %u threads gives other tokens\n",
+                  threads);
+      return 1;
+    }
+  }
+
+  benchScanner<LegacyScanner>("char at a time", source, "bench.prsl");
+  benchScanner<prsl::Scanner::Scanner>("character class masks", source);
+
+  // Tokens as the parser pulls them, without the vector of all of them
+  prsl::Bench::runThroughput("stream", source.size(), [&] {
+    prsl::Scanner::Scanner scanner(source);
+    prsl::Parser::TokenStream tokens(scanner);
+    size_t count = 0;
+    for (; tokens.peek().getType() != Token::Type::EOF_; tokens.advance())
+      ++count;
+    prsl::Bench::doNotOptimize(count);
+  });
+
+  unsigned threads = llvm::hardware_concurrency().compute_thread_count();
+  prsl::Bench::runThroughput(
+      "tokenize, " + std::to_string(threads) + " threads", source.size(),
+      [&] {
+        auto tokens = prsl::Scanner::tokenizeParallel(source, threads);
+        prsl::Bench::doNotOptimize(tokens.data());
+      });
+}
@@ -0,0 +1,388 @@
+// Compares visitors dispatching to their handlers at compile time with the
+// ones they replaced, which called a virtual function for every node, on
+// parsed programs and on arithmetic expressions of both small and large size
+
+#include "bench/Bench.hpp"
+#include "prsl/AST/ASTVisitor.hpp"
+#include "prsl/AST/Arena.hpp"
+#include "prsl/AST/TreeWalkerVisitor.hpp"
+#include "prsl/Debug/Logger.hpp"
+#include "prsl/Parser/Parser.hpp"
+#include "prsl/Parser/Scanner.hpp"
+#include "prsl/Parser/TokenStream.hpp"
+#include "prsl/Utils/Utils.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using namespace prsl::AST;
+using prsl::Types::Token;
+
+namespace Legacy {
+
+// The visitors as they were
+template <typename ExprVisitRes = void, typename StmtVisitRes = void>
+class ASTVisitor {
+public:
+  ExprVisitRes visitExpr(const ExprPtrVariant &expr) {
+    return std::visit<ExprVisitRes>(
+        prsl::Utils::select{
+            [&](const LiteralExprPtr &expr) { return visitLiteralExpr(expr); },
+            [&](const GroupingExprPtr &expr) {
+              return visitGroupingExpr(expr);
+            },
+            [&](const VarExprPtr &expr) { return visitVarExpr(expr); },
+            [&](const InputExprPtr &expr) { return visitInputExpr(expr); },
+            [&](const AssignmentExprPtr &expr) {
+              return visitAssignmentExpr(expr);
+            },
+            [&](const UnaryExprPtr &expr) { return visitUnaryExpr(expr); },
+            [&](const BinaryExprPtr &expr) { return visitBinaryExpr(expr); },
+            [&](const PostfixExprPtr &expr) { return visitPostfixExpr(expr); },
+            [&](const ScopeExprPtr &expr) { return visitScopeExpr(expr); },
+            [&](const FuncExprPtr &expr) { return visitFuncExpr(expr); },
+            [&](const CallExprPtr &expr) { return visitCallExpr(expr); }},
+        expr);
+  }
+  StmtVisitRes visitStmt(const StmtPtrVariant &stmt) {
+    return std::visit<StmtVisitRes>(
+        prsl::Utils::select{
+            [&](const VarStmtPtr &stmt) { return visitVarStmt(stmt); },
+            [&](const IfStmtPtr &stmt) { return visitIfStmt(stmt); },
+            [&](const WhileStmtPtr &stmt) { return visitWhileStmt(stmt); },
+            [&](const PrintStmtPtr &stmt) { return visitPrintStmt(stmt); },
+            [&](const ExprStmtPtr &stmt) { return visitExprStmt(stmt); },
+            [&](const FunctionStmtPtr &stmt) {
+              return visitFunctionStmt(stmt);
+            },
+            [&](const BlockStmtPtr &stmt) { return visitBlockStmt(stmt); },
+            [&](const ReturnStmtPtr &stmt) { return visitReturnStmt(stmt); },
+            [&](const NullStmtPtr &stmt) { return visitNullStmt(stmt); }},
+        stmt);
+  }
+
+protected:
+  virtual ExprVisitRes visitLiteralExpr(const LiteralExprPtr &expr) = 0;
+  virtual ExprVisitRes visitGroupingExpr(const GroupingExprPtr &expr) = 0;
+  virtual ExprVisitRes visitVarExpr(const VarExprPtr &expr) = 0;
+  virtual ExprVisitRes visitInputExpr(const InputExprPtr &expr) = 0;
+  virtual ExprVisitRes visitAssignmentExpr(const AssignmentExprPtr &expr) = 0;
+  virtual ExprVisitRes visitUnaryExpr(const UnaryExprPtr &expr) = 0;
+  virtual ExprVisitRes visitBinaryExpr(const BinaryExprPtr &expr) = 0;
+  virtual ExprVisitRes visitPostfixExpr(const PostfixExprPtr &expr) = 0;
+  virtual ExprVisitRes visitScopeExpr(const ScopeExprPtr &expr) = 0;
+  virtual ExprVisitRes visitFuncExpr(const FuncExprPtr &expr) = 0;
+  virtual ExprVisitRes visitCallExpr(const CallExprPtr &expr) = 0;
+
+  virtual StmtVisitRes visitVarStmt(const VarStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitIfStmt(const IfStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitWhileStmt(const WhileStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitPrintStmt(const PrintStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitExprStmt(const ExprStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitFunctionStmt(const FunctionStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitBlockStmt(const BlockStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitReturnStmt(const ReturnStmtPtr &stmt) = 0;
+  virtual StmtVisitRes visitNullStmt(const NullStmtPtr &stmt) = 0;
+};
+
+class TreeWalkerVisitor : public ASTVisitor<> {
+public:
+  virtual void visitLiteralExpr(const LiteralExprPtr &expr) override {}
+
+  virtual void visitGroupingExpr(const GroupingExprPtr &expr) override {
+    visitExpr(expr->expression);
+  }
+
+  virtual void visitVarExpr(const VarExprPtr &expr) override {}
+
+  virtual void visitInputExpr(const InputExprPtr &expr) override {}
+
+  virtual void visitAssignmentExpr(const AssignmentExprPtr &expr) override {
+    visitExpr(expr->initializer);
+  }
+
+  virtual void visitUnaryExpr(const UnaryExprPtr &expr) override {
+    visitExpr(expr->expression);
+  }
+
+  virtual void visitBinaryExpr(const BinaryExprPtr &expr) override {
+    visitExpr(expr->lhsExpression);
+    visitExpr(expr->rhsExpression);
+  }
+
+  virtual void visitPostfixExpr(const PostfixExprPtr &expr) override {
+    visitExpr(expr->expression);
+  }
+
+  virtual void visitScopeExpr(const ScopeExprPtr &expr) override {
+    for (const auto &stmt : expr->statements)
+      visitStmt(stmt);
+  }
+
+  virtual void visitFuncExpr(const FuncExprPtr &expr) override {
+    visitScopeExpr(std::get<ScopeExprPtr>(expr->body));
+  }
+
+  virtual void visitCallExpr(const CallExprPtr &expr) override {
+    for (const auto &arg : expr->arguments)
+      visitExpr(arg);
+  }
+
+  virtual void visitVarStmt(const VarStmtPtr &stmt) override {
+    visitExpr(stmt->initializer);
+  }
+
+  virtual void visitIfStmt(const IfStmtPtr &stmt) override {
+    visitExpr(stmt->condition);
+    visitStmt(stmt->thenBranch);
+    if (stmt->elseBranch)
+      visitStmt(*stmt->elseBranch);
+  }
+
+  virtual void visitWhileStmt(const WhileStmtPtr &stmt) override {
+    visitExpr(stmt->condition);
+    visitStmt(stmt->body);
+  }
+
+  virtual void visitPrintStmt(const PrintStmtPtr &stmt) override {
+    visitExpr(stmt->value);
+  }
+
+  virtual void visitExprStmt(const ExprStmtPtr &stmt) override {
+    visitExpr(stmt->expression);
+  }
+
+  virtual void visitFunctionStmt(const FunctionStmtPtr &stmt) override {
+    for (const auto &stmt : stmt->body)
+      visitStmt(stmt);
+  }
+
+  virtual void visitBlockStmt(const BlockStmtPtr &stmt) override {
+    for (const auto &stmt : stmt->statements)
+      visitStmt(stmt);
+  }
+
+  virtual void visitReturnStmt(const ReturnStmtPtr &stmt) override {
+    visitExpr(stmt->retValue);
+  }
+
+  virtual void visitNullStmt(const NullStmtPtr &stmt) override {}
+};
+
+} // namespace Legacy
+
+// Counts the names and numbers of a program, as the passes over the whole
+// AST look at a few kinds of nodes and walk through the rest
+class LegacyCounter : public Legacy::TreeWalkerVisitor {
+public:
+  size_t count{0};
+
+  void visitLiteralExpr(const LiteralExprPtr &expr) override { ++count; }
+  void visitVarExpr(const VarExprPtr &expr) override { ++count; }
+};
+
+class Counter : public TreeWalkerVisitor<Counter> {
+public:
+  size_t count{0};
+
+  void visitLiteralExpr(const LiteralExprPtr &expr) { ++count; }
+  void visitVarExpr(const VarExprPtr &expr) { ++count; }
+};
+
+// Evaluates arithmetic as the interpreter does, a value for every node
+int32_t apply(const Token &op, int32_t lhs, int32_t rhs) {
+  auto res = static_cast<uint32_t>(lhs);
+  switch (op.getType()) {
+  case Token::Type::PLUS:
+    res += static_cast<uint32_t>(rhs);
+    break;
+  case Token::Type::MINUS:
+    res -= static_cast<uint32_t>(rhs);
+    break;
+  default:
+    res *= static_cast<uint32_t>(rhs);
+    break;
+  }
+  return static_cast<int32_t>(res);
+}
+
+int32_t negate(int32_t value) {
+  return static_cast<int32_t>(0u - static_cast<uint32_t>(value));
+}
+
+class LegacyEvaluator : public Legacy::ASTVisitor<int32_t> {
+public:
+  int32_t visitLiteralExpr(const LiteralExprPtr &expr) override {
+    return expr->literalVal;
+  }
+  int32_t visitGroupingExpr(const GroupingExprPtr &expr) override {
+    return visitExpr(expr->expression);
+  }
+  int32_t visitUnaryExpr(const UnaryExprPtr &expr) override {
+    return negate(visitExpr(expr->expression));
+  }
+  int32_t visitBinaryExpr(const BinaryExprPtr &expr) override {
+    return apply(expr->op, visitExpr(expr->lhsExpression),
+                 visitExpr(expr->rhsExpression));
+  }
+  int32_t visitVarExpr(const VarExprPtr &expr) override { return 0; }
+  int32_t visitInputExpr(const InputExprPtr &expr) override { return 0; }
+  int32_t visitAssignmentExpr(const AssignmentExprPtr &expr) override {
+    return 0;
+  }
+  int32_t visitPostfixExpr(const PostfixExprPtr &expr) override { return 0; }
+  int32_t visitScopeExpr(const ScopeExprPtr &expr) override { return 0; }
+  int32_t visitFuncExpr(const FuncExprPtr &expr) override { return 0; }
+  int32_t visitCallExpr(const CallExprPtr &expr) override { return 0; }
+
+  void visitVarStmt(const VarStmtPtr &stmt) override {}
+  void visitIfStmt(const IfStmtPtr &stmt) override {}
+  void visitWhileStmt(const WhileStmtPtr &stmt) override {}
+  void visitPrintStmt(const PrintStmtPtr &stmt) override {}
+  void visitExprStmt(const ExprStmtPtr &stmt) override {}
+  void visitFunctionStmt(const FunctionStmtPtr &stmt) override {}
+  void visitBlockStmt(const BlockStmtPtr &stmt) override {}
+  void visitReturnStmt(const ReturnStmtPtr &stmt) override {}
+  void visitNullStmt(const NullStmtPtr &stmt) override {}
+};
+
+class Evaluator : public ASTVisitor<Evaluator, int32_t> {
+public:
+  int32_t visitLiteralExpr(const LiteralExprPtr &expr) {
+    return expr->literalVal;
+  }
+  int32_t visitGroupingExpr(const GroupingExprPtr &expr) {
+    return visitExpr(expr->expression);
+  }
+  int32_t visitUnaryExpr(const UnaryExprPtr &expr) {
+    return negate(visitExpr(expr->expression));
+  }
+  int32_t visitBinaryExpr(const BinaryExprPtr &expr) {
+    return apply(expr->op, visitExpr(expr->lhsExpression),
+                 visitExpr(expr->rhsExpression));
+  }
+  int32_t visitVarExpr(const VarExprPtr &expr) { return 0; }
+  int32_t visitInputExpr(const InputExprPtr &expr) { return 0; }
+  int32_t visitAssignmentExpr(const AssignmentExprPtr &expr) { return 0; }
+  int32_t visitPostfixExpr(const PostfixExprPtr &expr) { return 0; }
+  int32_t visitScopeExpr(const ScopeExprPtr &expr) { return 0; }
+  int32_t visitFuncExpr(const FuncExprPtr &expr) { return 0; }
+  int32_t visitCallExpr(const CallExprPtr &expr) { return 0; }
+
+  void visitVarStmt(const VarStmtPtr &stmt) {}
+  void visitIfStmt(const IfStmtPtr &stmt) {}
+  void visitWhileStmt(const WhileStmtPtr &stmt) {}
+  void visitPrintStmt(const PrintStmtPtr &stmt) {}
+  void visitExprStmt(const ExprStmtPtr &stmt) {}
+  void visitFunctionStmt(const FunctionStmtPtr &stmt) {}
+  void visitBlockStmt(const BlockStmtPtr &stmt) {}
+  void visitReturnStmt(const ReturnStmtPtr &stmt) {}
+  void visitNullStmt(const NullStmtPtr &stmt) {}
+};
+
+// A balanced tree of additions, subtractions and multiplications with the
+// given number of levels, some of its operands negated or parenthesized.
+// Counts the nodes it creates
+ExprPtrVariant makeExpression(Arena &arena, int levels, unsigned &seed,
+                              size_t &nodes) {
+  seed = seed * 1103515245 + 12345;
+  ++nodes;
+  if (levels == 0)
+    return createLiteralEPV(arena, static_cast<int>(seed >> 16) % 100);
+  static constexpr Token::Type ops[] = {Token::Type::PLUS, Token::Type::MINUS,
+                                        Token::Type::STAR};
+  Token op{ops[(seed >> 16) % 3], ""};
+  auto lhs = makeExpression(arena, levels - 1, seed, nodes);
+  auto rhs = makeExpression(arena, levels - 1, seed, nodes);
+  auto res = createBinaryEPV(arena, std::move(lhs), op, std::move(rhs));
+  if (levels % 4 == 1 || levels % 4 == 3)
+    ++nodes;
+  if (levels % 4 == 1)
+    return createUnaryEPV(arena, std::move(res), {Token::Type::MINUS, ""});
+  if (levels % 4 == 3)
+    return createGroupingEPV(arena, std::move(res));
+  return res;
+}
+
+// Small trees are visited many times and stay in the cache, which shows the
+// cost of the dispatch. Large ones are bound by the loads of the nodes
+constexpr size_t visitedNodes = 4000000;
+
+template <typename Visitor>
+void benchWalk(const std::string &name, const StmtPtrVariant &ast,
+               size_t names) {
+  size_t repetitions = visitedNodes / names + 1;
+  prsl::Bench::run("walk, " + name, names * repetitions, [&] {
+    for (size_t i = 0; i != repetitions; ++i) {
+      Visitor counter;
+      counter.visitStmt(ast);
+      prsl::Bench::doNotOptimize(counter.count);
+    }
+  });
+}
+
+template <typename Visitor>
+void benchEvaluate(const std::string &name, const ExprPtrVariant &expr,
+                   size_t nodes) {
+  size_t repetitions = visitedNodes / nodes + 1;
+  prsl::Bench::run("evaluate, " + name, nodes * repetitions, [&] {
+    for (size_t i = 0; i != repetitions; ++i) {
+      Visitor evaluator;
+      prsl::Bench::doNotOptimize(evaluator.visitExpr(expr));
+    }
+  });
+}
+
+// Times are given per name or number, the rest of the nodes are about as
+// many again
+bool benchWalks(size_t functions, prsl::Errors::Logger &logger) {
+  auto source = prsl::Bench::makeProgram(functions);
+  Arena arena;
+  prsl::Scanner::Scanner scanner(source);
+  prsl::Parser::Parser parser(prsl::Parser::TokenStream(scanner), arena,
+                              logger);
+  auto ast = parser.parse();
+
+  LegacyCounter legacyCounter;
+  legacyCounter.visitStmt(ast);
+  Counter counter;
+  counter.visitStmt(ast);
+  if (legacyCounter.count != counter.count) {
+    std::printf("visitors disagree on the number of nodes\n");
+    return false;
+  }
+  auto size = std::to_string(functions) + " functions";
+  benchWalk<LegacyCounter>("virtual, " + size, ast, counter.count);
+  benchWalk<Counter>("compile time, " + size, ast, counter.count);
+  return true;
+}
+
+bool benchEvaluations(int levels) {
+  Arena arena;
+  unsigned seed = 1;
+  size_t nodes = 0;
+  auto expr = makeExpression(arena, levels, seed, nodes);
+  if (LegacyEvaluator().visitExpr(expr) != Evaluator().visitExpr(expr)) {
+    std::printf("visitors disagree on the value\n");
+    return false;
+  }
+  auto size = std::to_string(nodes) + " nodes";
+  benchEvaluate<LegacyEvaluator>("virtual, " + size, expr, nodes);
+  benchEvaluate<Evaluator>("compile time, " + size, expr, nodes);
+  return true;
+}
+
+} // namespace
+
+int main() {
+  prsl::Errors::Logger logger(prsl::Errors::LogLevel::QUIET, std::cerr);
+  for (size_t functions : {20, 20000})
+    if (!benchWalks(functions, logger))
+      return 1;
+  for (int levels : {12, 20})
+    if (!benchEvaluations(levels))
+      return 1;
+}
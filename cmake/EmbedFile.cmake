@@ -0,0 +1,8 @@
+#
+# Write the bytes of INPUT to OUTPUT as a comma separated list, to be included into an array initializer
+# (i.e: cmake -DINPUT=file.bin -DOUTPUT=file.inc -P EmbedFile.cmake)
+#
+
+file(READ ${INPUT} content HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," content "${content}")
+file(WRITE ${OUTPUT} "${content}\n")
@@ -0,0 +1,30 @@
+#
+# Build prslrt, the runtime library of compiled programs. If clang is available, the library is also compiled to
+# bitcode and embedded into the target, so prsl can link it into the programs it compiles
+#
+
+function(add_runtime_target target)
+    add_library(prslrt STATIC prsl/Runtime/prslrt.c)
+    install(TARGETS prslrt)
+
+    if(NOT ${PROJECT_NAME}_RUNTIME_CLANG_BINARY)
+        # The bitcode has to be readable by the LLVM prsl is linked with, so the clang of the same installation is preferred
+        find_program(${PROJECT_NAME}_RUNTIME_CLANG_BINARY clang HINTS ${LLVM_TOOLS_BINARY_DIR})
+    endif()
+
+    if(${PROJECT_NAME}_RUNTIME_CLANG_BINARY)
+        add_custom_command(OUTPUT prslrt.bc
+                COMMAND ${${PROJECT_NAME}_RUNTIME_CLANG_BINARY}
+                -O2 -emit-llvm -c ${CMAKE_CURRENT_SOURCE_DIR}/prsl/Runtime/prslrt.c -o prslrt.bc
+                DEPENDS prsl/Runtime/prslrt.c)
+        add_custom_command(OUTPUT prslrt.bc.inc
+                COMMAND ${CMAKE_COMMAND} -DINPUT=prslrt.bc -DOUTPUT=prslrt.bc.inc
+                -P ${CMAKE_CURRENT_SOURCE_DIR}/cmake/EmbedFile.cmake
+                DEPENDS prslrt.bc cmake/EmbedFile.cmake)
+        target_sources(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR}/prslrt.bc.inc)
+        target_compile_definitions(${target} PRIVATE PRSL_RUNTIME_BITCODE)
+        message(STATUS "Link prslrt into compiled programs as bitcode compiled by ${${PROJECT_NAME}_RUNTIME_CLANG_BINARY}")
+    else()
+        message(STATUS "No clang found, compiled programs have to be linked with prslrt")
+    endif()
+endfunction()
@@ -0,0 +1,36 @@
+#include "prsl/AST/Arena.hpp"
+
+#include <cstdint>
+
+namespace prsl::AST {
+
+namespace {
+
+std::byte *alignUp(std::byte *pos, size_t alignment) {
+  auto address = reinterpret_cast<uintptr_t>(pos);
+  return pos + ((alignment - address % alignment) % alignment);
+}
+
+} // namespace
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+  std::byte *pos = current ? alignUp(current, alignment) : nullptr;
+  if (pos && static_cast<size_t>(end - pos) >= bytes) {
+    current = pos + bytes;
+    return pos;
+  }
+
+  // Large lists get blocks of their own, the current one stays in use
+  size_t size = bytes + alignment;
+  if (size > blockSize / 4) {
+    blocks.emplace_back(new std::byte[size]);
+    return alignUp(blocks.back().get(), alignment);
+  }
+  blocks.emplace_back(new std::byte[blockSize]);
+  pos = alignUp(blocks.back().get(), alignment);
+  current = pos + bytes;
+  end = blocks.back().get() + blockSize;
+  return pos;
+}
+
+} // namespace prsl::AST
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace prsl::AST {
+
+// Nodes are not freed one by one, their arena frees them all at once
+struct NodeDeleter {
+  constexpr void operator()(const void *) const noexcept {}
+};
+
+template <typename T> using NodePtr = std::unique_ptr<T, NodeDeleter>;
+
+// Lists of children, their elements are in the arena as well
+template <typename T> using List = std::pmr::vector<T>;
+
+// Bump pointer allocator owning all the nodes of a program. Destructors of
+// the nodes never run: everything they hold is in the arena, and is freed
+// with it in a few large blocks, however deep the tree is
+class Arena final : public std::pmr::memory_resource {
+public:
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  template <typename T, typename... Args> NodePtr<T> make(Args &&...args) {
+    void *memory = allocate(sizeof(T), alignof(T));
+    return NodePtr<T>(::new (memory) T(std::forward<Args>(args)...));
+  }
+
+  template <typename T> List<T> list() { return List<T>(this); }
+
+  // Moves the elements into the arena unless they are there already
+  template <typename T> List<T> adopt(List<T> list) {
+    return List<T>(std::move(list), this);
+  }
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  // Blocks are not grown geometrically, at most one of them is left unused
+  static constexpr size_t blockSize = 1 << 20;
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::byte *current{nullptr};
+  std::byte *end{nullptr};
+};
+
+} // namespace prsl::AST
@@ -4,41 +4,45 @@ namespace prsl::AST {
 
 constexpr LiteralExpr::LiteralExpr(int value) noexcept { literalVal = value; }
 
-ExprPtrVariant createLiteralEPV(int literalVal) {
-  return std::make_unique<LiteralExpr>(literalVal);
+ExprPtrVariant createLiteralEPV(Arena &arena, int literalVal) {
+  return arena.make<LiteralExpr>(literalVal);
 }
 
 constexpr GroupingExpr::GroupingExpr(ExprPtrVariant expression) noexcept
     : expression(std::move(expression)) {}
 
-ExprPtrVariant createGroupingEPV(ExprPtrVariant expression) {
-  return std::make_unique<GroupingExpr>(std::move(expression));
+ExprPtrVariant createGroupingEPV(Arena &arena, ExprPtrVariant expression) {
+  return arena.make<GroupingExpr>(std::move(expression));
 }
 
 constexpr VarExpr::VarExpr(Token ident) noexcept : ident(ident) {}
 
-ExprPtrVariant createVarEPV(Token ident) {
-  return std::make_unique<VarExpr>(ident);
+ExprPtrVariant createVarEPV(Arena &arena, Token ident) {
+  return arena.make<VarExpr>(ident);
 }
 
 constexpr InputExpr::InputExpr() noexcept {}
 
-ExprPtrVariant createInputEPV() { return std::make_unique<InputExpr>(); }
+ExprPtrVariant createInputEPV(Arena &arena) {
+  return arena.make<InputExpr>();
+}
 
 constexpr AssignmentExpr::AssignmentExpr(Token varName,
                                          ExprPtrVariant initializer) noexcept
     : varName(varName), initializer(std::move(initializer)) {}
 
-ExprPtrVariant createAssignmentEPV(Token varName, ExprPtrVariant initializer) {
-  return std::make_unique<AssignmentExpr>(varName, std::move(initializer));
+ExprPtrVariant createAssignmentEPV(Arena &arena, Token varName,
+                                   ExprPtrVariant initializer) {
+  return arena.make<AssignmentExpr>(varName, std::move(initializer));
 }
 
 constexpr UnaryExpr::UnaryExpr(ExprPtrVariant expression,
                                Types::Token op) noexcept
     : expression(std::move(expression)), op(op) {}
 
-ExprPtrVariant createUnaryEPV(ExprPtrVariant expression, Types::Token op) {
-  return std::make_unique<UnaryExpr>(std::move(expression), op);
+ExprPtrVariant createUnaryEPV(Arena &arena, ExprPtrVariant expression,
+                              Types::Token op) {
+  return arena.make<UnaryExpr>(std::move(expression), op);
 }
 
 constexpr BinaryExpr::BinaryExpr(ExprPtrVariant lhsExpression, Types::Token op,
@@ -46,52 +50,55 @@ constexpr BinaryExpr::BinaryExpr(ExprPtrVariant lhsExpression, Types::Token op,
     : lhsExpression(std::move(lhsExpression)), op(op),
       rhsExpression(std::move(rhsExpression)) {}
 
-ExprPtrVariant createBinaryEPV(ExprPtrVariant lhsExpression, Types::Token op,
-                               ExprPtrVariant rhsExpression) {
-  return std::make_unique<BinaryExpr>(std::move(lhsExpression), op,
-                                      std::move(rhsExpression));
+ExprPtrVariant createBinaryEPV(Arena &arena, ExprPtrVariant lhsExpression,
+                               Types::Token op, ExprPtrVariant rhsExpression) {
+  return arena.make<BinaryExpr>(std::move(lhsExpression), op,
+                                std::move(rhsExpression));
 }
 
 constexpr PostfixExpr::PostfixExpr(ExprPtrVariant expression,
                                    Types::Token op) noexcept
     : expression(std::move(expression)), op(op) {}
 
-ExprPtrVariant createPostfixEPV(ExprPtrVariant expression, Types::Token op) {
-  return std::make_unique<PostfixExpr>(std::move(expression), op);
+ExprPtrVariant createPostfixEPV(Arena &arena, ExprPtrVariant expression,
+                                Types::Token op) {
+  return arena.make<PostfixExpr>(std::move(expression), op);
 }
 
-constexpr ScopeExpr::ScopeExpr(std::vector<StmtPtrVariant> statements) noexcept
+ScopeExpr::ScopeExpr(List<StmtPtrVariant> statements) noexcept
     : statements(std::move(statements)) {}
 
-ExprPtrVariant createScopeEPV(std::vector<StmtPtrVariant> statements) {
-  return std::make_unique<ScopeExpr>(std::move(statements));
+ExprPtrVariant createScopeEPV(Arena &arena, List<StmtPtrVariant> statements) {
+  return arena.make<ScopeExpr>(arena.adopt(std::move(statements)));
 }
 
-constexpr FuncExpr::FuncExpr(Token token, std::optional<Token> name,
-                             std::vector<Token> parameters) noexcept
+FuncExpr::FuncExpr(Token token, std::optional<Token> name,
+                   List<Token> parameters) noexcept
     : token(std::move(token)), name(std::move(name)),
       parameters(std::move(parameters)) {}
 
-ExprPtrVariant createFuncEPV(Token token, std::optional<Token> name,
-                             std::vector<Token> parameters) {
-  return std::make_unique<FuncExpr>(std::move(token), std::move(name),
-                                    std::move(parameters));
+ExprPtrVariant createFuncEPV(Arena &arena, Token token,
+                             std::optional<Token> name,
+                             List<Token> parameters) {
+  return arena.make<FuncExpr>(std::move(token), std::move(name),
+                              arena.adopt(std::move(parameters)));
 }
 
-constexpr CallExpr::CallExpr(Token ident,
-                             std::vector<ExprPtrVariant> arguments) noexcept
+CallExpr::CallExpr(Token ident, List<ExprPtrVariant> arguments) noexcept
     : ident(std::move(ident)), arguments(std::move(arguments)) {}
 
-ExprPtrVariant createCallEPV(Token ident,
-                             std::vector<ExprPtrVariant> arguments) {
-  return std::make_unique<CallExpr>(std::move(ident), std::move(arguments));
+ExprPtrVariant createCallEPV(Arena &arena, Token ident,
+                             List<ExprPtrVariant> arguments) {
+  return arena.make<CallExpr>(std::move(ident),
+                              arena.adopt(std::move(arguments)));
 }
 
 constexpr VarStmt::VarStmt(Token varName, ExprPtrVariant initializer) noexcept
     : varName(varName), initializer(std::move(initializer)) {}
 
-StmtPtrVariant createVarSPV(Token varName, ExprPtrVariant initializer) {
-  return std::make_unique<VarStmt>(varName, std::move(initializer));
+StmtPtrVariant createVarSPV(Arena &arena, Token varName,
+                            ExprPtrVariant initializer) {
+  return arena.make<VarStmt>(varName, std::move(initializer));
 }
 
 constexpr IfStmt::IfStmt(ExprPtrVariant condition, StmtPtrVariant thenBranch,
@@ -99,48 +106,53 @@ constexpr IfStmt::IfStmt(ExprPtrVariant condition, StmtPtrVariant thenBranch,
     : condition(std::move(condition)), thenBranch(std::move(thenBranch)),
       elseBranch(std::move(elseBranch)) {}
 
-StmtPtrVariant createIfSPV(ExprPtrVariant condition, StmtPtrVariant thenBranch,
+StmtPtrVariant createIfSPV(Arena &arena, ExprPtrVariant condition,
+                           StmtPtrVariant thenBranch,
                            std::optional<StmtPtrVariant> elseBranch) {
-  return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch),
-                                  std::move(elseBranch));
+  return arena.make<IfStmt>(std::move(condition), std::move(thenBranch),
+                            std::move(elseBranch));
 }
 
-constexpr WhileStmt::WhileStmt(ExprPtrVariant condition,
+constexpr WhileStmt::WhileStmt(Token token, ExprPtrVariant condition,
                                StmtPtrVariant body) noexcept
-    : condition(std::move(condition)), body(std::move(body)) {}
+    : token(std::move(token)), condition(std::move(condition)),
+      body(std::move(body)) {}
 
-StmtPtrVariant createWhileSPV(ExprPtrVariant condition, StmtPtrVariant body) {
-  return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+StmtPtrVariant createWhileSPV(Arena &arena, Token token,
+                              ExprPtrVariant condition, StmtPtrVariant body) {
+  return arena.make<WhileStmt>(std::move(token), std::move(condition),
+                               std::move(body));
 }
 
 constexpr PrintStmt::PrintStmt(ExprPtrVariant value) noexcept
     : value(std::move(value)) {}
 
-StmtPtrVariant createPrintSPV(ExprPtrVariant value) {
-  return std::make_unique<PrintStmt>(std::move(value));
+StmtPtrVariant createPrintSPV(Arena &arena, ExprPtrVariant value) {
+  return arena.make<PrintStmt>(std::move(value));
 }
 
 constexpr ExprStmt::ExprStmt(ExprPtrVariant expression) noexcept
     : expression(std::move(expression)) {}
 
-StmtPtrVariant createExprSPV(ExprPtrVariant expression) {
-  return std::make_unique<ExprStmt>(std::move(expression));
+StmtPtrVariant createExprSPV(Arena &arena, ExprPtrVariant expression) {
+  return arena.make<ExprStmt>(std::move(expression));
 }
 
-constexpr FunctionStmt::FunctionStmt(std::vector<Token> params,
-                                     std::vector<StmtPtrVariant> body) noexcept
+FunctionStmt::FunctionStmt(List<Token> params,
+                           List<StmtPtrVariant> body) noexcept
     : params(std::move(params)), body(std::move(body)) {}
 
-StmtPtrVariant createFunctionSPV(std::vector<Token> params,
-                                 std::vector<StmtPtrVariant> body) {
-  return std::make_unique<FunctionStmt>(std::move(params), std::move(body));
+StmtPtrVariant createFunctionSPV(Arena &arena, List<Token> params,
+                                 List<StmtPtrVariant> body) {
+  return arena.make<FunctionStmt>(arena.adopt(std::move(params)),
+                                  arena.adopt(std::move(body)));
 }
 
-constexpr BlockStmt::BlockStmt(std::vector<StmtPtrVariant> statements) noexcept
+BlockStmt::BlockStmt(List<StmtPtrVariant> statements) noexcept
     : statements(std::move(statements)) {}
 
-StmtPtrVariant createBlockSPV(std::vector<StmtPtrVariant> statements) {
-  return std::make_unique<BlockStmt>(std::move(statements));
+StmtPtrVariant createBlockSPV(Arena &arena, List<StmtPtrVariant> statements) {
+  return arena.make<BlockStmt>(arena.adopt(std::move(statements)));
 }
 
 constexpr ReturnStmt::ReturnStmt(Token token, ExprPtrVariant retValue,
@@ -148,14 +160,16 @@ constexpr ReturnStmt::ReturnStmt(Token token, ExprPtrVariant retValue,
     : retToken(std::move(token)), retValue(std::move(retValue)),
       isFunction(isFunction) {}
 
-StmtPtrVariant createReturnSPV(Token token, ExprPtrVariant retValue,
-                               bool isFunction) {
-  return std::make_unique<ReturnStmt>(std::move(token), std::move(retValue),
-                                      isFunction);
+StmtPtrVariant createReturnSPV(Arena &arena, Token token,
+                               ExprPtrVariant retValue, bool isFunction) {
+  return arena.make<ReturnStmt>(std::move(token), std::move(retValue),
+                                isFunction);
 }
 
 constexpr NullStmt::NullStmt() noexcept {}
 
-StmtPtrVariant createNullSPV() { return std::make_unique<NullStmt>(); }
+StmtPtrVariant createNullSPV(Arena &arena) {
+  return arena.make<NullStmt>();
+}
 
 } // namespace prsl::AST
\ No newline at end of file
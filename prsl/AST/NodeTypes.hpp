@@ -1,46 +1,45 @@
 #pragma once
 
+#include "prsl/AST/Arena.hpp"
 #include "prsl/Parser/Token.hpp"
 
-#include <memory>
 #include <optional>
 #include <variant>
-#include <vector>
 
 namespace prsl::AST {
 
 struct LiteralExpr;
-using LiteralExprPtr = std::unique_ptr<LiteralExpr>;
+using LiteralExprPtr = NodePtr<LiteralExpr>;
 
 struct GroupingExpr;
-using GroupingExprPtr = std::unique_ptr<GroupingExpr>;
+using GroupingExprPtr = NodePtr<GroupingExpr>;
 
 struct VarExpr;
-using VarExprPtr = std::unique_ptr<VarExpr>;
+using VarExprPtr = NodePtr<VarExpr>;
 
 struct InputExpr;
-using InputExprPtr = std::unique_ptr<InputExpr>;
+using InputExprPtr = NodePtr<InputExpr>;
 
 struct AssignmentExpr;
-using AssignmentExprPtr = std::unique_ptr<AssignmentExpr>;
+using AssignmentExprPtr = NodePtr<AssignmentExpr>;
 
 struct UnaryExpr;
-using UnaryExprPtr = std::unique_ptr<UnaryExpr>;
+using UnaryExprPtr = NodePtr<UnaryExpr>;
 
 struct BinaryExpr;
-using BinaryExprPtr = std::unique_ptr<BinaryExpr>;
+using BinaryExprPtr = NodePtr<BinaryExpr>;
 
 struct PostfixExpr;
-using PostfixExprPtr = std::unique_ptr<PostfixExpr>;
+using PostfixExprPtr = NodePtr<PostfixExpr>;
 
 struct ScopeExpr;
-using ScopeExprPtr = std::unique_ptr<ScopeExpr>;
+using ScopeExprPtr = NodePtr<ScopeExpr>;
 
 struct FuncExpr;
-using FuncExprPtr = std::unique_ptr<FuncExpr>;
+using FuncExprPtr = NodePtr<FuncExpr>;
 
 struct CallExpr;
-using CallExprPtr = std::unique_ptr<CallExpr>;
+using CallExprPtr = NodePtr<CallExpr>;
 
 using ExprPtrVariant =
     std::variant<LiteralExprPtr, GroupingExprPtr, VarExprPtr, InputExprPtr,
@@ -48,31 +47,31 @@ using ExprPtrVariant =
                  ScopeExprPtr, FuncExprPtr, CallExprPtr>;
 
 struct VarStmt;
-using VarStmtPtr = std::unique_ptr<VarStmt>;
+using VarStmtPtr = NodePtr<VarStmt>;
 
 struct IfStmt;
-using IfStmtPtr = std::unique_ptr<IfStmt>;
+using IfStmtPtr = NodePtr<IfStmt>;
 
 struct WhileStmt;
-using WhileStmtPtr = std::unique_ptr<WhileStmt>;
+using WhileStmtPtr = NodePtr<WhileStmt>;
 
 struct PrintStmt;
-using PrintStmtPtr = std::unique_ptr<PrintStmt>;
+using PrintStmtPtr = NodePtr<PrintStmt>;
 
 struct ExprStmt;
-using ExprStmtPtr = std::unique_ptr<ExprStmt>;
+using ExprStmtPtr = NodePtr<ExprStmt>;
 
 struct FunctionStmt;
-using FunctionStmtPtr = std::unique_ptr<FunctionStmt>;
+using FunctionStmtPtr = NodePtr<FunctionStmt>;
 
 struct BlockStmt;
-using BlockStmtPtr = std::unique_ptr<BlockStmt>;
+using BlockStmtPtr = NodePtr<BlockStmt>;
 
 struct ReturnStmt;
-using ReturnStmtPtr = std::unique_ptr<ReturnStmt>;
+using ReturnStmtPtr = NodePtr<ReturnStmt>;
 
 struct NullStmt;
-using NullStmtPtr = std::unique_ptr<NullStmt>;
+using NullStmtPtr = NodePtr<NullStmt>;
 
 using StmtPtrVariant =
     std::variant<VarStmtPtr, IfStmtPtr, WhileStmtPtr, PrintStmtPtr, ExprStmtPtr,
@@ -80,36 +79,46 @@ using StmtPtrVariant =
 
 using prsl::Types::Token;
 
+// Location of a variable resolved by Semantics: how many environments up from
+// the current one it is defined, and its slot in that environment
+struct Binding {
+  unsigned depth;
+  unsigned slot;
+};
+
 struct LiteralExpr final {
   int literalVal;
   explicit constexpr LiteralExpr(int value) noexcept;
 };
-ExprPtrVariant createLiteralEPV(int literalVal);
+ExprPtrVariant createLiteralEPV(Arena &arena, int literalVal);
 
 struct GroupingExpr final {
   ExprPtrVariant expression;
   explicit constexpr GroupingExpr(ExprPtrVariant expression) noexcept;
 };
-ExprPtrVariant createGroupingEPV(ExprPtrVariant expression);
+ExprPtrVariant createGroupingEPV(Arena &arena, ExprPtrVariant expression);
 
 struct VarExpr final {
   Token ident;
+  std::optional<Binding> binding;
   explicit constexpr VarExpr(Token ident) noexcept;
 };
-ExprPtrVariant createVarEPV(Token ident);
+ExprPtrVariant createVarEPV(Arena &arena, Token ident);
 
 struct InputExpr final {
   explicit constexpr InputExpr() noexcept;
 };
-ExprPtrVariant createInputEPV();
+ExprPtrVariant createInputEPV(Arena &arena);
 
 struct AssignmentExpr final {
   Token varName;
   ExprPtrVariant initializer;
+  std::optional<Binding> binding;
   explicit constexpr AssignmentExpr(Token varName,
                                     ExprPtrVariant initializer) noexcept;
 };
-ExprPtrVariant createAssignmentEPV(Token varName, ExprPtrVariant initializer);
+ExprPtrVariant createAssignmentEPV(Arena &arena, Token varName,
+                                   ExprPtrVariant initializer);
 
 struct UnaryExpr final {
   Types::Token op;
@@ -117,7 +126,8 @@ struct UnaryExpr final {
   explicit constexpr UnaryExpr(ExprPtrVariant expression,
                                Types::Token op) noexcept;
 };
-ExprPtrVariant createUnaryEPV(ExprPtrVariant expression, Types::Token op);
+ExprPtrVariant createUnaryEPV(Arena &arena, ExprPtrVariant expression,
+                              Types::Token op);
 
 struct BinaryExpr final {
   Types::Token op;
@@ -126,52 +136,63 @@ struct BinaryExpr final {
   explicit constexpr BinaryExpr(ExprPtrVariant lhsExpression, Types::Token op,
                                 ExprPtrVariant rhsExpression) noexcept;
 };
-ExprPtrVariant createBinaryEPV(ExprPtrVariant lhsExpression, Types::Token op,
-                               ExprPtrVariant rhsExpression);
+ExprPtrVariant createBinaryEPV(Arena &arena, ExprPtrVariant lhsExpression,
+                               Types::Token op, ExprPtrVariant rhsExpression);
 
 struct PostfixExpr final {
   Types::Token op;
   ExprPtrVariant expression;
+  std::optional<Binding> binding;
   explicit constexpr PostfixExpr(ExprPtrVariant expression,
                                  Types::Token op) noexcept;
 };
-ExprPtrVariant createPostfixEPV(ExprPtrVariant expression, Types::Token op);
+ExprPtrVariant createPostfixEPV(Arena &arena, ExprPtrVariant expression,
+                                Types::Token op);
 
 struct ScopeExpr final {
-  std::vector<StmtPtrVariant> statements;
-  explicit constexpr ScopeExpr(std::vector<StmtPtrVariant> statements) noexcept;
+  List<StmtPtrVariant> statements;
+  unsigned slotsCount{0};
+  explicit ScopeExpr(List<StmtPtrVariant> statements) noexcept;
 };
-ExprPtrVariant createScopeEPV(std::vector<StmtPtrVariant> statements);
+ExprPtrVariant createScopeEPV(Arena &arena, List<StmtPtrVariant> statements);
 
 struct FuncExpr final {
   // For diagnostics
   Token token;
   std::optional<Token> name;
-  std::vector<Token> parameters;
+  List<Token> parameters;
   ExprPtrVariant body;
   std::optional<ExprPtrVariant> retExpr;
-  constexpr FuncExpr(Token token, std::optional<Token> name,
-                     std::vector<Token> parameters) noexcept;
+  // Size of the call frame. Parameters occupy its first slots, in order
+  unsigned slotsCount{0};
+  // Dense index of the declaration, assigned by semantic analysis
+  unsigned id{0};
+  FuncExpr(Token token, std::optional<Token> name,
+           List<Token> parameters) noexcept;
 };
-ExprPtrVariant createFuncEPV(Token token, std::optional<Token> name,
-                             std::vector<Token> parameters);
+ExprPtrVariant createFuncEPV(Arena &arena, Token token,
+                             std::optional<Token> name, List<Token> parameters);
 
 struct CallExpr final {
   Token ident;
-  std::vector<ExprPtrVariant> arguments;
-  explicit constexpr CallExpr(Token ident,
-                              std::vector<ExprPtrVariant> arguments) noexcept;
+  List<ExprPtrVariant> arguments;
+  std::optional<Binding> binding;
+  // Named function the call resolves to. Calls through variables use binding
+  const FuncExpr *callee{nullptr};
+  explicit CallExpr(Token ident, List<ExprPtrVariant> arguments) noexcept;
 };
-ExprPtrVariant createCallEPV(Token ident,
-                             std::vector<ExprPtrVariant> arguments);
+ExprPtrVariant createCallEPV(Arena &arena, Token ident,
+                             List<ExprPtrVariant> arguments);
 
 struct VarStmt final {
   Token varName;
   ExprPtrVariant initializer;
+  std::optional<Binding> binding;
   explicit constexpr VarStmt(Token varName,
                              ExprPtrVariant initializer) noexcept;
 };
-StmtPtrVariant createVarSPV(Token varName, ExprPtrVariant initializer);
+StmtPtrVariant createVarSPV(Arena &arena, Token varName,
+                            ExprPtrVariant initializer);
 
 struct IfStmt final {
   ExprPtrVariant condition;
@@ -181,43 +202,51 @@ struct IfStmt final {
   explicit constexpr IfStmt(ExprPtrVariant condition, StmtPtrVariant thenBranch,
                             std::optional<StmtPtrVariant> elseBranch) noexcept;
 };
-StmtPtrVariant createIfSPV(ExprPtrVariant condition, StmtPtrVariant thenBranch,
+StmtPtrVariant createIfSPV(Arena &arena, ExprPtrVariant condition,
+                           StmtPtrVariant thenBranch,
                            std::optional<StmtPtrVariant> elseBranch);
 
 struct WhileStmt final {
+  // For diagnostics
+  Token token;
   ExprPtrVariant condition;
   StmtPtrVariant body;
-  explicit constexpr WhileStmt(ExprPtrVariant condition,
+  // Dense index of the loop, assigned by semantic analysis
+  unsigned id{0};
+  explicit constexpr WhileStmt(Token token, ExprPtrVariant condition,
                                StmtPtrVariant body) noexcept;
 };
-StmtPtrVariant createWhileSPV(ExprPtrVariant condition, StmtPtrVariant body);
+StmtPtrVariant createWhileSPV(Arena &arena, Token token,
+                              ExprPtrVariant condition, StmtPtrVariant body);
 
 struct PrintStmt final {
   ExprPtrVariant value;
   explicit constexpr PrintStmt(ExprPtrVariant value) noexcept;
 };
-StmtPtrVariant createPrintSPV(ExprPtrVariant value);
+StmtPtrVariant createPrintSPV(Arena &arena, ExprPtrVariant value);
 
 struct ExprStmt final {
   ExprPtrVariant expression;
   explicit constexpr ExprStmt(ExprPtrVariant expression) noexcept;
 };
-StmtPtrVariant createExprSPV(ExprPtrVariant expression);
+StmtPtrVariant createExprSPV(Arena &arena, ExprPtrVariant expression);
 
 struct FunctionStmt final {
-  std::vector<Token> params;
-  std::vector<StmtPtrVariant> body;
-  explicit constexpr FunctionStmt(std::vector<Token> params,
-                                  std::vector<StmtPtrVariant> body) noexcept;
+  List<Token> params;
+  List<StmtPtrVariant> body;
+  unsigned slotsCount{0};
+  explicit FunctionStmt(List<Token> params,
+                        List<StmtPtrVariant> body) noexcept;
 };
-StmtPtrVariant createFunctionSPV(std::vector<Token> params,
-                                 std::vector<StmtPtrVariant> body);
+StmtPtrVariant createFunctionSPV(Arena &arena, List<Token> params,
+                                 List<StmtPtrVariant> body);
 
 struct BlockStmt final {
-  std::vector<StmtPtrVariant> statements;
-  explicit constexpr BlockStmt(std::vector<StmtPtrVariant> statements) noexcept;
+  List<StmtPtrVariant> statements;
+  unsigned slotsCount{0};
+  explicit BlockStmt(List<StmtPtrVariant> statements) noexcept;
 };
-StmtPtrVariant createBlockSPV(std::vector<StmtPtrVariant> statements);
+StmtPtrVariant createBlockSPV(Arena &arena, List<StmtPtrVariant> statements);
 
 struct ReturnStmt final {
   Token retToken;
@@ -226,12 +255,12 @@ struct ReturnStmt final {
   explicit constexpr ReturnStmt(Token token, ExprPtrVariant retValue,
                                 bool isFunction) noexcept;
 };
-StmtPtrVariant createReturnSPV(Token token, ExprPtrVariant retValue,
-                               bool isFunction);
+StmtPtrVariant createReturnSPV(Arena &arena, Token token,
+                               ExprPtrVariant retValue, bool isFunction);
 
 struct NullStmt final {
   explicit constexpr NullStmt() noexcept;
 };
-StmtPtrVariant createNullSPV();
+StmtPtrVariant createNullSPV(Arena &arena);
 
 } // namespace prsl::AST
\ No newline at end of file
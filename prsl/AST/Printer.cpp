@@ -0,0 +1,175 @@
+#include "prsl/AST/Printer.hpp"
+
+namespace prsl::AST {
+
+void Printer::visitLiteralExpr(const LiteralExprPtr &expr) {
+  os << expr->literalVal;
+}
+
+void Printer::visitGroupingExpr(const GroupingExprPtr &expr) {
+  os << '(';
+  visitExpr(expr->expression);
+  os << ')';
+}
+
+void Printer::visitVarExpr(const VarExprPtr &expr) {
+  os << expr->ident.getLexeme();
+}
+
+void Printer::visitInputExpr(const InputExprPtr &expr) { os << '?'; }
+
+void Printer::visitAssignmentExpr(const AssignmentExprPtr &expr) {
+  os << expr->varName.getLexeme() << " = ";
+  visitExpr(expr->initializer);
+}
+
+void Printer::visitUnaryExpr(const UnaryExprPtr &expr) {
+  os << expr->op.getLexeme();
+  // Two minuses in a row would be a decrement
+  const auto &operand = expr->expression;
+  if (std::holds_alternative<UnaryExprPtr>(operand) ||
+      (std::holds_alternative<LiteralExprPtr>(operand) &&
+       std::get<LiteralExprPtr>(operand)->literalVal < 0))
+    os << ' ';
+  visitExpr(operand);
+}
+
+void Printer::visitBinaryExpr(const BinaryExprPtr &expr) {
+  visitExpr(expr->lhsExpression);
+  os << ' ' << expr->op.getLexeme() << ' ';
+  visitExpr(expr->rhsExpression);
+}
+
+void Printer::visitPostfixExpr(const PostfixExprPtr &expr) {
+  visitExpr(expr->expression);
+  os << expr->op.getLexeme();
+}
+
+void Printer::visitScopeExpr(const ScopeExprPtr &expr) {
+  os << "{\n";
+  printStatements(expr->statements);
+  indent();
+  os << '}';
+}
+
+void Printer::visitFuncExpr(const FuncExprPtr &expr) {
+  os << "func(";
+  for (size_t i = 0; i != expr->parameters.size(); ++i)
+    os << (i ? ", " : "") << expr->parameters[i].getLexeme();
+  os << ") ";
+  if (expr->name)
+    os << ": " << expr->name->getLexeme() << ' ';
+  visitExpr(expr->body);
+}
+
+void Printer::visitCallExpr(const CallExprPtr &expr) {
+  os << expr->ident.getLexeme() << '(';
+  for (size_t i = 0; i != expr->arguments.size(); ++i) {
+    if (i)
+      os << ", ";
+    visitExpr(expr->arguments[i]);
+  }
+  os << ')';
+}
+
+void Printer::visitVarStmt(const VarStmtPtr &stmt) {
+  indent();
+  os << stmt->varName.getLexeme() << " = ";
+  visitExpr(stmt->initializer);
+  os << ";\n";
+}
+
+void Printer::visitIfStmt(const IfStmtPtr &stmt) {
+  indent();
+  os << "if (";
+  visitExpr(stmt->condition);
+  os << ')';
+  bool endedLine = printBody(stmt->thenBranch);
+  if (stmt->elseBranch) {
+    if (endedLine)
+      indent();
+    else
+      os << ' ';
+    os << "else";
+    endedLine = printBody(*stmt->elseBranch);
+  }
+  if (!endedLine)
+    os << '\n';
+}
+
+void Printer::visitWhileStmt(const WhileStmtPtr &stmt) {
+  indent();
+  os << "while (";
+  visitExpr(stmt->condition);
+  os << ')';
+  if (!printBody(stmt->body))
+    os << '\n';
+}
+
+void Printer::visitPrintStmt(const PrintStmtPtr &stmt) {
+  indent();
+  os << "print ";
+  visitExpr(stmt->value);
+  os << ";\n";
+}
+
+void Printer::visitExprStmt(const ExprStmtPtr &stmt) {
+  indent();
+  visitExpr(stmt->expression);
+  os << ";\n";
+}
+
+void Printer::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  for (const auto &stmt : stmt->body)
+    visitStmt(stmt);
+}
+
+void Printer::visitBlockStmt(const BlockStmtPtr &stmt) {
+  indent();
+  os << "{\n";
+  printStatements(stmt->statements);
+  indent();
+  os << "}\n";
+}
+
+void Printer::visitReturnStmt(const ReturnStmtPtr &stmt) {
+  indent();
+  os << "return ";
+  visitExpr(stmt->retValue);
+  os << ";\n";
+}
+
+void Printer::visitNullStmt(const NullStmtPtr &stmt) {
+  indent();
+  os << ";\n";
+}
+
+void Printer::printStatements(const List<StmtPtrVariant> &statements) {
+  ++depth;
+  for (const auto &stmt : statements)
+    visitStmt(stmt);
+  --depth;
+}
+
+bool Printer::printBody(const StmtPtrVariant &body) {
+  // Blocks open on the line of the statement, anything else goes below it
+  if (std::holds_alternative<BlockStmtPtr>(body)) {
+    os << " {\n";
+    printStatements(std::get<BlockStmtPtr>(body)->statements);
+    indent();
+    os << '}';
+    return false;
+  }
+  os << '\n';
+  ++depth;
+  visitStmt(body);
+  --depth;
+  return true;
+}
+
+void Printer::indent() {
+  for (unsigned i = 0; i != depth; ++i)
+    os << "  ";
+}
+
+} // namespace prsl::AST
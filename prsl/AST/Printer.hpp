@@ -0,0 +1,50 @@
+#pragma once
+
+#include "prsl/AST/ASTVisitor.hpp"
+#include "prsl/AST/NodeTypes.hpp"
+
+#include <ostream>
+
+namespace prsl::AST {
+
+// Prints the AST back as ParaCL source, one statement per line. Scopes end
+// with the returns the parser made explicit
+class Printer : public ASTVisitor<Printer> {
+public:
+  explicit Printer(std::ostream &os) : os(os) {}
+
+private:
+  friend ASTVisitor;
+
+  void visitLiteralExpr(const LiteralExprPtr &expr);
+  void visitGroupingExpr(const GroupingExprPtr &expr);
+  void visitVarExpr(const VarExprPtr &expr);
+  void visitInputExpr(const InputExprPtr &expr);
+  void visitAssignmentExpr(const AssignmentExprPtr &expr);
+  void visitUnaryExpr(const UnaryExprPtr &expr);
+  void visitBinaryExpr(const BinaryExprPtr &expr);
+  void visitPostfixExpr(const PostfixExprPtr &expr);
+  void visitScopeExpr(const ScopeExprPtr &expr);
+  void visitFuncExpr(const FuncExprPtr &expr);
+  void visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitIfStmt(const IfStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitPrintStmt(const PrintStmtPtr &stmt);
+  void visitExprStmt(const ExprStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
+  void visitNullStmt(const NullStmtPtr &stmt);
+
+  void printStatements(const List<StmtPtrVariant> &statements);
+  // Prints the body of an if or a loop. Returns whether it ended the line
+  bool printBody(const StmtPtrVariant &body);
+  void indent();
+
+  std::ostream &os;
+  unsigned depth{0};
+};
+
+} // namespace prsl::AST
@@ -4,92 +4,95 @@
 
 namespace prsl::AST {
 
-class TreeWalkerVisitor : public prsl::AST::ASTVisitor<> {
+// Visits every node below the given one. Visitors override the handlers of
+// the nodes they are interested in, and call these to go on below them
+template <typename Derived>
+class TreeWalkerVisitor : public prsl::AST::ASTVisitor<Derived> {
 public:
-  virtual void visitLiteralExpr(const LiteralExprPtr &expr) override {}
+  void visitLiteralExpr(const LiteralExprPtr &expr) {}
 
-  virtual void visitGroupingExpr(const GroupingExprPtr &expr) override {
-    visitExpr(expr->expression);
+  void visitGroupingExpr(const GroupingExprPtr &expr) {
+    this->visitExpr(expr->expression);
   }
 
-  virtual void visitVarExpr(const VarExprPtr &expr) override {}
+  void visitVarExpr(const VarExprPtr &expr) {}
 
-  virtual void visitInputExpr(const InputExprPtr &expr) override {}
+  void visitInputExpr(const InputExprPtr &expr) {}
 
-  virtual void visitAssignmentExpr(const AssignmentExprPtr &expr) override {
-    visitExpr(expr->initializer);
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    this->visitExpr(expr->initializer);
   }
 
-  virtual void visitUnaryExpr(const UnaryExprPtr &expr) override {
-    visitExpr(expr->expression);
+  void visitUnaryExpr(const UnaryExprPtr &expr) {
+    this->visitExpr(expr->expression);
   }
 
-  virtual void visitBinaryExpr(const BinaryExprPtr &expr) override {
-    visitExpr(expr->lhsExpression);
-    visitExpr(expr->rhsExpression);
+  void visitBinaryExpr(const BinaryExprPtr &expr) {
+    this->visitExpr(expr->lhsExpression);
+    this->visitExpr(expr->rhsExpression);
   }
 
-  virtual void visitPostfixExpr(const PostfixExprPtr &expr) override {
-    visitExpr(expr->expression);
+  void visitPostfixExpr(const PostfixExprPtr &expr) {
+    this->visitExpr(expr->expression);
   }
 
-  virtual void visitScopeExpr(const ScopeExprPtr &expr) override {
+  void visitScopeExpr(const ScopeExprPtr &expr) {
     for (const auto &stmt : expr->statements) {
-      visitStmt(stmt);
+      this->visitStmt(stmt);
     }
   }
 
-  virtual void visitFuncExpr(const FuncExprPtr &expr) override {
-    visitScopeExpr(std::get<ScopeExprPtr>(expr->body));
+  void visitFuncExpr(const FuncExprPtr &expr) {
+    this->visitExpr(expr->body);
   }
 
-  virtual void visitCallExpr(const CallExprPtr &expr) override {
+  void visitCallExpr(const CallExprPtr &expr) {
     for (const auto &arg : expr->arguments) {
-      visitExpr(arg);
+      this->visitExpr(arg);
     }
   }
 
-  virtual void visitVarStmt(const VarStmtPtr &stmt) override {
-    visitExpr(stmt->initializer);
+  void visitVarStmt(const VarStmtPtr &stmt) {
+    this->visitExpr(stmt->initializer);
   }
 
-  virtual void visitIfStmt(const IfStmtPtr &stmt) override {
-    visitExpr(stmt->condition);
-    visitStmt(stmt->thenBranch);
+  void visitIfStmt(const IfStmtPtr &stmt) {
+    this->visitExpr(stmt->condition);
+    this->visitStmt(stmt->thenBranch);
     if (stmt->elseBranch)
-      visitStmt(*stmt->elseBranch);
+      this->visitStmt(*stmt->elseBranch);
   }
 
-  virtual void visitWhileStmt(const WhileStmtPtr &stmt) override {
-    visitExpr(stmt->condition);
-    visitStmt(stmt->body);
+  void visitWhileStmt(const WhileStmtPtr &stmt) {
+    this->visitExpr(stmt->condition);
+    this->visitStmt(stmt->body);
   }
 
-  virtual void visitPrintStmt(const PrintStmtPtr &stmt) override {
-    visitExpr(stmt->value);
+  void visitPrintStmt(const PrintStmtPtr &stmt) {
+    this->visitExpr(stmt->value);
   }
 
-  virtual void visitExprStmt(const ExprStmtPtr &stmt) override {
-    visitExpr(stmt->expression);
+  void visitExprStmt(const ExprStmtPtr &stmt) {
+    this->visitExpr(stmt->expression);
   }
 
-  virtual void visitFunctionStmt(const FunctionStmtPtr &stmt) override {
+  void visitFunctionStmt(const FunctionStmtPtr &stmt) {
     for (const auto &stmt : stmt->body) {
-      visitStmt(stmt);
+      this->visitStmt(stmt);
     }
   }
 
-  virtual void visitBlockStmt(const BlockStmtPtr &stmt) override {
+  void visitBlockStmt(const BlockStmtPtr &stmt) {
     for (const auto &stmt : stmt->statements) {
-      visitStmt(stmt);
+      this->visitStmt(stmt);
     }
   }
 
-  virtual void visitReturnStmt(const ReturnStmtPtr &stmt) override {
-    visitExpr(stmt->retValue);
+  void visitReturnStmt(const ReturnStmtPtr &stmt) {
+    this->visitExpr(stmt->retValue);
   }
 
-  virtual void visitNullStmt(const NullStmtPtr &stmt) override {}
+  void visitNullStmt(const NullStmtPtr &stmt) {}
 };
 
 } // namespace prsl::AST
@@ -0,0 +1,180 @@
+#include "prsl/Compiler/Cache/DiskCache.hpp"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA256.h>
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace prsl::Cache {
+
+namespace {
+
+constexpr std::string_view tempSuffix = ".tmp";
+
+struct Entry {
+  fs::path path;
+  uint64_t size;
+  fs::file_time_type lastUse;
+};
+
+// Keys are hashes, anything else in the directory was not put there by the
+// cache, temporary files of unfinished writes included
+bool isKey(std::string_view name) {
+  return name.size() == 64 &&
+         std::all_of(name.begin(), name.end(), [](char c) {
+           return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+         });
+}
+
+// Entries currently in the directory, other files are never touched
+std::vector<Entry> listEntries(const fs::path &directory) {
+  std::vector<Entry> entries;
+  std::error_code error;
+  for (const auto &file : fs::directory_iterator(directory, error)) {
+    if (!file.is_regular_file(error) ||
+        !isKey(file.path().filename().string()))
+      continue;
+    auto size = file.file_size(error);
+    auto lastUse = file.last_write_time(error);
+    if (!error)
+      entries.push_back({file.path(), size, lastUse});
+  }
+  return entries;
+}
+
+} // namespace
+
+std::string hash(std::string_view data) {
+  auto digest = llvm::SHA256::hash(llvm::arrayRefFromStringRef(
+      llvm::StringRef(data.data(), data.size())));
+  return llvm::toHex(digest, /*LowerCase=*/true);
+}
+
+DiskCache::DiskCache(fs::path directory, uint64_t sizeLimit)
+    : directory(std::move(directory)), sizeLimit(sizeLimit) {
+  std::error_code error;
+  fs::create_directories(this->directory, error);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> DiskCache::load(std::string_view key) {
+  auto path = entryPath(key);
+  auto buffer = llvm::MemoryBuffer::getFile(path.string(), /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    ++stats.misses;
+    return nullptr;
+  }
+
+  recordHit(path);
+  return std::move(*buffer);
+}
+
+bool DiskCache::restore(std::string_view key, const fs::path &destination) {
+  // Not a hard link: compilers truncate and rewrite their outputs in place,
+  // which would change the entry through the link
+  auto path = entryPath(key);
+  std::error_code error;
+  if (!fs::copy_file(path, destination, fs::copy_options::overwrite_existing,
+                     error)) {
+    ++stats.misses;
+    return false;
+  }
+
+  recordHit(path);
+  return true;
+}
+
+void DiskCache::store(std::string_view key, llvm::StringRef data) {
+  auto temp = tempPath(key);
+  {
+    std::ofstream out(temp, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out) {
+      std::error_code error;
+      fs::remove(temp, error);
+      return;
+    }
+  }
+  commit(temp, key);
+}
+
+void DiskCache::storeFile(std::string_view key, const fs::path &file) {
+  auto temp = tempPath(key);
+  std::error_code error;
+  if (fs::copy_file(file, temp, fs::copy_options::overwrite_existing, error))
+    commit(temp, key);
+}
+
+void DiskCache::report(std::ostream &out) const {
+  auto entries = listEntries(directory);
+  uint64_t size = 0;
+  for (const auto &entry : entries)
+    size += entry.size;
+
+  out << "Cache " << directory.string() << "\n";
+  if (stats.hits || stats.misses || stats.stores || stats.evictions)
+    out << "  " << stats.hits << " hits, " << stats.misses << " misses, "
+        << stats.stores << " stores, " << stats.evictions << " evictions\n";
+  out << "  " << entries.size() << " entries, " << size << " of " << sizeLimit
+      << " bytes\n";
+}
+
+fs::path DiskCache::entryPath(std::string_view key) const {
+  return directory / key;
+}
+
+// Unique to the process, so concurrent writers of an entry never share one
+fs::path DiskCache::tempPath(std::string_view key) const {
+  auto path = entryPath(key);
+  path += std::string(tempSuffix) + "." +
+          std::to_string(llvm::sys::Process::getProcessId());
+  return path;
+}
+
+// Refreshes the last use of the entry, which eviction goes by
+void DiskCache::recordHit(const fs::path &path) {
+  ++stats.hits;
+  std::error_code error;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+}
+
+// Renaming is atomic, readers see either no entry or the whole of it
+void DiskCache::commit(const fs::path &temp, std::string_view key) {
+  std::error_code error;
+  fs::rename(temp, entryPath(key), error);
+  if (error) {
+    fs::remove(temp, error);
+    return;
+  }
+  ++stats.stores;
+  evict();
+}
+
+void DiskCache::evict() {
+  auto entries = listEntries(directory);
+  uint64_t size = 0;
+  for (const auto &entry : entries)
+    size += entry.size;
+  if (size <= sizeLimit)
+    return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &lhs, const Entry &rhs) {
+              return lhs.lastUse < rhs.lastUse;
+            });
+  std::error_code error;
+  for (const auto &entry : entries) {
+    if (size <= sizeLimit)
+      break;
+    if (fs::remove(entry.path, error)) {
+      size -= entry.size;
+      ++stats.evictions;
+    }
+  }
+}
+
+} // namespace prsl::Cache
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace prsl::Cache {
+
+namespace fs = std::filesystem;
+
+// Hex encoded SHA-256 of the data, used to build cache keys
+std::string hash(std::string_view data);
+
+// Entries stored as files of a directory, named by their keys. Loading an
+// entry refreshes its modification time, so once the entries outgrow the size
+// limit the least recently used ones are removed first. Entries are written
+// to a temporary file and renamed into place, so processes sharing the
+// directory never see a partially written entry. Keys are hashes, other files
+// of the directory are neither counted nor removed
+class DiskCache {
+public:
+  struct Stats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t stores{0};
+    uint64_t evictions{0};
+  };
+
+  DiskCache(fs::path directory, uint64_t sizeLimit);
+
+  // Returns nullptr if there is no entry with the key
+  std::unique_ptr<llvm::MemoryBuffer> load(std::string_view key);
+  // Copies the entry to the destination, returns false if there is none
+  bool restore(std::string_view key, const fs::path &destination);
+
+  // Failures to write are not errors, the entry is just not cached
+  void store(std::string_view key, llvm::StringRef data);
+  void storeFile(std::string_view key, const fs::path &file);
+
+  [[nodiscard]] const Stats &getStats() const noexcept { return stats; }
+  // Counters are only reported once the cache has been used
+  void report(std::ostream &out) const;
+
+private:
+  [[nodiscard]] fs::path entryPath(std::string_view key) const;
+  [[nodiscard]] fs::path tempPath(std::string_view key) const;
+  void recordHit(const fs::path &path);
+  void commit(const fs::path &temp, std::string_view key);
+  void evict();
+
+  fs::path directory;
+  uint64_t sizeLimit;
+  Stats stats;
+};
+
+} // namespace prsl::Cache
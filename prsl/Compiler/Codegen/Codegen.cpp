@@ -1,13 +1,19 @@
 #include "prsl/Compiler/Codegen/Codegen.hpp"
+#include "prsl/Compiler/Codegen/Multiversioning.hpp"
+#include "prsl/Compiler/Codegen/Runtime.hpp"
 #include "prsl/AST/NodeTypes.hpp"
 #include "prsl/Compiler/CompilerFlags.hpp"
 #include "prsl/Debug/Errors.hpp"
+#include "prsl/IR/PassManager.hpp"
 #include <config.hpp>
 
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/CallingConv.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/MC/TargetRegistry.h>
@@ -16,6 +22,8 @@
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/TargetParser/Host.h>
 
+#include <algorithm>
+
 namespace prsl::Codegen {
 
 Codegen::Codegen(Compiler::CompilerFlags *flags, Logger &logger)
@@ -30,19 +38,7 @@ Codegen::Codegen(Compiler::CompilerFlags *flags, Logger &logger)
   InitializeAllAsmPrinters();
 
   type = flags->getFileType();
-  switch (flags->getOptimizationLevel()) {
-  case Compiler::OptimizationLevel::O1:
-    optLevel = llvm::OptimizationLevel::O1;
-    break;
-  case Compiler::OptimizationLevel::O2:
-    optLevel = llvm::OptimizationLevel::O2;
-    break;
-  case Compiler::OptimizationLevel::O3:
-    optLevel = llvm::OptimizationLevel::O3;
-    break;
-  default:
-    optLevel = llvm::OptimizationLevel::O0;
-  }
+  resolveNativeTarget(*flags);
 
   std::string triple = flags->getTragetTriple();
   if (triple.empty()) {
@@ -56,8 +52,11 @@ Codegen::Codegen(Compiler::CompilerFlags *flags, Logger &logger)
     throw Errors::RuntimeError{};
   }
 
-  std::string cpu = "generic";
-  std::string features;
+  std::string cpu = flags->getTargetCPU();
+  if (cpu.empty()) {
+    cpu = "generic";
+  }
+  std::string features = flags->getTargetFeatures();
   TargetOptions opt;
   auto model = std::optional<Reloc::Model>();
   switch (flags->getRelocationModel()) {
@@ -71,34 +70,72 @@ Codegen::Codegen(Compiler::CompilerFlags *flags, Logger &logger)
   default:
     break;
   }
-  targetMachine =
-      target->createTargetMachine(triple, cpu, features, opt, model);
+  targetMachine.reset(
+      target->createTargetMachine(triple, cpu, features, opt, model));
+
+  if (flags->getMultiversioning() &&
+      !supportsMultiversioning(targetMachine->getTargetTriple())) {
+    logger.error(PROJECT_NAME, "multiversioning requires an x86-64 ELF target");
+    throw Errors::RuntimeError{};
+  }
 
   module->setDataLayout(targetMachine->createDataLayout());
   module->setTargetTriple(targetMachine->getTargetTriple().getTriple());
 }
 
-void Codegen::initOpt() const {
-  if (optLevel != llvm::OptimizationLevel::O0) {
-    LoopAnalysisManager lam;
-    FunctionAnalysisManager fam;
-    CGSCCAnalysisManager cgam;
-    ModuleAnalysisManager mam;
-
-    passBuilder.registerModuleAnalyses(mam);
-    passBuilder.registerCGSCCAnalyses(cgam);
-    passBuilder.registerFunctionAnalyses(fam);
-    passBuilder.registerLoopAnalyses(lam);
-    passBuilder.crossRegisterProxies(lam, fam, cgam, mam);
-
-    auto mpm = passBuilder.buildPerModuleDefaultPipeline(optLevel);
-    mpm.run(*module.get(), mam);
+void resolveNativeTarget(Compiler::CompilerFlags &flags) {
+  if (flags.getTargetCPU() != "native" && flags.getTargetFeatures() != "native")
+    return;
+
+  // Detected the way the JIT does, which also spells the features in the
+  // form the target machine takes them
+  auto host = orc::JITTargetMachineBuilder::detectHost();
+  if (!host) {
+    consumeError(host.takeError());
+    return;
   }
+  if (flags.getTargetCPU() == "native")
+    flags.setTargetCPU(host->getCPU());
+  if (flags.getTargetFeatures() == "native")
+    flags.setTargetFeatures(host->getFeatures().getString());
 }
 
-bool Codegen::dump(const std::filesystem::path &path) const {
-  initOpt();
+void optimize(Module &module, Compiler::OptimizationLevel level,
+              TargetMachine *targetMachine) {
+  llvm::OptimizationLevel optLevel;
+  switch (level) {
+  case Compiler::OptimizationLevel::O1:
+    optLevel = llvm::OptimizationLevel::O1;
+    break;
+  case Compiler::OptimizationLevel::O2:
+    optLevel = llvm::OptimizationLevel::O2;
+    break;
+  case Compiler::OptimizationLevel::O3:
+    optLevel = llvm::OptimizationLevel::O3;
+    break;
+  default:
+    return;
+  }
+
+  LoopAnalysisManager lam;
+  FunctionAnalysisManager fam;
+  CGSCCAnalysisManager cgam;
+  ModuleAnalysisManager mam;
+
+  // Let the optimizer see the cost model of the target CPU
+  PassBuilder passBuilder(targetMachine);
+  passBuilder.registerModuleAnalyses(mam);
+  passBuilder.registerCGSCCAnalyses(cgam);
+  passBuilder.registerFunctionAnalyses(fam);
+  passBuilder.registerLoopAnalyses(lam);
+  passBuilder.crossRegisterProxies(lam, fam, cgam, mam);
+
+  auto mpm = passBuilder.buildPerModuleDefaultPipeline(optLevel);
+  mpm.run(module, mam);
+}
 
+std::filesystem::path getOutputFile(const std::filesystem::path &path,
+                                    Compiler::OutputFileType type) {
   std::string ext;
   switch (type) {
   case Compiler::OutputFileType::AsmFile:
@@ -118,8 +155,46 @@ bool Codegen::dump(const std::filesystem::path &path) const {
 #endif
     break;
   }
+  return auto{path}.replace_extension(ext);
+}
+
+std::string describeOutput(const Compiler::CompilerFlags &flags,
+                           const std::filesystem::path &path,
+                           std::string_view sourceName) {
+  // The default target depends on the host
+  std::string triple = flags.getTragetTriple();
+  if (triple.empty())
+    triple = sys::getDefaultTargetTriple();
+
+  // The output path ends up in the module as its source file name, the
+  // source name in the errors of divisions by zero
+  return std::string(PROJECT_NAME " " PROJECT_VERSION
+                                  ", LLVM " LLVM_VERSION_STRING "\n") +
+         path.string() + "\n" + std::string(sourceName) + "\n" +
+         std::to_string(static_cast<int>(flags.getFileType())) + " " +
+         std::to_string(static_cast<int>(flags.getOptimizationLevel())) + " " +
+         std::to_string(static_cast<int>(flags.getRelocationModel())) + " " +
+         triple + " " + flags.getTargetCPU() + " " + flags.getTargetFeatures() +
+         (flags.getMultiversioning() ? " multiversion" : "") + "\n" +
+         std::to_string(flags.getInlineBudget()) + "\n";
+}
+
+void Codegen::initOpt() const {
+  optimize(*module, flags->getOptimizationLevel(), targetMachine.get());
+}
+
+orc::ThreadSafeModule Codegen::takeModule() {
+  return orc::ThreadSafeModule(std::move(module), std::move(context));
+}
 
-  std::string name = auto{path}.replace_extension(ext).string();
+bool Codegen::dump(const std::filesystem::path &path) const {
+  // Without the bitcode the calls stay external, to be linked with libprslrt
+  std::ignore = linkRuntime(*module);
+  if (flags->getMultiversioning())
+    multiversion(*module);
+  initOpt();
+
+  std::string name = getOutputFile(path, type).string();
 
   std::error_code ec;
   raw_fd_ostream output(name, ec, sys::fs::OF_None);
@@ -173,35 +248,17 @@ Value *Codegen::visitGroupingExpr(const GroupingExprPtr &expr) {
 }
 
 Value *Codegen::visitVarExpr(const VarExprPtr &expr) {
-  AllocaInst *V = getAllocVar(expr->ident);
+  AllocaInst *V = getAllocVar(expr->ident, *expr->binding);
   return builder->CreateLoad(intType, V, expr->ident.getLexeme());
 }
 
 Value *Codegen::visitInputExpr(const InputExprPtr &expr) {
-  BasicBlock *insertBB = builder->GetInsertBlock();
-  Function *func_scanf = module->getFunction("scanf");
-
-  if (!func_scanf) {
-    std::vector<llvm::Type *> ints(0, intType);
-    FunctionType *funcType = FunctionType::get(intType, ints, false);
-    func_scanf = Function::Create(funcType, Function::ExternalLinkage, "scanf",
-                                  module.get());
-    func_scanf->setCallingConv(CallingConv::C);
-  }
-
-  Value *str = builder->CreateGlobalStringPtr("%d");
-  auto *temp_var = allocVar("inputtemp");
-  std::vector<Value *> call_params;
-  call_params.push_back(str);
-  call_params.push_back(temp_var);
-
-  llvm::CallInst::Create(func_scanf, call_params, "calltmp", insertBB);
-  return builder->CreateLoad(intType, temp_var, "inputres");
+  return builder->CreateCall(getRuntimeInput(*module), {}, "inputres");
 }
 
 Value *Codegen::visitAssignmentExpr(const AssignmentExprPtr &expr) {
   Value *value = visitExpr(expr->initializer);
-  AllocaInst *varInst = getOrCreateAllocVar(expr->varName);
+  AllocaInst *varInst = getOrCreateAllocVar(expr->varName, *expr->binding);
   builder->CreateStore(value, varInst);
   return value;
 }
@@ -234,7 +291,7 @@ Value *Codegen::visitBinaryExpr(const BinaryExprPtr &expr) {
   case Token::Type::STAR:
     return builder->CreateMul(lhs, rhs, "multmp");
   case Token::Type::SLASH:
-    return builder->CreateSDiv(lhs, rhs, "divtmp");
+    return divide(lhs, rhs, expr->op);
   case Token::Type::NOT_EQUAL:
     return builder->CreateICmpNE(lhs, rhs, "netmp");
   case Token::Type::EQUAL_EQUAL:
@@ -276,70 +333,224 @@ Value *Codegen::visitPostfixExpr(const PostfixExprPtr &expr) {
   Value *obj = visitExpr(expr->expression);
   if (std::holds_alternative<VarExprPtr>(expr->expression)) {
     const auto &varExpr = std::get<VarExprPtr>(expr->expression);
-    postfixExpr(expr->op, obj, getAllocVar(varExpr->ident));
+    postfixExpr(expr->op, obj, getAllocVar(varExpr->ident, *expr->binding));
   }
   return obj;
 }
 
 Value *Codegen::evaluateScope(const ScopeExprPtr &stmt) {
-  for (const auto &stmt : stmt->statements) {
+  Function *function = builder->GetInsertBlock()->getParent();
+  scopeExits.push_back({BasicBlock::Create(*context, "scopeexit"), {}});
+  for (const auto &stmt : stmt->statements)
     visitStmt(stmt);
-    if (returnStack.size()) {
-      auto [returnValue, isFunction] = std::move(returnStack.top());
-      returnStack.pop();
-      return returnValue;
-    }
+  auto exit = std::move(scopeExits.back());
+  scopeExits.pop_back();
+
+  // The block opened after a final return is never entered, scopes falling
+  // off their end give 0
+  BasicBlock *last = builder->GetInsertBlock();
+  if (last->empty() && pred_empty(last) &&
+      last != &function->getEntryBlock()) {
+    last->eraseFromParent();
+  } else {
+    exit.returns.push_back({ConstantInt::get(intType, 0), last, nullptr});
+    builder->CreateBr(exit.block);
   }
-  return nullptr;
+
+  function->insert(function->end(), exit.block);
+  if (exit.returns.size() == 1) {
+    builder->SetInsertPoint(exit.block);
+    return exit.returns.front().value;
+  }
+  // Values meeting in a phi must be ints, comparisons give i1
+  for (auto &ret : exit.returns) {
+    builder->SetInsertPoint(ret.block->getTerminator());
+    ret.value = toInt(ret.value, *ret.token);
+  }
+  builder->SetInsertPoint(exit.block);
+  PHINode *phi =
+      builder->CreatePHI(intType, exit.returns.size(), "scopetmp");
+  for (const auto &ret : exit.returns)
+    phi->addIncoming(ret.value, ret.block);
+  return phi;
+}
+
+Value *Codegen::toInt(Value *value, const Token &token) {
+  if (!value->getType()->isIntegerTy())
+    throw reportRuntimeError(logger, token, "Can't return a function here");
+  return builder->CreateZExt(value, intType);
+}
+
+Value *Codegen::divide(Value *lhs, Value *rhs, const Token &op) {
+  if (auto *divisor = dyn_cast<ConstantInt>(rhs); divisor && !divisor->isZero())
+    return builder->CreateSDiv(lhs, rhs, "divtmp");
+
+  Function *func = builder->GetInsertBlock()->getParent();
+  auto *failBB = BasicBlock::Create(*context, "divzero", func);
+  auto *divBB = BasicBlock::Create(*context, "div", func);
+  builder->CreateCondBr(
+      builder->CreateICmpEQ(rhs, ConstantInt::get(intType, 0), "iszero"),
+      failBB, divBB);
+
+  builder->SetInsertPoint(failBB);
+  auto pos = logger.locate(op.getLocation());
+  builder->CreateCall(
+      getRuntimeFail(*module),
+      {builder->CreateGlobalString(pos.filename),
+       builder->getInt32(pos.line), builder->getInt32(pos.col),
+       builder->CreateGlobalString("at '" + op.toString() +
+                                   "': Division by zero")});
+  builder->CreateUnreachable();
+
+  builder->SetInsertPoint(divBB);
+  return builder->CreateSDiv(lhs, rhs, "divtmp");
 }
 
 Value *Codegen::visitScopeExpr(const ScopeExprPtr &stmt) {
   Value *res;
-  envManager.withNewEnviron([&] { res = evaluateScope(stmt); });
+  envManager.withNewFrame(stmt->slotsCount,
+                          [&] { res = evaluateScope(stmt); });
   return res;
 }
 
 Value *Codegen::visitFuncExpr(const FuncExprPtr &expr) {
+  return emitFunction(*expr);
+}
+
+Function *Codegen::emitFunction(const FuncExpr &expr) {
+  if (auto it = functions.find(&expr); it != functions.end())
+    return it->second;
+
   auto *previousBB = builder->GetInsertBlock();
 
-  std::vector<llvm::Type *> argTypes(expr->parameters.size(), intType);
+  std::vector<llvm::Type *> argTypes(expr.parameters.size(), intType);
   FunctionType *ftype = FunctionType::get(intType, argTypes, false);
   Function *func = Function::Create(
       ftype, Function::ExternalLinkage,
-      expr->name ? expr->name->getLexeme() : "func", module.get());
+      expr.name ? expr.name->getLexeme() : "func", module.get());
+  functions.emplace(&expr, func);
 
   // Create a new basic block to start insertion into.
   BasicBlock *BB = BasicBlock::Create(*context, "entry", func);
   builder->SetInsertPoint(BB);
 
-  auto funcEnv = std::make_shared<Types::Environment<Value *>>(nullptr);
-
-  if (expr->name)
-    functionsManager.set(expr->name->getLexeme(), func);
-
-  Value *res = nullptr;
-  envManager.withNewEnviron(funcEnv, [&]() {
+  envManager.withNewFrame(expr.slotsCount, [&]() {
     auto argsIt = func->args().begin();
-    auto paramsIt = expr->parameters.begin();
-    for (; argsIt != func->args().end() && paramsIt != expr->parameters.end();
-         argsIt++, paramsIt++) {
+    auto paramsIt = expr.parameters.begin();
+    unsigned slot = 0;
+    for (; argsIt != func->args().end() && paramsIt != expr.parameters.end();
+         argsIt++, paramsIt++, slot++) {
       auto *allocaInst = allocVar(paramsIt->getLexeme());
-      envManager.define(*paramsIt, allocaInst);
+      envManager.define(Binding{0, slot}, allocaInst);
       builder->CreateStore(argsIt, allocaInst);
     }
 
-    auto scopeRes = evaluateScope(std::get<ScopeExprPtr>(expr->body));
+    auto *result = evaluateScope(std::get<ScopeExprPtr>(expr.body));
+    builder->CreateRet(toInt(result, expr.token));
   });
 
+  // Blocks opened after returns are never entered
+  for (BasicBlock &block : *func)
+    if (!block.getTerminator() && &block != &func->getEntryBlock() &&
+        pred_empty(&block))
+      new UnreachableInst(*context, &block);
+
   verifyFunction(*func);
-  builder->SetInsertPoint(previousBB);
+  if (previousBB)
+    builder->SetInsertPoint(previousBB);
+  else
+    builder->ClearInsertionPoint();
   return func;
 }
 
+Function *Codegen::emitEntryPoint(const FuncExpr &expr,
+                                  std::string_view name) {
+  Function *callee = emitFunction(expr);
+
+  FunctionType *ftype = FunctionType::get(
+      intType, {llvm::PointerType::get(*context, 0)}, false);
+  Function *entry =
+      Function::Create(ftype, Function::ExternalLinkage, name, module.get());
+  builder->SetInsertPoint(BasicBlock::Create(*context, "entry", entry));
+
+  std::vector<Value *> args;
+  for (unsigned i = 0; i != callee->arg_size(); ++i) {
+    Value *ptr =
+        builder->CreateConstInBoundsGEP1_32(intType, entry->getArg(0), i);
+    args.push_back(builder->CreateLoad(intType, ptr));
+  }
+  builder->CreateRet(builder->CreateCall(callee, args, "calltmp"));
+  builder->ClearInsertionPoint();
+
+  return finishEntryPoint(entry);
+}
+
+Function *Codegen::emitLoop(const WhileStmtPtr &loop,
+                            const std::vector<Binding> &variables,
+                            std::string_view name) {
+  FunctionType *ftype =
+      FunctionType::get(llvm::Type::getVoidTy(*context),
+                        {llvm::PointerType::get(*context, 0)}, false);
+  Function *entry =
+      Function::Create(ftype, Function::ExternalLinkage, name, module.get());
+  builder->SetInsertPoint(BasicBlock::Create(*context, "entry", entry));
+
+  std::vector<Value *> pointers;
+  std::vector<AllocaInst *> allocas;
+  for (unsigned i = 0; i != variables.size(); ++i) {
+    pointers.push_back(
+        builder->CreateConstInBoundsGEP1_32(intType, entry->getArg(0), i));
+    allocas.push_back(allocVar("osrvar"));
+    builder->CreateStore(builder->CreateLoad(intType, pointers.back()),
+                         allocas.back());
+  }
+
+  // Recreate the frames around the loop, holding just the variables it uses
+  unsigned depth = 0;
+  for (const auto &binding : variables)
+    depth = std::max(depth, binding.depth + 1);
+  std::vector<unsigned> frameSizes(depth, 0);
+  for (const auto &binding : variables)
+    frameSizes[binding.depth] =
+        std::max(frameSizes[binding.depth], binding.slot + 1);
+
+  auto enterFrames = [&](auto &self, unsigned remaining) -> void {
+    if (remaining != 0) {
+      envManager.withNewFrame(frameSizes[remaining - 1],
+                              [&] { self(self, remaining - 1); });
+      return;
+    }
+    for (unsigned i = 0; i != variables.size(); ++i)
+      envManager.define(variables[i], allocas[i]);
+    visitWhileStmt(loop);
+  };
+  enterFrames(enterFrames, depth);
+
+  for (unsigned i = 0; i != variables.size(); ++i)
+    builder->CreateStore(builder->CreateLoad(intType, allocas[i]),
+                         pointers[i]);
+  builder->CreateRetVoid();
+  builder->ClearInsertionPoint();
+
+  return finishEntryPoint(entry);
+}
+
+Function *Codegen::finishEntryPoint(Function *entry) {
+  // Only the entry point is visible outside of the module, so modules
+  // generated for different entry points never clash
+  for (auto &func : *module) {
+    if (&func != entry && !func.isDeclaration())
+      func.setLinkage(Function::InternalLinkage);
+  }
+  // Values of other types than int end up in ill-typed IR
+  if (verifyModule(*module))
+    return nullptr;
+  return entry;
+}
+
 Value *Codegen::visitCallExpr(const CallExprPtr &expr) {
-  Function *func = getFunction(expr->ident);
-  if (functionsManager.contains(expr->ident.getLexeme()))
-    func = functionsManager.get(expr->ident.getLexeme());
+  Function *func = expr->callee ? emitFunction(*expr->callee)
+                                : getFunction(expr->ident, expr->binding);
 
   if (!func)
     throw reportRuntimeError(logger, expr->ident, "Not a function");
@@ -359,9 +570,9 @@ Value *Codegen::visitCallExpr(const CallExprPtr &expr) {
 void Codegen::visitVarStmt(const VarStmtPtr &stmt) {
   Value *value = visitExpr(stmt->initializer);
   if (isa<Function>(value)) {
-    envManager.define(stmt->varName, value);
+    envManager.define(*stmt->binding, value);
   } else {
-    AllocaInst *varInst = getOrCreateAllocVar(stmt->varName);
+    AllocaInst *varInst = getOrCreateAllocVar(stmt->varName, *stmt->binding);
     builder->CreateStore(value, varInst);
   }
 };
@@ -388,11 +599,7 @@ void Codegen::visitIfStmt(const IfStmtPtr &stmt) {
 
   builder->SetInsertPoint(thenBB);
   visitStmt(stmt->thenBranch);
-  if (returnStack.size()) {
-    returnStack.pop();
-  } else {
-    builder->CreateBr(mergeBB);
-  }
+  builder->CreateBr(mergeBB);
 
   thenBB = builder->GetInsertBlock();
 
@@ -400,11 +607,7 @@ void Codegen::visitIfStmt(const IfStmtPtr &stmt) {
     function->insert(function->end(), elseBB);
     builder->SetInsertPoint(elseBB);
     visitStmt(*stmt->elseBranch);
-    if (returnStack.size()) {
-      returnStack.pop();
-    } else {
-      builder->CreateBr(mergeBB);
-    }
+    builder->CreateBr(mergeBB);
   }
 
   function->insert(function->end(), mergeBB);
@@ -428,34 +631,15 @@ void Codegen::visitWhileStmt(const WhileStmtPtr &stmt) {
 
   builder->SetInsertPoint(loopBB);
   visitStmt(stmt->body);
-  if (returnStack.size()) {
-    returnStack.pop();
-  } else {
-    builder->CreateBr(conditionBB);
-  }
+  builder->CreateBr(conditionBB);
 
   builder->SetInsertPoint(afterBB);
 }
 
 void Codegen::visitPrintStmt(const PrintStmtPtr &stmt) {
-  Value *val = visitExpr(stmt->value);
-  BasicBlock *insertBB = builder->GetInsertBlock();
-  Function *func_printf = module->getFunction("printf");
-
-  if (!func_printf) {
-    std::vector<llvm::Type *> params = {llvm::PointerType::get(*context, 0),
-                                        intType};
-    FunctionType *funcType = FunctionType::get(intType, params, false);
-    func_printf = Function::Create(funcType, Function::ExternalLinkage,
-                                   "printf", module.get());
-    func_printf->setCallingConv(CallingConv::C);
-  }
-
-  Value *str = builder->CreateGlobalStringPtr("%d\n");
-  std::vector<llvm::Value *> call_params;
-  call_params.push_back(str);
-  call_params.push_back(val);
-  CallInst::Create(func_printf, call_params, "calltmp", insertBB);
+  // Comparisons produce i1, which is printed as 0 or 1
+  Value *val = builder->CreateZExt(visitExpr(stmt->value), intType);
+  builder->CreateCall(getRuntimePrint(*module), {val});
 }
 
 void Codegen::visitExprStmt(const ExprStmtPtr &stmt) {
@@ -463,6 +647,12 @@ void Codegen::visitExprStmt(const ExprStmtPtr &stmt) {
 }
 
 void Codegen::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  // Programs the IR expresses are generated from it, the rest from the AST
+  if (auto program = IR::compile(stmt, flags->getOptimizationLevel())) {
+    lower(*program);
+    return;
+  }
+
   FunctionType *FT = FunctionType::get(llvm::Type::getInt32Ty(*context),
                                        std::vector<llvm::Type *>{}, false);
   Function *F =
@@ -470,31 +660,170 @@ void Codegen::visitFunctionStmt(const FunctionStmtPtr &stmt) {
   BasicBlock *BB = BasicBlock::Create(*context, "", F);
   builder->SetInsertPoint(BB);
 
-  for (const auto &stmt : stmt->body) {
-    visitStmt(stmt);
-  }
+  envManager.withNewFrame(stmt->slotsCount, [&] {
+    for (const auto &stmt : stmt->body) {
+      visitStmt(stmt);
+    }
+  });
 
+  // Output of the runtime is buffered until the program ends
+  builder->CreateCall(getRuntimeFlush(*module), {});
   builder->CreateRet(ConstantInt::get(intType, 0));
 }
 
 void Codegen::visitBlockStmt(const BlockStmtPtr &stmt) {
-  envManager.withNewEnviron([&] {
+  envManager.withNewFrame(stmt->slotsCount, [&] {
     for (const auto &stmt : stmt->statements) {
       visitStmt(stmt);
     }
   });
 }
 
+// Returns leave the innermost scope expression, function bodies included,
+// as in the interpreter
 void Codegen::visitReturnStmt(const ReturnStmtPtr &stmt) {
-  auto returnValue = visitExpr(stmt->retValue);
-  if (stmt->isFunction) {
-    builder->CreateRet(returnValue);
-  }
-  returnStack.push({returnValue, stmt->isFunction});
+  if (scopeExits.empty())
+    throw reportRuntimeError(logger, stmt->retToken,
+                             "Can't return from top-level code");
+  auto *returnValue = visitExpr(stmt->retValue);
+  auto &exit = scopeExits.back();
+  exit.returns.push_back(
+      {returnValue, builder->GetInsertBlock(), &stmt->retToken});
+  builder->CreateBr(exit.block);
+  // Statements after the return are dead, but still need a block to live in
+  builder->SetInsertPoint(BasicBlock::Create(
+      *context, "afterret", builder->GetInsertBlock()->getParent()));
 }
 
 void Codegen::visitNullStmt(const NullStmtPtr &stmt) {}
 
+void Codegen::lower(const IR::Module &program) {
+  std::unordered_map<const IR::Function *, Function *> lowered;
+  for (const auto &function : program.functions) {
+    bool isMain = function == program.functions.front();
+    std::vector<llvm::Type *> argTypes(function->paramsCount, intType);
+    FunctionType *ftype = FunctionType::get(intType, argTypes, false);
+    lowered[function.get()] =
+        Function::Create(ftype, Function::ExternalLinkage,
+                         isMain ? "main" : function->name, module.get());
+  }
+
+  for (const auto &function : program.functions) {
+    bool isMain = function == program.functions.front();
+    Function *F = lowered[function.get()];
+    std::vector<BasicBlock *> blocks;
+    for (const auto &block : function->blocks)
+      blocks.push_back(
+          BasicBlock::Create(*context, blocks.empty() ? "entry" : "", F));
+
+    // Blocks come after their dominators, so operands are generated before
+    // their users. Phis get their operands once every block is generated
+    std::vector<Value *> values(function->values.size());
+    std::vector<const IR::Instruction *> phis;
+    // Checked divisions split blocks, phis come from where a block ends
+    std::vector<BasicBlock *> ends(blocks.size());
+    auto get = [&](size_t index, const IR::Instruction &instr) {
+      return values[instr.operands[index]->id];
+    };
+    for (const auto &block : function->blocks) {
+      builder->SetInsertPoint(blocks[block->id]);
+      for (const auto *instr : block->instructions) {
+        Value *value = nullptr;
+        switch (instr->op) {
+        case IR::Opcode::CONST:
+          value = ConstantInt::get(intType, instr->imm, true);
+          break;
+        case IR::Opcode::PARAM:
+          value = F->getArg(instr->imm);
+          break;
+        case IR::Opcode::INPUT:
+          value = builder->CreateCall(getRuntimeInput(*module), {}, "inputres");
+          break;
+        case IR::Opcode::NEG:
+          value = builder->CreateNSWNeg(get(0, *instr));
+          break;
+        case IR::Opcode::ADD:
+          value = builder->CreateAdd(get(0, *instr), get(1, *instr), "addtmp");
+          break;
+        case IR::Opcode::SUB:
+          value = builder->CreateSub(get(0, *instr), get(1, *instr), "subtmp");
+          break;
+        case IR::Opcode::MUL:
+          value = builder->CreateMul(get(0, *instr), get(1, *instr), "multmp");
+          break;
+        case IR::Opcode::DIV:
+          value = divide(get(0, *instr), get(1, *instr), *instr->token);
+          break;
+        case IR::Opcode::EQ:
+        case IR::Opcode::NE:
+        case IR::Opcode::LT:
+        case IR::Opcode::LE:
+        case IR::Opcode::GT:
+        case IR::Opcode::GE: {
+          static constexpr CmpInst::Predicate predicates[] = {
+              CmpInst::ICMP_EQ,  CmpInst::ICMP_NE,  CmpInst::ICMP_SLT,
+              CmpInst::ICMP_SLE, CmpInst::ICMP_SGT, CmpInst::ICMP_SGE};
+          auto predicate = predicates[static_cast<int>(instr->op) -
+                                      static_cast<int>(IR::Opcode::EQ)];
+          // Values are ints, comparisons too
+          value = builder->CreateZExt(
+              builder->CreateICmp(predicate, get(0, *instr), get(1, *instr)),
+              intType);
+          break;
+        }
+        case IR::Opcode::CALL: {
+          std::vector<Value *> args;
+          for (const auto *arg : instr->operands)
+            args.push_back(values[arg->id]);
+          value =
+              builder->CreateCall(lowered.at(instr->callee), args, "calltmp");
+          break;
+        }
+        case IR::Opcode::PHI:
+          value = builder->CreatePHI(intType, block->preds.size());
+          phis.push_back(instr);
+          break;
+        case IR::Opcode::COPY:
+          value = get(0, *instr);
+          break;
+        case IR::Opcode::PRINT:
+          builder->CreateCall(getRuntimePrint(*module), {get(0, *instr)});
+          break;
+        case IR::Opcode::JMP:
+          builder->CreateBr(blocks[instr->targets[0]->id]);
+          break;
+        case IR::Opcode::BR:
+          builder->CreateCondBr(
+              builder->CreateICmpNE(get(0, *instr),
+                                    ConstantInt::get(intType, 0)),
+              blocks[instr->targets[0]->id], blocks[instr->targets[1]->id]);
+          break;
+        case IR::Opcode::RET:
+          if (isMain) {
+            // Output of the runtime is buffered until the program ends
+            builder->CreateCall(getRuntimeFlush(*module), {});
+            builder->CreateRet(ConstantInt::get(intType, 0));
+          } else {
+            builder->CreateRet(get(0, *instr));
+          }
+          break;
+        default:
+          break;
+        }
+        values[instr->id] = value;
+      }
+      ends[block->id] = builder->GetInsertBlock();
+    }
+
+    for (const auto *phi : phis) {
+      auto *node = cast<PHINode>(values[phi->id]);
+      for (size_t i = 0; i != phi->operands.size(); ++i)
+        node->addIncoming(values[phi->operands[i]->id],
+                          ends[phi->parent->preds[i]->id]);
+    }
+  }
+}
+
 AllocaInst *Codegen::allocVar(std::string_view name) {
   BasicBlock *insertBB = builder->GetInsertBlock();
   Function *func = insertBB->getParent();
@@ -505,23 +834,26 @@ AllocaInst *Codegen::allocVar(std::string_view name) {
   return inst;
 }
 
-AllocaInst *Codegen::getAllocVar(const Token &ident) {
-  if (envManager.contains(ident))
-    return cast<AllocaInst>(envManager.get(ident));
+AllocaInst *Codegen::getAllocVar(const Token &ident, const Binding &binding) {
+  if (envManager.contains(binding))
+    return cast<AllocaInst>(envManager.get(ident, binding));
   return nullptr;
 }
 
-Function *Codegen::getFunction(const Token &ident) {
-  if (envManager.contains(ident) && isa<Function>(envManager.get(ident)))
-    return cast<Function>(envManager.get(ident));
+Function *Codegen::getFunction(const Token &ident,
+                               const std::optional<Binding> &binding) {
+  if (binding && envManager.contains(*binding) &&
+      isa<Function>(envManager.get(ident, *binding)))
+    return cast<Function>(envManager.get(ident, *binding));
   return nullptr;
 }
 
-AllocaInst *Codegen::getOrCreateAllocVar(const Token &variable) {
-  if (auto res = getAllocVar(variable))
+AllocaInst *Codegen::getOrCreateAllocVar(const Token &variable,
+                                         const Binding &binding) {
+  if (auto res = getAllocVar(variable, binding))
     return res;
   auto inst = allocVar(variable.getLexeme());
-  envManager.define(variable, inst);
+  envManager.define(binding, inst);
   return inst;
 }
 
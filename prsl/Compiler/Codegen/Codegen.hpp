@@ -3,9 +3,9 @@
 #include "prsl/AST/ASTVisitor.hpp"
 #include "prsl/AST/NodeTypes.hpp"
 #include "prsl/Compiler/Common/Environment.hpp"
-#include "prsl/Compiler/Common/FunctionsManager.hpp"
 #include "prsl/Compiler/CompilerFlags.hpp"
 #include "prsl/Debug/Logger.hpp"
+#include "prsl/IR/IR.hpp"
 #include "prsl/Parser/Token.hpp"
 
 #include "llvm/IR/Function.h"
@@ -13,11 +13,15 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Target/TargetMachine.h>
 
 #include <filesystem>
-#include <stack>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace prsl::Codegen {
 
@@ -30,61 +34,117 @@ using Errors::Logger;
 using Types::Token;
 using Type = Types::Token::Type;
 
-class Codegen : public ASTVisitor<Value *> {
+// Replaces the "native" CPU and features with the ones of the host
+void resolveNativeTarget(Compiler::CompilerFlags &flags);
+
+// Runs the default optimization pipeline of the level, tuned for the target
+void optimize(Module &module, Compiler::OptimizationLevel level,
+              TargetMachine *targetMachine);
+
+// File Codegen::dump writes for the output path, with the extension of the type
+std::filesystem::path getOutputFile(const std::filesystem::path &path,
+                                    Compiler::OutputFileType type);
+
+// Everything besides the program that the file written by Codegen::dump to
+// the output path depends on. The source name is the one diagnostics give
+std::string describeOutput(const Compiler::CompilerFlags &flags,
+                           const std::filesystem::path &path,
+                           std::string_view sourceName);
+
+class Codegen : public ASTVisitor<Codegen, Value *> {
 public:
   explicit Codegen(Compiler::CompilerFlags *flags, Logger &logger);
   bool dump(const std::filesystem::path &path) const;
 
+  // Hands the generated module over together with its context, e.g. to a
+  // JIT, which optimizes it itself. The generator must not be used afterwards
+  orc::ThreadSafeModule takeModule();
+
+  // Generates the function and everything it calls, if not generated yet
+  Function *emitFunction(const FuncExpr &expr);
+  // Generates an externally visible wrapper, taking the arguments of the
+  // function as an array of ints, so it can be called with any arity.
+  // Returns nullptr if the function can't be compiled to valid code
+  Function *emitEntryPoint(const FuncExpr &expr, std::string_view name);
+  // Generates the loop as a function taking the variables it uses from the
+  // frames around it as an array. They are read on entry and written back on
+  // exit, so the loop can take over from the interpreter in the middle of
+  // its execution. Returns nullptr if it can't be compiled to valid code
+  Function *emitLoop(const WhileStmtPtr &loop,
+                     const std::vector<Binding> &variables,
+                     std::string_view name);
+
 private:
-  Value *visitLiteralExpr(const LiteralExprPtr &expr) override;
-  Value *visitGroupingExpr(const GroupingExprPtr &expr) override;
-  Value *visitVarExpr(const VarExprPtr &expr) override;
-  Value *visitInputExpr(const InputExprPtr &expr) override;
-  Value *visitAssignmentExpr(const AssignmentExprPtr &expr) override;
-  Value *visitUnaryExpr(const UnaryExprPtr &expr) override;
-  Value *visitBinaryExpr(const BinaryExprPtr &expr) override;
-  Value *visitPostfixExpr(const PostfixExprPtr &expr) override;
-  Value *visitScopeExpr(const ScopeExprPtr &stmt) override;
-  Value *visitFuncExpr(const FuncExprPtr &expr) override;
-  Value *visitCallExpr(const CallExprPtr &expr) override;
-
-  void visitVarStmt(const VarStmtPtr &stmt) override;
-  void visitIfStmt(const IfStmtPtr &stmt) override;
-  void visitWhileStmt(const WhileStmtPtr &stmt) override;
-  void visitPrintStmt(const PrintStmtPtr &stmt) override;
-  void visitExprStmt(const ExprStmtPtr &stmt) override;
-  void visitFunctionStmt(const FunctionStmtPtr &stmt) override;
-  void visitBlockStmt(const BlockStmtPtr &stmt) override;
-  void visitReturnStmt(const ReturnStmtPtr &stmt) override;
-  void visitNullStmt(const NullStmtPtr &stmt) override;
+  friend ASTVisitor;
+
+  Value *visitLiteralExpr(const LiteralExprPtr &expr);
+  Value *visitGroupingExpr(const GroupingExprPtr &expr);
+  Value *visitVarExpr(const VarExprPtr &expr);
+  Value *visitInputExpr(const InputExprPtr &expr);
+  Value *visitAssignmentExpr(const AssignmentExprPtr &expr);
+  Value *visitUnaryExpr(const UnaryExprPtr &expr);
+  Value *visitBinaryExpr(const BinaryExprPtr &expr);
+  Value *visitPostfixExpr(const PostfixExprPtr &expr);
+  Value *visitScopeExpr(const ScopeExprPtr &stmt);
+  Value *visitFuncExpr(const FuncExprPtr &expr);
+  Value *visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitIfStmt(const IfStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitPrintStmt(const PrintStmtPtr &stmt);
+  void visitExprStmt(const ExprStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
+  void visitNullStmt(const NullStmtPtr &stmt);
+
+  // Generates the program from its IR, main first
+  void lower(const IR::Module &program);
 
   Value *postfixExpr(const Token &op, Value *obj, Value *res);
   AllocaInst *allocVar(std::string_view name);
-  AllocaInst *getOrCreateAllocVar(const Token &variable);
-  AllocaInst *getAllocVar(const Token &ident);
-  Function *getFunction(const Token &ident);
+  AllocaInst *getOrCreateAllocVar(const Token &variable,
+                                  const Binding &binding);
+  AllocaInst *getAllocVar(const Token &ident, const Binding &binding);
+  Function *getFunction(const Token &ident,
+                        const std::optional<Binding> &binding);
+  // Generates the statements of the scope, leaving the insertion point
+  // where its returns meet. Returns the value of the scope
   Value *evaluateScope(const ScopeExprPtr &stmt);
+  // Zero-extends results of comparisons, functions can't be converted
+  Value *toInt(Value *value, const Token &token);
+  // Divides, failing as the interpreter does on a zero divisor, which sdiv
+  // would leave undefined
+  Value *divide(Value *lhs, Value *rhs, const Token &op);
+  Function *finishEntryPoint(Function *entry);
 
   void initOpt() const;
 
   Compiler::CompilerFlags *flags{nullptr};
   Compiler::OutputFileType type;
-  mutable llvm::PassBuilder passBuilder;
-  llvm::OptimizationLevel optLevel;
-  llvm::TargetMachine *targetMachine{nullptr};
+  std::unique_ptr<llvm::TargetMachine> targetMachine;
 
   Logger &logger;
   std::unique_ptr<LLVMContext> context;
   std::unique_ptr<IRBuilder<>> builder;
   std::unique_ptr<Module> module;
   Types::EnvironmentManager<Value *> envManager;
-  Types::FunctionsManager<Function *> functionsManager;
+  std::unordered_map<const FuncExpr *, Function *> functions;
   llvm::Type *intType;
-  struct RetVal {
+  struct Return {
     Value *value;
-    bool isFunction;
+    BasicBlock *block;
+    // Nullptr for the end of the scope
+    const Token *token;
+  };
+  // Scope expressions being generated, innermost last, with the block their
+  // returns branch to
+  struct ScopeExit {
+    BasicBlock *block;
+    std::vector<Return> returns;
   };
-  std::stack<RetVal> returnStack;
+  std::vector<ScopeExit> scopeExits;
 };
 
 } // namespace prsl::Codegen
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "prsl/Compiler/Codegen/Multiversioning.hpp"
+
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace prsl::Codegen {
+
+using namespace llvm;
+
+namespace {
+
+// Bits of __cpu_model.__cpu_features, which __cpu_indicator_init of libgcc
+// and compiler-rt fills in. The same ABI backs __builtin_cpu_supports
+enum CPUFeature : unsigned {
+  POPCNT = 2,
+  SSE3 = 5,
+  SSSE3 = 6,
+  SSE4_1 = 7,
+  SSE4_2 = 8,
+  AVX = 9,
+  AVX2 = 10,
+  FMA = 14,
+  AVX512F = 15,
+  BMI = 16,
+  BMI2 = 17,
+  AVX512VL = 20,
+  AVX512BW = 21,
+  AVX512DQ = 22,
+  AVX512CD = 23,
+};
+
+constexpr uint32_t mask(std::initializer_list<CPUFeature> features) {
+  uint32_t res = 0;
+  for (auto feature : features)
+    res |= uint32_t{1} << feature;
+  return res;
+}
+
+struct Level {
+  const char *cpu;
+  const char *suffix;
+  // Features the running CPU must have for the level to be picked
+  uint32_t features;
+};
+
+constexpr uint32_t v2 = mask({POPCNT, SSE3, SSSE3, SSE4_1, SSE4_2});
+constexpr uint32_t v3 = v2 | mask({AVX, AVX2, FMA, BMI, BMI2});
+constexpr uint32_t v4 =
+    v3 | mask({AVX512F, AVX512VL, AVX512BW, AVX512DQ, AVX512CD});
+
+// Best first, the resolver picks the first one supported
+constexpr std::array<Level, 3> levels{{
+    {"x86-64-v4", "v4", v4},
+    {"x86-64-v3", "v3", v3},
+    {"x86-64-v2", "v2", v2},
+}};
+
+// Reads the features of the running CPU. Resolvers run while the program is
+// being relocated, before any constructor, so the features are initialized
+// explicitly
+Function *getFeaturesReader(Module &module) {
+  auto &context = module.getContext();
+  auto *intType = Type::getInt32Ty(context);
+  auto *modelType = StructType::get(
+      context, {intType, intType, intType, ArrayType::get(intType, 1)});
+
+  auto *init = module.getOrInsertFunction("__cpu_indicator_init",
+                                          Type::getVoidTy(context))
+                   .getCallee();
+  auto *model = module.getOrInsertGlobal("__cpu_model", modelType);
+
+  auto *reader =
+      Function::Create(FunctionType::get(intType, false),
+                       Function::InternalLinkage, "prsl.cpu.features", module);
+  IRBuilder<> builder(BasicBlock::Create(context, "entry", reader));
+  builder.CreateCall(FunctionType::get(Type::getVoidTy(context), false), init);
+  auto *features = builder.CreateConstInBoundsGEP2_32(modelType, model, 0, 3);
+  builder.CreateRet(builder.CreateLoad(intType, features, "features"));
+  return reader;
+}
+
+Function *createResolver(Module &module, Function *reader, const Twine &name,
+                         Function *fallback,
+                         const std::array<Function *, levels.size()> &clones) {
+  auto &context = module.getContext();
+  auto *ptrType = PointerType::get(context, 0);
+  auto *resolver = Function::Create(FunctionType::get(ptrType, false),
+                                    Function::InternalLinkage, name, module);
+  IRBuilder<> builder(BasicBlock::Create(context, "entry", resolver));
+
+  Value *features = builder.CreateCall(reader);
+  // Worst first, so that the best supported level wins the select chain
+  Value *res = fallback;
+  for (size_t i = levels.size(); i-- != 0;) {
+    auto *required = builder.getInt32(levels[i].features);
+    auto *supported =
+        builder.CreateICmpEQ(builder.CreateAnd(features, required), required);
+    res = builder.CreateSelect(supported, clones[i], res);
+  }
+  builder.CreateRet(res);
+  return resolver;
+}
+
+} // namespace
+
+bool supportsMultiversioning(const Triple &triple) {
+  return triple.getArch() == Triple::x86_64 && triple.isOSBinFormatELF();
+}
+
+void multiversion(Module &module) {
+  std::vector<Function *> functions;
+  for (auto &func : module)
+    if (!func.isDeclaration() && func.getName() != "main")
+      functions.push_back(&func);
+  if (functions.empty())
+    return;
+
+  std::unordered_set<const Function *> versions(functions.begin(),
+                                                functions.end());
+  std::vector<std::array<Function *, levels.size()>> clones(functions.size());
+  for (size_t level = 0; level != levels.size(); ++level) {
+    // Map every function first, so calls between clones of the level
+    // are redirected while cloning
+    ValueToValueMapTy map;
+    for (size_t i = 0; i != functions.size(); ++i) {
+      auto *func = functions[i];
+      auto *clone = Function::Create(
+          func->getFunctionType(), Function::InternalLinkage,
+          func->getName() + "." + levels[level].suffix, module);
+      clones[i][level] = clone;
+      versions.insert(clone);
+      map[func] = clone;
+    }
+
+    for (size_t i = 0; i != functions.size(); ++i) {
+      auto *func = functions[i];
+      auto *clone = clones[i][level];
+      auto cloneArgs = clone->arg_begin();
+      for (auto &arg : func->args())
+        map[&arg] = &*cloneArgs++;
+
+      SmallVector<ReturnInst *, 4> returns;
+      CloneFunctionInto(clone, func, map,
+                        CloneFunctionChangeType::LocalChangesOnly, returns);
+      // Cloning copies the attributes of the original over. Features of the
+      // target machine, e.g. the native ones, must not leak into the level
+      clone->addFnAttr("target-cpu", levels[level].cpu);
+      clone->addFnAttr("target-features", "");
+    }
+  }
+
+  auto *reader = getFeaturesReader(module);
+  for (size_t i = 0; i != functions.size(); ++i) {
+    auto *func = functions[i];
+    std::string name = func->getName().str();
+    func->setName(name + ".default");
+    func->setLinkage(Function::InternalLinkage);
+
+    auto *resolver =
+        createResolver(module, reader, name + ".resolver", func, clones[i]);
+    versions.insert(resolver);
+    auto *ifunc =
+        GlobalIFunc::create(func->getFunctionType(), 0,
+                            Function::ExternalLinkage, name, resolver, &module);
+
+    // Versions keep calling each other directly, and resolvers return them
+    func->replaceUsesWithIf(ifunc, [&](Use &use) {
+      auto *inst = dyn_cast<Instruction>(use.getUser());
+      return inst && !versions.count(inst->getFunction());
+    });
+  }
+}
+
+} // namespace prsl::Codegen
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/TargetParser/Triple.h>
+
+namespace prsl::Codegen {
+
+// Whether multiversion can be applied to modules of the target
+bool supportsMultiversioning(const llvm::Triple &triple);
+
+// Compiles every function of the module except main for the x86-64-v2, v3 and
+// v4 microarchitecture levels besides the target CPU. Calls from main go
+// through an ifunc whose resolver picks the best level the running CPU
+// supports, once, when the program is loaded. Versions of a level call each
+// other directly, so they can still be inlined into one another. Must run
+// before the module is optimized, so the optimizer sees the levels
+void multiversion(llvm::Module &module);
+
+} // namespace prsl::Codegen
@@ -0,0 +1,106 @@
+#include "prsl/Compiler/Codegen/Runtime.hpp"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+
+namespace prsl::Codegen {
+
+using namespace llvm;
+
+namespace {
+
+#ifdef PRSL_RUNTIME_BITCODE
+// Generated from prsl/Runtime/prslrt.c by the build
+constexpr unsigned char bitcode[] = {
+#include "prslrt.bc.inc"
+};
+#endif
+
+Function *getRuntimeFunction(Module &module, StringRef name,
+                             FunctionType *type) {
+  auto *func =
+      cast<Function>(module.getOrInsertFunction(name, type).getCallee());
+  func->setDoesNotThrow();
+  return func;
+}
+
+} // namespace
+
+Function *getRuntimePrint(Module &module) {
+  auto &context = module.getContext();
+  return getRuntimeFunction(module, "prslrt_print",
+                            FunctionType::get(Type::getVoidTy(context),
+                                              {Type::getInt32Ty(context)},
+                                              false));
+}
+
+Function *getRuntimeInput(Module &module) {
+  return getRuntimeFunction(
+      module, "prslrt_input",
+      FunctionType::get(Type::getInt32Ty(module.getContext()), false));
+}
+
+Function *getRuntimeFlush(Module &module) {
+  return getRuntimeFunction(
+      module, "prslrt_flush",
+      FunctionType::get(Type::getVoidTy(module.getContext()), false));
+}
+
+Function *getRuntimeFail(Module &module) {
+  auto &context = module.getContext();
+  auto *ptrType = PointerType::get(context, 0);
+  auto *int32Type = Type::getInt32Ty(context);
+  auto *func = getRuntimeFunction(
+      module, "prslrt_fail",
+      FunctionType::get(Type::getVoidTy(context),
+                        {ptrType, int32Type, int32Type, ptrType}, false));
+  func->setDoesNotReturn();
+  func->addFnAttr(Attribute::Cold);
+  return func;
+}
+
+bool linkRuntime(Module &module) {
+#ifdef PRSL_RUNTIME_BITCODE
+  MemoryBufferRef buffer(
+      StringRef(reinterpret_cast<const char *>(bitcode), sizeof(bitcode)),
+      "prslrt.bc");
+  auto runtime = parseBitcodeFile(buffer, module.getContext());
+  if (!runtime) {
+    consumeError(runtime.takeError());
+    return false;
+  }
+
+  // The bitcode is compiled for the host, its types and calls to libc are
+  // only right for the same architecture and operating system
+  Triple host((*runtime)->getTargetTriple());
+  Triple target(module.getTargetTriple());
+  if (host.getArch() != target.getArch() || host.getOS() != target.getOS())
+    return false;
+
+  (*runtime)->setTargetTriple(module.getTargetTriple());
+  (*runtime)->setDataLayout(module.getDataLayout());
+  // Functions are compiled for the CPU of the program instead, otherwise
+  // they could not be inlined into it
+  for (auto &func : **runtime) {
+    func.removeFnAttr("target-cpu");
+    func.removeFnAttr("target-features");
+    func.removeFnAttr("tune-cpu");
+  }
+
+  return !Linker::linkModules(
+      module, std::move(*runtime), Linker::Flags::LinkOnlyNeeded,
+      [](Module &program, const StringSet<> &linked) {
+        internalizeModule(program, [&](const GlobalValue &value) {
+          return !value.hasName() || !linked.count(value.getName());
+        });
+      });
+#else
+  return false;
+#endif
+}
+
+} // namespace prsl::Codegen
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+namespace prsl::Codegen {
+
+// Functions of prslrt, the runtime library of compiled programs. Code run in
+// process gets them from the JIT instead, which shares the output of prsl
+llvm::Function *getRuntimePrint(llvm::Module &module);
+llvm::Function *getRuntimeInput(llvm::Module &module);
+llvm::Function *getRuntimeFlush(llvm::Module &module);
+// Reports an error of the program at a position of its source and exits
+llvm::Function *getRuntimeFail(llvm::Module &module);
+
+// Links the bitcode of prslrt, built together with prsl, into the module and
+// internalizes it, so its functions can be inlined into the program. Returns
+// false if prsl was built without the bitcode or the bitcode is for another
+// target, then the program has to be linked with libprslrt
+bool linkRuntime(llvm::Module &module);
+
+} // namespace prsl::Codegen
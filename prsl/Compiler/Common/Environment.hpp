@@ -1,12 +1,15 @@
 #pragma once
 
+#include "prsl/AST/NodeTypes.hpp"
 #include "prsl/Debug/Errors.hpp"
 #include "prsl/Debug/Logger.hpp"
 #include "prsl/Parser/Token.hpp"
 
 #include <exception>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 
 namespace prsl::Types {
 
@@ -28,8 +31,8 @@ public:
       : parentEnv(std::move(parentEnv)) {}
 
   void assign(const Types::Token &token, VarValue object) {
-    if (objects.contains(token)) {
-      objects.insert_or_assign(token, std::move(object));
+    if (auto it = objects.find(token); it != objects.end()) {
+      it->second.value = std::move(object);
       return;
     }
     if (parentEnv != nullptr) {
@@ -41,16 +44,22 @@ public:
 
   void defineOrAssign(const Types::Token &token, VarValue object) {
     if (!contains(token)) {
-      objects.insert_or_assign(token, std::move(object));
+      objects.insert_or_assign(token, Entry{std::move(object), slotsCount++});
       return;
     }
 
     assign(token, std::move(object));
   }
 
+  // Parameters always get their own slot, in order, even if a name repeats.
+  // The last parameter with a given name is the one visible in the body
+  void defineParameter(const Types::Token &token, VarValue object) {
+    objects.insert_or_assign(token, Entry{std::move(object), slotsCount++});
+  }
+
   VarValue get(const Types::Token &token) const {
     if (objects.contains(token)) {
-      return objects.at(token);
+      return objects.at(token).value;
     }
     if (parentEnv != nullptr) {
       return parentEnv->get(token);
@@ -59,6 +68,18 @@ public:
     throw UndefVarAccess{};
   }
 
+  // Finds how many environments up the variable is defined and its slot there.
+  // Slots are numbered in order of definition within each environment
+  std::optional<AST::Binding> resolve(const Types::Token &token) const {
+    unsigned depth = 0;
+    for (const Environment *env = this; env != nullptr;
+         env = env->parentEnv.get(), ++depth) {
+      if (auto it = env->objects.find(token); it != env->objects.end())
+        return AST::Binding{depth, it->second.slot};
+    }
+    return std::nullopt;
+  }
+
   bool contains(const Types::Token &token) const noexcept {
     auto res = objects.contains(token);
     if (!res && parentEnv != nullptr) {
@@ -68,12 +89,20 @@ public:
     return res;
   }
 
+  unsigned getSlotsCount() const noexcept { return slotsCount; }
+
   EnvironmentPtr getParentEnv() const noexcept { return parentEnv; }
 
   bool isGlobal() const noexcept { return parentEnv == nullptr; }
 
 private:
-  std::unordered_map<Token, VarValue> objects;
+  struct Entry {
+    VarValue value;
+    unsigned slot;
+  };
+
+  std::unordered_map<Token, Entry> objects;
+  unsigned slotsCount{0};
   EnvironmentPtr parentEnv = nullptr;
 };
 
@@ -114,6 +143,10 @@ public:
     curEnv->defineOrAssign(token, std::move(object));
   }
 
+  void defineParameter(const Types::Token &token, VarValue object) {
+    curEnv->defineParameter(token, std::move(object));
+  }
+
   VarValue get(const Types::Token &token) const {
     try {
       return curEnv->get(token);
@@ -130,7 +163,86 @@ public:
     return curEnv->contains(token);
   }
 
+  std::optional<AST::Binding> resolve(const Types::Token &token) const {
+    return curEnv->resolve(token);
+  }
+
+  unsigned slotsCount() const noexcept { return curEnv->getSlotsCount(); }
+
+  // Indexed-frame mode. Variables are addressed by the bindings computed by
+  // Semantics, so accesses neither hash names nor walk parent environments.
+  // Frames mirror the environments Semantics created: one per scope and one
+  // for each call. They live back to back in a single stack that is reused
+  // for the whole run, so entering a frame does not allocate once the stack
+  // has grown to the depth of the program
+
+  template <typename F> void withNewFrame(unsigned slotsCount, F &&action) {
+    withNewFrame(slots.size(), slotsCount, std::forward<F>(action));
+  }
+
+  // Enters a frame starting at base. Arguments pushed with pushArgument since
+  // base are already in place as the first slots of the frame
+  template <typename F>
+  void withNewFrame(size_t base, unsigned slotsCount, F &&action) {
+    frames.push_back(base);
+    slots.resize(base + slotsCount);
+    action();
+    slots.resize(base);
+    frames.pop_back();
+  }
+
+  size_t getTop() const noexcept { return slots.size(); }
+
+  void pushArgument(VarValue object) { slots.emplace_back(std::move(object)); }
+
+  // Argument pushed with pushArgument, index is absolute like getTop
+  const VarValue &getArgument(size_t index) const noexcept {
+    return *slots[index];
+  }
+
+  // Drops the arguments pushed since base without entering a frame
+  void popArguments(size_t base) { slots.resize(base); }
+
+  void assign(const Types::Token &token, const AST::Binding &binding,
+              VarValue object) {
+    auto &value = slot(binding);
+    if (!value)
+      throw Errors::reportRuntimeError(logger, token,
+                                       "Attempt to access an undef variable");
+    value = std::move(object);
+  }
+
+  void define(const AST::Binding &binding, VarValue object) {
+    slot(binding) = std::move(object);
+  }
+
+  VarValue get(const Types::Token &token, const AST::Binding &binding) const {
+    const auto &value = slot(binding);
+    if (!value)
+      throw Errors::reportRuntimeError(logger, token,
+                                       "Attempt to access an undef variable");
+    return *value;
+  }
+
+  bool contains(const AST::Binding &binding) const noexcept {
+    return slot(binding).has_value();
+  }
+
+  const std::optional<VarValue> &
+  find(const AST::Binding &binding) const noexcept {
+    return slot(binding);
+  }
+
 private:
+  std::optional<VarValue> &slot(const AST::Binding &binding) noexcept {
+    return slots[frames[frames.size() - 1 - binding.depth] + binding.slot];
+  }
+
+  const std::optional<VarValue> &
+  slot(const AST::Binding &binding) const noexcept {
+    return slots[frames[frames.size() - 1 - binding.depth] + binding.slot];
+  }
+
   void createNewEnv() {
     curEnv = std::make_shared<Environment<VarValue>>(curEnv);
   }
@@ -145,6 +257,9 @@ private:
 private:
   Logger &logger;
   Environment<VarValue>::EnvironmentPtr curEnv;
+  std::vector<std::optional<VarValue>> slots;
+  // Index of the first slot of each frame
+  std::vector<size_t> frames;
 };
 
 }; // namespace prsl::Types
\ No newline at end of file
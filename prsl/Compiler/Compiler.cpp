@@ -1,24 +1,76 @@
 #include "prsl/Compiler/Compiler.hpp"
+#include "prsl/AST/Printer.hpp"
+#include "prsl/Compiler/Cache/DiskCache.hpp"
 #include "prsl/Compiler/Codegen/Codegen.hpp"
 #include "prsl/Compiler/Executor.hpp"
 #include "prsl/Compiler/Interpreter/Interpreter.hpp"
+#include "prsl/Compiler/JIT/JIT.hpp"
+#include "prsl/Compiler/VM/VM.hpp"
 #include "prsl/Debug/Errors.hpp"
 #include "prsl/Debug/Logger.hpp"
+#include "prsl/IR/PassManager.hpp"
+#include "prsl/Optimizer/Optimizer.hpp"
+#include "prsl/Parser/ParallelScanner.hpp"
 #include "prsl/Parser/Parser.hpp"
 #include "prsl/Parser/Scanner.hpp"
+#include "prsl/Parser/TokenStream.hpp"
 #include "prsl/Semantics/Semantics.hpp"
+#include "prsl/Utils/Input.hpp"
+#include "prsl/Utils/LineTable.hpp"
+#include "prsl/Utils/Output.hpp"
 
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Threading.h>
+
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
 
 namespace prsl::Compiler {
 
-auto parse(std::string_view filename, std::string_view source,
+namespace {
+
+void setupOutput(FlushPolicy policy) {
+  auto &output = Utils::Output::get();
+  switch (policy) {
+  case FlushPolicy::AUTO:
+    output.setLineBuffered(llvm::sys::Process::StandardOutIsDisplayed());
+    break;
+  case FlushPolicy::LINE:
+    output.setLineBuffered(true);
+    break;
+  case FlushPolicy::SIZE:
+    break;
+  case FlushPolicy::EXIT:
+    output.setThreshold(SIZE_MAX);
+    break;
+  }
+}
+
+} // namespace
+
+auto parse(std::string_view source, unsigned threads, prsl::AST::Arena &arena,
            prsl::Errors::Logger &logger) {
-  prsl::Scanner::Scanner scanner(filename, source);
-  auto tokens = scanner.tokenize();
-  prsl::Parser::Parser parser(tokens, logger);
+  if (!threads)
+    threads = source.size() >= prsl::Scanner::parallelThreshold
+                  ? llvm::hardware_concurrency().compute_thread_count()
+                  : 1;
+  // Parallel scanning gives all the tokens at once, otherwise the parser
+  // pulls them from the scanner one by one
+  if (threads > 1) {
+    auto tokens = prsl::Scanner::tokenizeParallel(source, threads);
+    prsl::Parser::Parser parser(prsl::Parser::TokenStream(tokens), arena,
+                                logger);
+    return parser.parse();
+  }
+  prsl::Scanner::Scanner scanner(source);
+  prsl::Parser::Parser parser(prsl::Parser::TokenStream(scanner), arena,
+                              logger);
   return parser.parse();
 }
 
@@ -28,26 +80,90 @@ auto resolve(const prsl::AST::StmtPtrVariant &stmt,
   resolver.visitStmt(stmt);
 }
 
+void optimize(prsl::AST::StmtPtrVariant &stmt, prsl::AST::Arena &arena,
+              const CompilerFlags &flags) {
+  auto level = flags.getOptimizationLevel();
+  if (level == OptimizationLevel::O0)
+    return;
+  prsl::Optimizer::Optimizer optimizer(arena, level, flags.getInlineBudget());
+  optimizer.run(stmt);
+}
+
 void Compiler::run(const fs::path &file) {
   auto inputPath = fs::absolute(file);
   auto executionMode = flags->getExecutionMode();
 
-  std::ifstream fstream{inputPath};
-  std::ostringstream sstr;
-  sstr << fstream.rdbuf();
-  auto source = sstr.str();
+  // Files are mapped into memory if they are large enough, "-" is stdin. The
+  // scanner stops at the end of the buffer, so it needs no NUL after it, which
+  // would make files of whole pages copied. The buffer outlives every token
+  auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(
+      file.string(), /*IsText=*/false, /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    logger.error(file.string(), buffer.getError().message());
+    return;
+  }
+  std::string_view source = (*buffer)->getBuffer();
+  // Tokens have 32-bit lengths and lines are found by 32-bit offsets
+  if (source.size() > UINT32_MAX) {
+    logger.error(file.string(),
+                 "Sources of 4 GiB and larger are not supported");
+    return;
+  }
+
+  // Diagnostics resolve the positions of tokens until the end of the run
+  auto fileName =
+      file == "-" ? std::string{"<stdin>"} : inputPath.filename().string();
+  Utils::LineTable lines(fileName, source);
+  logger.setLines(&lines);
+  auto resetLines = llvm::make_scope_exit([&] { logger.setLines(nullptr); });
 
-  std::unique_ptr<Executor> executor;
-  if (executionMode == ExecutionMode::COMPILE) {
-    executor =
-        std::move(Executor::Create<prsl::Codegen::Codegen>(flags, logger));
-  } else if (executionMode == ExecutionMode::INTERPRET) {
-    executor = std::move(
-        Executor::Create<prsl::Interpreter::Interpreter>(flags, logger));
+  if (executionMode == ExecutionMode::COMPILE)
+    prsl::Codegen::resolveNativeTarget(*flags);
+  if (!flags->getCacheDir().empty())
+    flags->setSourceHash(prsl::Cache::hash(source));
+
+  // Compiled files are cached by the source and the flags, a hit skips
+  // everything from scanning to code emission
+  auto outputPath = fs::absolute(flags->getOutputFile());
+  std::optional<prsl::Cache::DiskCache> cache;
+  std::string cacheKey;
+  if (executionMode == ExecutionMode::COMPILE &&
+      !flags->getCacheDir().empty()) {
+    cache.emplace(flags->getCacheDir(), flags->getCacheSizeLimit());
+    cacheKey = prsl::Cache::hash(
+        prsl::Codegen::describeOutput(*flags, outputPath, fileName) +
+        flags->getSourceHash());
+  }
+  auto reportCache = [&] {
+    if (cache && flags->getCacheStats())
+      cache->report(std::cerr);
+  };
+  auto outputFile =
+      prsl::Codegen::getOutputFile(outputPath, flags->getFileType());
+  if (cache && cache->restore(cacheKey, outputFile)) {
+    reportCache();
+    return;
   }
 
+  // The AST is freed at once after the executor that refers to it
+  prsl::AST::Arena arena;
+  // Creating an executor fails, e.g., on targets LLVM does not support
+  std::unique_ptr<Executor> executor;
   try {
-    auto stmt = parse(inputPath.filename().string(), source, logger);
+    if (executionMode == ExecutionMode::COMPILE) {
+      executor =
+          std::move(Executor::Create<prsl::Codegen::Codegen>(flags, logger));
+    } else if (executionMode == ExecutionMode::INTERPRET ||
+               executionMode == ExecutionMode::TIERED) {
+      executor = std::move(
+          Executor::Create<prsl::Interpreter::Interpreter>(flags, logger));
+    } else if (executionMode == ExecutionMode::VM) {
+      executor = std::move(Executor::Create<prsl::VM::VM>(flags, logger));
+    } else if (executionMode == ExecutionMode::JIT) {
+      executor = std::move(Executor::Create<prsl::JIT::JIT>(flags, logger));
+    }
+
+    auto stmt = parse(source, flags->getLexThreads(), arena, logger);
     if (logger.getErrorCount()) {
       return;
     }
@@ -55,15 +171,43 @@ void Compiler::run(const fs::path &file) {
     if (logger.getErrorCount()) {
       return;
     }
+    // Every mode gets the optimized AST
+    optimize(stmt, arena, *flags);
+    if (flags->getDumpAST()) {
+      prsl::AST::Printer printer(std::cout);
+      printer.visitStmt(stmt);
+      std::cout.flush();
+    }
+    if (flags->getDumpIR()) {
+      const auto &program = std::get<prsl::AST::FunctionStmtPtr>(stmt);
+      if (auto module =
+              prsl::IR::compile(program, flags->getOptimizationLevel()))
+        prsl::IR::print(*module, std::cout);
+      else
+        std::cout << "; the IR can't express the program, the modes run its "
+                     "AST\n";
+      std::cout.flush();
+    }
 
     if (executionMode != ExecutionMode::PARSE) {
-      auto outputPath = fs::absolute(flags->getOutputFile());
+      if (auto path = flags->getInputFile();
+          !path.empty() && executionMode != ExecutionMode::COMPILE) {
+        if (auto error = Utils::Input::get().open(path)) {
+          logger.error(path, error.message());
+          return;
+        }
+      }
+      setupOutput(flags->getFlushPolicy());
       executor->visitStmt(stmt);
-      executor->dump(outputPath);
+      // Before the reports of the run
+      Utils::Output::get().flush();
+      if (executor->dump(outputPath) && cache)
+        cache->storeFile(cacheKey, outputFile);
     }
   } catch (const prsl::Errors::RuntimeError &e) {
     std::ignore = e;
   }
+  reportCache();
 }
 
 } // namespace prsl::Compiler
\ No newline at end of file
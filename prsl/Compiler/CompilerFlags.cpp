@@ -14,6 +14,18 @@ void CompilerFlags::setTargetTriple(std::string target) {
 
 std::string CompilerFlags::getTragetTriple() const { return target; }
 
+void CompilerFlags::setTargetCPU(std::string cpu) {
+  this->cpu = std::move(cpu);
+}
+
+std::string CompilerFlags::getTargetCPU() const { return cpu; }
+
+void CompilerFlags::setTargetFeatures(std::string features) {
+  this->features = std::move(features);
+}
+
+std::string CompilerFlags::getTargetFeatures() const { return features; }
+
 void CompilerFlags::setFileType(OutputFileType type) { this->type = type; }
 
 OutputFileType CompilerFlags::getFileType() const { return type; }
@@ -36,6 +48,96 @@ void CompilerFlags::setExecutionMode(ExecutionMode mode) {
 
 ExecutionMode CompilerFlags::getExecutionMode() const { return executionMode; }
 
+void CompilerFlags::setFlushPolicy(FlushPolicy policy) {
+  this->flushPolicy = policy;
+}
+
+FlushPolicy CompilerFlags::getFlushPolicy() const { return flushPolicy; }
+
+void CompilerFlags::setLexThreads(unsigned threads) {
+  this->lexThreads = threads;
+}
+
+unsigned CompilerFlags::getLexThreads() const { return lexThreads; }
+
+void CompilerFlags::setInputFile(std::string file) {
+  this->inputFile = std::move(file);
+}
+
+std::string CompilerFlags::getInputFile() const { return inputFile; }
+
+void CompilerFlags::setMultiversioning(bool flag) {
+  this->multiversioning = flag;
+}
+
+bool CompilerFlags::getMultiversioning() const { return multiversioning; }
+
+void CompilerFlags::setLazyCompilation(bool flag) {
+  this->lazyCompilation = flag;
+}
+
+bool CompilerFlags::getLazyCompilation() const { return lazyCompilation; }
+
+void CompilerFlags::setTierThreshold(unsigned threshold) {
+  this->tierThreshold = threshold;
+}
+
+unsigned CompilerFlags::getTierThreshold() const { return tierThreshold; }
+
+void CompilerFlags::setTierStats(bool flag) { this->tierStats = flag; }
+
+bool CompilerFlags::getTierStats() const { return tierStats; }
+
+void CompilerFlags::setCacheDir(std::string dir) {
+  this->cacheDir = std::move(dir);
+}
+
+std::string CompilerFlags::getCacheDir() const { return cacheDir; }
+
+void CompilerFlags::setCacheSizeLimit(uint64_t limit) {
+  this->cacheSizeLimit = limit;
+}
+
+uint64_t CompilerFlags::getCacheSizeLimit() const { return cacheSizeLimit; }
+
+void CompilerFlags::setCacheStats(bool flag) { this->cacheStats = flag; }
+
+bool CompilerFlags::getCacheStats() const { return cacheStats; }
+
+void CompilerFlags::setSourceHash(std::string hash) {
+  this->sourceHash = std::move(hash);
+}
+
+std::string CompilerFlags::getSourceHash() const { return sourceHash; }
+
+void CompilerFlags::setInlineBudget(unsigned budget) {
+  this->inlineBudget = budget;
+}
+
+unsigned CompilerFlags::getInlineBudget() const {
+  if (inlineBudget)
+    return *inlineBudget;
+  switch (level) {
+  case OptimizationLevel::O0:
+    return 0;
+  case OptimizationLevel::O1:
+    return 16;
+  case OptimizationLevel::O2:
+    return 40;
+  case OptimizationLevel::O3:
+    return 80;
+  }
+  return 0;
+}
+
+void CompilerFlags::setDumpAST(bool flag) { this->dumpAST = flag; }
+
+bool CompilerFlags::getDumpAST() const { return dumpAST; }
+
+void CompilerFlags::setDumpIR(bool flag) { this->dumpIR = flag; }
+
+bool CompilerFlags::getDumpIR() const { return dumpIR; }
+
 void CompilerFlags::setNoDiagnosticsColor(bool flag) {
   this->noDiagnosticsColor = flag;
 }
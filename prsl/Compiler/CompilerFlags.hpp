@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 namespace prsl::Compiler {
@@ -10,14 +12,22 @@ enum class OptimizationLevel { O0, O1, O2, O3 };
 
 enum class RelocationModel { DEFAULT, STATIC, PIC };
 
-enum class ExecutionMode { PARSE, COMPILE, INTERPRET };
+// When the output of programs run in process is written out: after every line
+// if stdout is a terminal, else when the buffer is full (AUTO), after every
+// line (LINE), when the buffer is full (SIZE), or once the program ends (EXIT)
+enum class FlushPolicy { AUTO, LINE, SIZE, EXIT };
+
+enum class ExecutionMode { PARSE, COMPILE, INTERPRET, VM, JIT, TIERED };
 
 class CompilerFlags {
 public:
   CompilerFlags()
       : type(OutputFileType::LLVMIRFile), level(OptimizationLevel::O0),
         model(RelocationModel::DEFAULT), executionMode(ExecutionMode::PARSE),
-        noDiagnosticsColor(false){};
+        flushPolicy(FlushPolicy::AUTO), lexThreads(0), multiversioning(false),
+        lazyCompilation(false), tierThreshold(1000), tierStats(false),
+        cacheSizeLimit(64 << 20), cacheStats(false), dumpAST(false),
+        dumpIR(false), noDiagnosticsColor(false){};
   ~CompilerFlags() = default;
 
   void setOutputFile(std::string file);
@@ -26,6 +36,12 @@ public:
   void setTargetTriple(std::string target);
   [[nodiscard]] std::string getTragetTriple() const;
 
+  void setTargetCPU(std::string cpu);
+  [[nodiscard]] std::string getTargetCPU() const;
+
+  void setTargetFeatures(std::string features);
+  [[nodiscard]] std::string getTargetFeatures() const;
+
   void setFileType(OutputFileType type);
   [[nodiscard]] OutputFileType getFileType() const;
 
@@ -38,16 +54,90 @@ public:
   void setExecutionMode(ExecutionMode mode);
   [[nodiscard]] ExecutionMode getExecutionMode() const;
 
+  void setFlushPolicy(FlushPolicy policy);
+  [[nodiscard]] FlushPolicy getFlushPolicy() const;
+
+  // Number of threads the source is scanned on, picked by the size of the
+  // source if 0
+  void setLexThreads(unsigned threads);
+  [[nodiscard]] unsigned getLexThreads() const;
+
+  // File programs run in process read instead of stdin
+  void setInputFile(std::string file);
+  [[nodiscard]] std::string getInputFile() const;
+
+  // Compile functions for several x86-64 microarchitecture levels, picking
+  // one when the program is loaded
+  void setMultiversioning(bool flag);
+  [[nodiscard]] bool getMultiversioning() const;
+
+  // Compile functions on their first call in JIT mode
+  void setLazyCompilation(bool flag);
+  [[nodiscard]] bool getLazyCompilation() const;
+
+  // Number of calls and loop iterations after which a function is compiled
+  // to native code in tiered mode
+  void setTierThreshold(unsigned threshold);
+  [[nodiscard]] unsigned getTierThreshold() const;
+
+  void setTierStats(bool flag);
+  [[nodiscard]] bool getTierStats() const;
+
+  // Directory of the object cache for JIT and tiered modes, the cache is
+  // disabled if empty
+  void setCacheDir(std::string dir);
+  [[nodiscard]] std::string getCacheDir() const;
+
+  // Size in bytes the cache directory may grow to
+  void setCacheSizeLimit(uint64_t limit);
+  [[nodiscard]] uint64_t getCacheSizeLimit() const;
+
+  void setCacheStats(bool flag);
+  [[nodiscard]] bool getCacheStats() const;
+
+  // Hash of the program source, a part of the cache keys
+  void setSourceHash(std::string hash);
+  [[nodiscard]] std::string getSourceHash() const;
+
+  // Functions of up to this many nodes are inlined, the default depends on
+  // the optimization level
+  void setInlineBudget(unsigned budget);
+  [[nodiscard]] unsigned getInlineBudget() const;
+
+  // Print the program as the backends get it, after the AST optimizations
+  void setDumpAST(bool flag);
+  [[nodiscard]] bool getDumpAST() const;
+
+  // Print the IR of the program after the passes of the optimization level
+  void setDumpIR(bool flag);
+  [[nodiscard]] bool getDumpIR() const;
+
   void setNoDiagnosticsColor(bool flag);
   [[nodiscard]] bool getNoDiagnosticsColor() const;
 
 private:
   std::string outFile;
   std::string target;
+  std::string cpu;
+  std::string features;
   OutputFileType type;
   OptimizationLevel level;
   RelocationModel model;
   ExecutionMode executionMode;
+  FlushPolicy flushPolicy;
+  unsigned lexThreads;
+  std::string inputFile;
+  bool multiversioning;
+  bool lazyCompilation;
+  unsigned tierThreshold;
+  bool tierStats;
+  std::string cacheDir;
+  uint64_t cacheSizeLimit;
+  bool cacheStats;
+  std::string sourceHash;
+  std::optional<unsigned> inlineBudget;
+  bool dumpAST;
+  bool dumpIR;
   bool noDiagnosticsColor;
 };
 
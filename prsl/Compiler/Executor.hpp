@@ -19,13 +19,15 @@ public:
 
   void visitStmt(const AST::StmtPtrVariant &stmt) { ptr->visitStmt(stmt); }
 
-  void dump(const std::filesystem::path &path) const { ptr->dump(path); }
+  bool dump(const std::filesystem::path &path) const {
+    return ptr->dump(path);
+  }
 
 private:
   struct base_holder {
     virtual ~base_holder() {}
     virtual void visitStmt(const AST::StmtPtrVariant &stmt) = 0;
-    virtual void dump(const std::filesystem::path &path) const = 0;
+    virtual bool dump(const std::filesystem::path &path) const = 0;
   };
 
   template <typename T> struct holder : base_holder {
@@ -38,8 +40,8 @@ private:
       executor.visitStmt(stmt);
     }
 
-    void dump(const std::filesystem::path &path) const override {
-      executor.dump(path);
+    bool dump(const std::filesystem::path &path) const override {
+      return executor.dump(path);
     }
   };
 
@@ -1,26 +1,38 @@
 #include "prsl/Compiler/Interpreter/Interpreter.hpp"
-#include "prsl/AST/TreeWalkerVisitor.hpp"
 #include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/Compiler/JIT/JIT.hpp"
 #include "prsl/Debug/Errors.hpp"
+#include "prsl/Utils/Input.hpp"
 
+#include <array>
 #include <iostream>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace prsl::Interpreter {
 
 Interpreter::Interpreter(Compiler::CompilerFlags *flags, Logger &logger)
-    : flags(flags), logger(logger), envManager(logger) {}
+    : flags(flags), logger(logger), envManager(logger) {
+  if (flags->getExecutionMode() == Compiler::ExecutionMode::TIERED)
+    tiering = std::make_unique<JIT::Tiering>(flags, logger);
+}
 
 bool Interpreter::dump(const std::filesystem::path &path) const {
+  if (tiering && flags->getTierStats())
+    tiering->report(std::cerr);
+  if (tiering && flags->getCacheStats())
+    tiering->reportCache(std::cerr);
   return false;
 }
 
-int Interpreter::getInt(const Token &token, const PrslObject &obj) const {
-  if (!std::holds_alternative<int>(obj))
+int Interpreter::getInt(const Token &token, PrslObject obj) const {
+  if (!obj.isInt())
     throw Errors::reportRuntimeError(
         logger, token,
         "Attempt to perform arithmetic operation on non-numeric literal " +
             toString(obj));
-  return std::get<int>(obj);
+  return obj.asInt();
 }
 
 PrslObject Interpreter::visitLiteralExpr(const LiteralExprPtr &expr) {
@@ -32,18 +44,22 @@ PrslObject Interpreter::visitGroupingExpr(const GroupingExprPtr &expr) {
 }
 
 PrslObject Interpreter::visitVarExpr(const VarExprPtr &expr) {
-  return envManager.get(expr->ident);
+  return envManager.get(expr->ident, *expr->binding);
 }
 
 PrslObject Interpreter::visitInputExpr(const InputExprPtr &expr) {
-  int val;
-  std::cin >> val;
-  return PrslObject(val);
+  auto &input = Utils::Input::get();
+  auto value = input.read();
+  if (!value) {
+    logger.error(input.getFailure().pos, input.getFailure().message);
+    throw Errors::RuntimeError{};
+  }
+  return PrslObject(*value);
 }
 
 PrslObject Interpreter::visitAssignmentExpr(const AssignmentExprPtr &expr) {
-  envManager.define(expr->varName, visitExpr(expr->initializer));
-  return envManager.get(expr->varName);
+  envManager.define(*expr->binding, visitExpr(expr->initializer));
+  return envManager.get(expr->varName, *expr->binding);
 }
 
 PrslObject Interpreter::visitUnaryExpr(const UnaryExprPtr &expr) {
@@ -51,6 +67,8 @@ PrslObject Interpreter::visitUnaryExpr(const UnaryExprPtr &expr) {
 
   switch (expr->op.getType()) {
   case Token::Type::MINUS:
+    if (obj.isInt()) [[likely]]
+      return -obj.asInt();
     return -getInt(expr->op, obj);
   default:
     break;
@@ -61,10 +79,47 @@ PrslObject Interpreter::visitUnaryExpr(const UnaryExprPtr &expr) {
       "Illegal unary expression: " + expr->op.toString() + toString(obj));
 }
 
+// Fast path for the common case of two int operands: one check of both type
+// tags instead of one per operand and operation
+static std::optional<PrslObject> intBinaryExpr(Token::Type type, int lhs,
+                                               int rhs) {
+  switch (type) {
+  case Token::Type::PLUS:
+    return lhs + rhs;
+  case Token::Type::MINUS:
+    return lhs - rhs;
+  case Token::Type::STAR:
+    return lhs * rhs;
+  case Token::Type::SLASH:
+    if (rhs == 0)
+      return std::nullopt; // Reported by the generic path
+    return lhs / rhs;
+  case Token::Type::NOT_EQUAL:
+    return lhs != rhs;
+  case Token::Type::EQUAL_EQUAL:
+    return lhs == rhs;
+  case Token::Type::LESS:
+    return lhs < rhs;
+  case Token::Type::LESS_EQUAL:
+    return lhs <= rhs;
+  case Token::Type::GREATER:
+    return lhs > rhs;
+  case Token::Type::GREATER_EQUAL:
+    return lhs >= rhs;
+  default:
+    return std::nullopt;
+  }
+}
+
 PrslObject Interpreter::visitBinaryExpr(const BinaryExprPtr &expr) {
   auto lhs = visitExpr(expr->lhsExpression);
   auto rhs = visitExpr(expr->rhsExpression);
 
+  if (bothInts(lhs, rhs)) [[likely]] {
+    if (auto res = intBinaryExpr(expr->op.getType(), lhs.asInt(), rhs.asInt()))
+      return *res;
+  }
+
   switch (expr->op.getType()) {
   case Token::Type::PLUS:
     return getInt(expr->op, lhs) + getInt(expr->op, rhs);
@@ -100,9 +155,9 @@ PrslObject Interpreter::visitBinaryExpr(const BinaryExprPtr &expr) {
 }
 
 static PrslObject postfixExpr(Logger &logger, const Token &op,
-                              const PrslObject &obj) {
-  if (std::holds_alternative<int>(obj)) {
-    int val = std::get<int>(obj);
+                              PrslObject obj) {
+  if (obj.isInt()) [[likely]] {
+    int val = obj.asInt();
     switch (op.getType()) {
     case Token::Type::PLUS_PLUS:
       return PrslObject(val + 1);
@@ -122,13 +177,18 @@ PrslObject Interpreter::visitPostfixExpr(const PostfixExprPtr &expr) {
   PrslObject obj = visitExpr(expr->expression);
   if (std::holds_alternative<VarExprPtr>(expr->expression)) {
     envManager.assign(std::get<VarExprPtr>(expr->expression)->ident,
-                      postfixExpr(logger, expr->op, obj));
+                      *expr->binding, postfixExpr(logger, expr->op, obj));
   }
   return obj;
 }
 
 PrslObject Interpreter::evaluateScope(const ScopeExprPtr &scope) {
   for (const auto &stmt : scope->statements) {
+    // The final return gives the value of the scope, nothing is pending once
+    // the statements before it are done
+    if (&stmt == &scope->statements.back() &&
+        std::holds_alternative<ReturnStmtPtr>(stmt))
+      return visitExpr(std::get<ReturnStmtPtr>(stmt)->retValue);
     visitStmt(stmt);
     if (returnStack.size()) {
       auto returnValue = std::move(returnStack.top());
@@ -141,86 +201,74 @@ PrslObject Interpreter::evaluateScope(const ScopeExprPtr &scope) {
 
 PrslObject Interpreter::visitScopeExpr(const ScopeExprPtr &expr) {
   PrslObject res;
-  envManager.withNewEnviron([&] { res = evaluateScope(expr); });
+  envManager.withNewFrame(expr->slotsCount,
+                          [&] { res = evaluateScope(expr); });
   return res;
 }
 
 PrslObject Interpreter::visitFuncExpr(const FuncExprPtr &expr) {
-  auto obj = PrslObject{std::make_shared<FuncObj>(expr)};
-
-  class FunctionsResolver : public TreeWalkerVisitor {
-  public:
-    explicit FunctionsResolver(
-        Types::FunctionsManager<PrslObject> &functionsManager)
-        : functionsManager(functionsManager) {}
-    bool dump(const std::filesystem::path &path) const { return false; }
-    void visitFuncExpr(const FuncExprPtr &expr) override {
-      functionsManager.set(expr->name->getLexeme(),
-                           PrslObject{std::make_shared<FuncObj>(expr)});
-    }
-
-  private:
-    Types::FunctionsManager<PrslObject> &functionsManager;
-  };
-  FunctionsResolver funcResolver(functionsManager);
-  funcResolver.visitExpr(expr->body);
-
-  if (expr->name) {
-    functionsManager.set(expr->name->getLexeme(), obj);
-  }
-
-  return obj;
+  return PrslObject::function(functions.add(*expr));
 }
 
 PrslObject Interpreter::visitCallExpr(const CallExprPtr &expr) {
-  PrslObject obj = nullptr;
-
-  // Initialize obj, it can be in functionsManager or envManager
-  if (functionsManager.contains(expr->ident.getLexeme())) {
-    obj = functionsManager.get(expr->ident.getLexeme());
-  }
-  if (std::holds_alternative<std::nullptr_t>(obj) &&
-      envManager.contains(expr->ident)) {
-    obj = envManager.get(expr->ident);
-    if (!std::holds_alternative<FuncObjPtr>(obj))
+  // Named functions are bound by semantic analysis, anything else is called
+  // through a variable holding a function
+  const FuncExpr *callee = expr->callee;
+  if (!callee) {
+    PrslObject obj = nullptr;
+    if (expr->binding && envManager.contains(*expr->binding))
+      obj = envManager.get(expr->ident, *expr->binding);
+    if (!obj.isFunc())
       throw reportRuntimeError(logger, expr->ident, "Not a function");
+    callee = &functions.get(obj.asFunc());
   }
 
-  auto func = std::get<FuncObjPtr>(obj);
-
   // Check parameters count
-  if (size_t paramsCount = func->paramsCount(),
-      argsCount = expr->arguments.size();
-      paramsCount != argsCount) {
+  if (callee->parameters.size() != expr->arguments.size()) {
     throw reportRuntimeError(logger, expr->ident, "Wrong number of arguments");
   }
 
-  // Evaluate arguments
-  std::vector<PrslObject> args;
+  auto native = tiering ? tiering->onCall(*callee) : nullptr;
+
+  // Evaluate arguments right into the first slots of the callee frame
+  size_t base = envManager.getTop();
   for (const auto &arg : expr->arguments) {
-    args.emplace_back(visitExpr(arg));
+    envManager.pushArgument(visitExpr(arg));
   }
 
-  auto funcEnv = std::make_shared<Types::Environment<PrslObject>>(nullptr);
-  PrslObject res{nullptr};
-  envManager.withNewEnviron(funcEnv, [&] {
-    const auto &params = func->getDeclaration()->parameters;
-    auto paramIt = params.begin();
-    auto argIt = args.begin();
-    for (; paramIt != params.end() && argIt != args.end(); ++paramIt, ++argIt) {
-      envManager.define(*paramIt, *argIt);
-    }
+  if (native) {
+    if (auto res = callNative(native, base, expr->arguments.size()))
+      return *res;
+  }
 
-    auto scopeRes =
-        evaluateScope(std::get<ScopeExprPtr>(func->getDeclaration()->body));
-    res = std::move(scopeRes);
+  PrslObject res{nullptr};
+  auto *caller = std::exchange(currentFunction, callee);
+  envManager.withNewFrame(base, callee->slotsCount, [&] {
+    res = evaluateScope(std::get<ScopeExprPtr>(callee->body));
   });
+  currentFunction = caller;
 
   return res;
 }
 
+// Native code works on ints only, other arguments are left to the
+// interpreter
+std::optional<PrslObject>
+Interpreter::callNative(JIT::Tiering::NativeFunction native, size_t base,
+                        size_t argsCount) {
+  std::array<int, JIT::Tiering::maxParams> args;
+  for (size_t i = 0; i != argsCount; ++i) {
+    PrslObject arg = envManager.getArgument(base + i);
+    if (!arg.isInt())
+      return std::nullopt;
+    args[i] = arg.asInt();
+  }
+  envManager.popArguments(base);
+  return JIT::runNative(logger, [&] { return native(args.data()); });
+}
+
 void Interpreter::visitVarStmt(const VarStmtPtr &stmt) {
-  envManager.define(stmt->varName, visitExpr(stmt->initializer));
+  envManager.define(*stmt->binding, visitExpr(stmt->initializer));
 }
 
 void Interpreter::visitIfStmt(const IfStmtPtr &stmt) {
@@ -231,13 +279,42 @@ void Interpreter::visitIfStmt(const IfStmtPtr &stmt) {
 }
 
 void Interpreter::visitWhileStmt(const WhileStmtPtr &stmt) {
-  while (isTrue(visitExpr(stmt->condition)))
+  while (isTrue(visitExpr(stmt->condition))) {
     visitStmt(stmt->body);
+    if (!returnStack.empty())
+      return;
+    if (!tiering) [[likely]]
+      continue;
+    if (currentFunction)
+      tiering->onBackEdge(*currentFunction);
+    if (auto *loop = tiering->onLoopIteration(stmt); loop && enterLoop(*loop)) {
+      tiering->onLoopEntry(stmt);
+      return;
+    }
+  }
+}
+
+// Runs the rest of the loop natively, native code works on ints only. Loops
+// assigning comparisons are never compiled, so the variables written back
+// are ints in the interpreter too
+bool Interpreter::enterLoop(const JIT::Tiering::CompiledLoop &loop) {
+  std::vector<int> values;
+  values.reserve(loop.variables.size());
+  for (const auto &binding : loop.variables) {
+    const auto &value = envManager.find(binding);
+    if (!value || !value->isInt())
+      return false;
+    values.push_back(value->asInt());
+  }
+
+  JIT::runNative(logger, [&] { loop.native(values.data()); });
+  for (size_t i = 0; i != values.size(); ++i)
+    envManager.define(loop.variables[i], values[i]);
+  return true;
 }
 
 void Interpreter::visitPrintStmt(const PrintStmtPtr &stmt) {
-  auto obj = visitExpr(stmt->value);
-  std::cout << toString(obj) << std::endl;
+  print(visitExpr(stmt->value));
 }
 
 void Interpreter::visitExprStmt(const ExprStmtPtr &stmt) {
@@ -245,15 +322,21 @@ void Interpreter::visitExprStmt(const ExprStmtPtr &stmt) {
 }
 
 void Interpreter::visitFunctionStmt(const FunctionStmtPtr &stmt) {
-  for (const auto &stmt : stmt->body) {
-    visitStmt(stmt);
-  }
+  envManager.withNewFrame(stmt->slotsCount, [&] {
+    for (const auto &stmt : stmt->body) {
+      visitStmt(stmt);
+    }
+  });
 }
 
+// Returns leave the scope expression around the block, the statements after
+// them don't run
 void Interpreter::visitBlockStmt(const BlockStmtPtr &stmt) {
-  envManager.withNewEnviron([&] {
+  envManager.withNewFrame(stmt->slotsCount, [&] {
     for (const auto &stmt : stmt->statements) {
       visitStmt(stmt);
+      if (!returnStack.empty())
+        return;
     }
   });
 }
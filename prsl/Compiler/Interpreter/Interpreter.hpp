@@ -3,13 +3,15 @@
 #include "prsl/AST/ASTVisitor.hpp"
 #include "prsl/AST/NodeTypes.hpp"
 #include "prsl/Compiler/Common/Environment.hpp"
-#include "prsl/Compiler/Common/FunctionsManager.hpp"
 #include "prsl/Compiler/CompilerFlags.hpp"
 #include "prsl/Compiler/Interpreter/Objects.hpp"
+#include "prsl/Compiler/JIT/Tiering.hpp"
 #include "prsl/Debug/Logger.hpp"
 #include "prsl/Parser/Token.hpp"
 
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <stack>
 
 namespace prsl::Interpreter {
@@ -21,43 +23,51 @@ using Errors::Logger;
 using Types::Token;
 using Type = Types::Token::Type;
 
-class Interpreter : public ASTVisitor<PrslObject> {
+class Interpreter : public ASTVisitor<Interpreter, PrslObject> {
 public:
   explicit Interpreter(Compiler::CompilerFlags *flags, Logger &logger);
   bool dump(const std::filesystem::path &path) const;
 
 private:
-  PrslObject visitLiteralExpr(const LiteralExprPtr &expr) override;
-  PrslObject visitGroupingExpr(const GroupingExprPtr &expr) override;
-  PrslObject visitVarExpr(const VarExprPtr &expr) override;
-  PrslObject visitInputExpr(const InputExprPtr &expr) override;
-  PrslObject visitAssignmentExpr(const AssignmentExprPtr &expr) override;
-  PrslObject visitUnaryExpr(const UnaryExprPtr &expr) override;
-  PrslObject visitBinaryExpr(const BinaryExprPtr &expr) override;
-  PrslObject visitPostfixExpr(const PostfixExprPtr &expr) override;
-  PrslObject visitScopeExpr(const ScopeExprPtr &expr) override;
-  PrslObject visitFuncExpr(const FuncExprPtr &expr) override;
-  PrslObject visitCallExpr(const CallExprPtr &expr) override;
-
-  void visitVarStmt(const VarStmtPtr &stmt) override;
-  void visitIfStmt(const IfStmtPtr &stmt) override;
-  void visitWhileStmt(const WhileStmtPtr &stmt) override;
-  void visitPrintStmt(const PrintStmtPtr &stmt) override;
-  void visitExprStmt(const ExprStmtPtr &stmt) override;
-  void visitFunctionStmt(const FunctionStmtPtr &stmt) override;
-  void visitBlockStmt(const BlockStmtPtr &stmt) override;
-  void visitReturnStmt(const ReturnStmtPtr &stmt) override;
-  void visitNullStmt(const NullStmtPtr &stmt) override;
-
-  int getInt(const Token &token, const PrslObject &obj) const;
+  friend ASTVisitor;
+
+  PrslObject visitLiteralExpr(const LiteralExprPtr &expr);
+  PrslObject visitGroupingExpr(const GroupingExprPtr &expr);
+  PrslObject visitVarExpr(const VarExprPtr &expr);
+  PrslObject visitInputExpr(const InputExprPtr &expr);
+  PrslObject visitAssignmentExpr(const AssignmentExprPtr &expr);
+  PrslObject visitUnaryExpr(const UnaryExprPtr &expr);
+  PrslObject visitBinaryExpr(const BinaryExprPtr &expr);
+  PrslObject visitPostfixExpr(const PostfixExprPtr &expr);
+  PrslObject visitScopeExpr(const ScopeExprPtr &expr);
+  PrslObject visitFuncExpr(const FuncExprPtr &expr);
+  PrslObject visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitIfStmt(const IfStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitPrintStmt(const PrintStmtPtr &stmt);
+  void visitExprStmt(const ExprStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
+  void visitNullStmt(const NullStmtPtr &stmt);
+
+  int getInt(const Token &token, PrslObject obj) const;
   PrslObject evaluateScope(const ScopeExprPtr &scope);
+  std::optional<PrslObject> callNative(JIT::Tiering::NativeFunction native,
+                                       size_t base, size_t argsCount);
+  bool enterLoop(const JIT::Tiering::CompiledLoop &loop);
 
 private:
   Compiler::CompilerFlags *flags;
   Logger &logger;
   Types::EnvironmentManager<PrslObject> envManager;
-  Types::FunctionsManager<PrslObject> functionsManager;
+  FunctionsTable functions;
   std::stack<PrslObject> returnStack;
+  // Only in tiered mode
+  std::unique_ptr<JIT::Tiering> tiering;
+  const FuncExpr *currentFunction{nullptr};
 };
 
 } // namespace prsl::Interpreter
\ No newline at end of file
@@ -1,48 +1,61 @@
 #include "prsl/Compiler/Interpreter/Objects.hpp"
-#include "prsl/Utils/Utils.hpp"
+#include "prsl/Utils/Output.hpp"
 
 namespace prsl::Interpreter {
 
-FuncObj::FuncObj(const AST::FuncExprPtr &declaration) noexcept
-    : declaration(declaration) {}
-
-size_t FuncObj::paramsCount() const noexcept {
-  return declaration->parameters.size();
+bool areEqual(PrslObject lhs, PrslObject rhs) noexcept {
+  if (lhs.getType() != rhs.getType())
+    return false;
+
+  switch (lhs.getType()) {
+  case PrslObject::Type::INT:
+    return lhs.asInt() == rhs.asInt();
+  case PrslObject::Type::BOOL:
+    return lhs.asBool() == rhs.asBool();
+  case PrslObject::Type::NIL:
+    return true;
+  default:
+    return false;
+  }
 }
 
-const AST::FuncExprPtr &FuncObj::getDeclaration() const noexcept {
-  return declaration;
+void print(PrslObject object) {
+  // Integers are the common case, they are formatted without a string
+  if (object.getType() == PrslObject::Type::INT)
+    Utils::Output::get().writeLine(object.asInt());
+  else
+    Utils::Output::get().writeLine(toString(object));
 }
 
-bool areEqual(const PrslObject &lhs, const PrslObject &rhs) noexcept {
-  return std::visit<bool>(
-      Utils::select{
-          [](const int &lhs, const int &rhs) { return lhs == rhs; },
-          [](const bool &lhs, const bool &rhs) { return lhs == rhs; },
-          [](const std::nullptr_t &, const std::nullptr_t &) { return true; },
-          [](const auto &, const auto &) { return false; },
-      },
-      lhs, rhs);
+std::string toString(PrslObject object) {
+  switch (object.getType()) {
+  case PrslObject::Type::INT:
+    return std::to_string(object.asInt());
+  case PrslObject::Type::BOOL:
+    return object.asBool() ? "1" : "0";
+  case PrslObject::Type::NIL:
+    return "nil";
+  default:
+    return "";
+  }
 }
 
-std::string toString(const PrslObject &object) {
-  return std::visit<std::string>(
-      Utils::select{
-          [](const int &val) { return std::to_string(val); },
-          [](const bool &val) { return val ? "1" : "0"; },
-          [](const std::nullptr_t &) { return "nil"; },
-          [](const auto &) { return ""; },
-      },
-      object);
+bool isTrue(PrslObject object) noexcept {
+  switch (object.getType()) {
+  case PrslObject::Type::INT:
+    return object.asInt() != 0;
+  case PrslObject::Type::BOOL:
+    return object.asBool();
+  default:
+    return false;
+  }
 }
 
-bool isTrue(const PrslObject &object) noexcept {
-  return std::visit<bool>(Utils::select{
-                              [](const int &val) { return val != 0; },
-                              [](const bool &val) { return val == true; },
-                              [](const auto &) { return false; },
-                          },
-                          object);
+FuncHandle FunctionsTable::add(const AST::FuncExpr &declaration) {
+  if (declaration.id >= declarations.size())
+    declarations.resize(declaration.id + 1, nullptr);
+  declarations[declaration.id] = &declaration;
+  return declaration.id;
 }
 
-} // namespace prsl::Interpreter
\ No newline at end of file
+} // namespace prsl::Interpreter
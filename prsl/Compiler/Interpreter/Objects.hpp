@@ -3,31 +3,97 @@
 #include "prsl/AST/NodeTypes.hpp"
 
 #include <cstddef>
-#include <memory>
+#include <cstdint>
 #include <string>
-#include <variant>
+#include <type_traits>
+#include <vector>
 
 namespace prsl::Interpreter {
 
-class FuncObj;
+// Index of a function in a FunctionsTable
+using FuncHandle = uint32_t;
 
-using FuncObjPtr = std::shared_ptr<FuncObj>;
+// Value of a ParaCL expression. Ints and bools are stored unboxed next to
+// their type tag, functions are referenced through a handle, so the value fits
+// into a single register and copying it never touches a reference count
+class PrslObject {
+public:
+  // INT is zero so that checking both operands of an arithmetic operation
+  // takes a single test, see bothInts
+  enum class Type : uint32_t { INT = 0, BOOL, NIL, FUNC };
+
+  constexpr PrslObject() noexcept : PrslObject(nullptr) {}
+  constexpr PrslObject(int val) noexcept
+      : bits(pack(Type::INT, static_cast<uint32_t>(val))) {}
+  constexpr PrslObject(bool val) noexcept : bits(pack(Type::BOOL, val)) {}
+  constexpr PrslObject(std::nullptr_t) noexcept : bits(pack(Type::NIL, 0)) {}
+
+  static constexpr PrslObject function(FuncHandle handle) noexcept {
+    PrslObject obj;
+    obj.bits = pack(Type::FUNC, handle);
+    return obj;
+  }
+
+  [[nodiscard]] constexpr Type getType() const noexcept {
+    return static_cast<Type>(bits >> 32);
+  }
+  [[nodiscard]] constexpr bool isInt() const noexcept {
+    return getType() == Type::INT;
+  }
+  [[nodiscard]] constexpr bool isBool() const noexcept {
+    return getType() == Type::BOOL;
+  }
+  [[nodiscard]] constexpr bool isNil() const noexcept {
+    return getType() == Type::NIL;
+  }
+  [[nodiscard]] constexpr bool isFunc() const noexcept {
+    return getType() == Type::FUNC;
+  }
+
+  [[nodiscard]] constexpr int asInt() const noexcept {
+    return static_cast<int>(static_cast<uint32_t>(bits));
+  }
+  [[nodiscard]] constexpr bool asBool() const noexcept {
+    return static_cast<uint32_t>(bits) != 0;
+  }
+  [[nodiscard]] constexpr FuncHandle asFunc() const noexcept {
+    return static_cast<FuncHandle>(bits);
+  }
+
+  friend constexpr bool bothInts(PrslObject lhs, PrslObject rhs) noexcept {
+    return ((lhs.bits | rhs.bits) >> 32) == 0;
+  }
+
+private:
+  static constexpr uint64_t pack(Type type, uint32_t payload) noexcept {
+    return (static_cast<uint64_t>(type) << 32) | payload;
+  }
+
+  uint64_t bits;
+};
 
-using PrslObject = std::variant<int, bool, std::nullptr_t, FuncObjPtr>;
+static_assert(sizeof(PrslObject) == 8);
+static_assert(std::is_trivially_copyable_v<PrslObject>);
 
-bool areEqual(const PrslObject &lhs, const PrslObject &rhs) noexcept;
-std::string toString(const PrslObject &object);
-bool isTrue(const PrslObject &object) noexcept;
+bool areEqual(PrslObject lhs, PrslObject rhs) noexcept;
+std::string toString(PrslObject object);
+// Writes the object to the program output as a print statement does
+void print(PrslObject object);
+bool isTrue(PrslObject object) noexcept;
 
-class FuncObj {
+// Maps function handles back to their declarations. A handle is the id that
+// semantic analysis gave the declaration, so lookups are plain indexing. The
+// table does not own the declarations, they stay alive as long as the AST does
+class FunctionsTable {
 public:
-  explicit FuncObj(const AST::FuncExprPtr &declaration) noexcept;
+  FuncHandle add(const AST::FuncExpr &declaration);
 
-  [[nodiscard]] size_t paramsCount() const noexcept;
-  [[nodiscard]] const AST::FuncExprPtr &getDeclaration() const noexcept;
+  [[nodiscard]] const AST::FuncExpr &get(FuncHandle handle) const noexcept {
+    return *declarations[handle];
+  }
 
 private:
-  const AST::FuncExprPtr &declaration;
+  std::vector<const AST::FuncExpr *> declarations;
 };
 
-} // namespace prsl::Interpreter
\ No newline at end of file
+} // namespace prsl::Interpreter
@@ -0,0 +1,235 @@
+#include "prsl/Compiler/JIT/JIT.hpp"
+#include "prsl/Compiler/Codegen/Codegen.hpp"
+#include "prsl/Debug/Errors.hpp"
+#include "prsl/Utils/Output.hpp"
+#include <config.hpp>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <iostream>
+
+namespace prsl::JIT {
+
+namespace {
+
+llvm::CodeGenOptLevel toCodeGenOptLevel(Compiler::OptimizationLevel level) {
+  switch (level) {
+  case Compiler::OptimizationLevel::O1:
+    return llvm::CodeGenOptLevel::Less;
+  case Compiler::OptimizationLevel::O2:
+    return llvm::CodeGenOptLevel::Default;
+  case Compiler::OptimizationLevel::O3:
+    return llvm::CodeGenOptLevel::Aggressive;
+  default:
+    return llvm::CodeGenOptLevel::None;
+  }
+}
+
+// prslrt of the code run in process, so it prints into the same buffer as the
+// interpreter does
+void print(int32_t value) { Utils::Output::get().writeLine(value); }
+
+// Runs with generated code on the stack, so there is nothing to unwind
+int32_t input() {
+  auto value = Utils::Input::get().read();
+  if (!value) {
+    nativeFailure = Utils::Input::get().getFailure();
+    std::longjmp(*nativeErrorHandler, 1);
+  }
+  return *value;
+}
+
+void flush() { Utils::Output::get().flush(); }
+
+// The source name and message are constants of the module, which stays
+// loaded while the error is reported
+void fail(const char *file, int32_t line, int32_t column, const char *message) {
+  nativeFailure = {{file, line, column}, message};
+  std::longjmp(*nativeErrorHandler, 1);
+}
+
+Errors::RuntimeError reportError(Logger &logger, llvm::Error error) {
+  logger.error(PROJECT_NAME, llvm::toString(std::move(error)));
+  return Errors::RuntimeError{};
+}
+
+// Everything besides the module that the compiled code depends on
+std::string describeConfiguration(const Compiler::CompilerFlags &flags) {
+  return std::string(PROJECT_NAME " " PROJECT_VERSION
+                                  ", LLVM " LLVM_VERSION_STRING "\n") +
+         flags.getSourceHash() + "\n" +
+         std::to_string(static_cast<int>(flags.getOptimizationLevel())) + " " +
+         std::to_string(static_cast<int>(flags.getRelocationModel())) + " " +
+         flags.getTragetTriple() + " " + flags.getTargetCPU() + " " +
+         flags.getTargetFeatures() + "\n";
+}
+
+// Optimizes modules and compiles them to objects. Objects of modules compiled
+// before are loaded from the cache instead, skipping both steps
+class CachingCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+public:
+  CachingCompiler(llvm::TargetMachine &targetMachine,
+                  const Compiler::CompilerFlags &flags, Cache::DiskCache *cache)
+      : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(
+            targetMachine.Options)),
+        targetMachine(targetMachine), level(flags.getOptimizationLevel()),
+        cache(cache) {
+    if (cache)
+      configuration = describeConfiguration(flags);
+  }
+
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+  operator()(llvm::Module &module) override {
+    std::string key;
+    if (cache) {
+      key = getKey(module);
+      if (auto object = cache->load(key))
+        return object;
+    }
+
+    Codegen::optimize(module, level, &targetMachine);
+    auto object = llvm::orc::SimpleCompiler(targetMachine)(module);
+    if (object && cache)
+      cache->store(key, (*object)->getBuffer());
+    return object;
+  }
+
+private:
+  // The module is a part of the key too: besides the functions of tiered
+  // modules, lazily compiled partitions refer to each other by names given
+  // in the order the partitions get compiled
+  std::string getKey(const llvm::Module &module) const {
+    std::string text = configuration;
+    llvm::raw_string_ostream out(text);
+    module.print(out, nullptr);
+    return Cache::hash(out.str());
+  }
+
+  llvm::TargetMachine &targetMachine;
+  Compiler::OptimizationLevel level;
+  Cache::DiskCache *cache;
+  std::string configuration;
+};
+
+} // namespace
+
+std::jmp_buf *nativeErrorHandler = nullptr;
+Utils::Input::Failure nativeFailure;
+
+JIT::JIT(Compiler::CompilerFlags *flags, Logger &logger)
+    : flags(flags), logger(logger),
+      lazy(flags->getExecutionMode() == Compiler::ExecutionMode::JIT &&
+           flags->getLazyCompilation()) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  auto builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!builder)
+    throw reportError(logger, builder.takeError());
+  builder->setCodeGenOptLevel(toCodeGenOptLevel(flags->getOptimizationLevel()));
+
+  // Codegen has to produce a module for the very same target
+  flags->setTargetTriple(builder->getTargetTriple().getTriple());
+  flags->setTargetCPU(builder->getCPU());
+  flags->setTargetFeatures(builder->getFeatures().getString());
+
+  auto created = builder->createTargetMachine();
+  if (!created)
+    throw reportError(logger, created.takeError());
+  targetMachine = std::move(*created);
+
+  if (auto dir = flags->getCacheDir(); !dir.empty())
+    cache.emplace(dir, flags->getCacheSizeLimit());
+
+  if (lazy)
+    create<llvm::orc::LLLazyJITBuilder>(std::move(*builder));
+  else
+    create<llvm::orc::LLJITBuilder>(std::move(*builder));
+
+  llvm::orc::MangleAndInterner mangle(jit->getExecutionSession(),
+                                     jit->getDataLayout());
+  llvm::orc::SymbolMap runtime;
+  auto define = [&](llvm::StringRef name, auto *func) {
+    runtime[mangle(name)] = {llvm::orc::ExecutorAddr::fromPtr(func),
+                             llvm::JITSymbolFlags::Exported};
+  };
+  define("prslrt_print", &print);
+  define("prslrt_input", &input);
+  define("prslrt_flush", &flush);
+  define("prslrt_fail", &fail);
+  if (auto error = jit->getMainJITDylib().define(
+          llvm::orc::absoluteSymbols(std::move(runtime))))
+    throw reportError(logger, std::move(error));
+
+  // Anything else generated code calls comes from the host process
+  auto generator =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix());
+  if (!generator)
+    throw reportError(logger, generator.takeError());
+  jit->getMainJITDylib().addGenerator(std::move(*generator));
+}
+
+template <typename Builder>
+void JIT::create(llvm::orc::JITTargetMachineBuilder machineBuilder) {
+  // Lazy compilation hands over one function at a time
+  auto created =
+      Builder()
+          .setJITTargetMachineBuilder(std::move(machineBuilder))
+          .setCompileFunctionCreator(
+              [this](llvm::orc::JITTargetMachineBuilder)
+                  -> llvm::Expected<
+                      std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                return std::make_unique<CachingCompiler>(
+                    *targetMachine, *flags, cache ? &*cache : nullptr);
+              })
+          .create();
+  if (!created)
+    throw reportError(logger, created.takeError());
+  jit = std::move(*created);
+}
+
+bool JIT::dump(const std::filesystem::path &path) const {
+  if (flags->getCacheStats())
+    reportCache(std::cerr);
+  return false;
+}
+
+void JIT::visitStmt(const AST::StmtPtrVariant &stmt) {
+  Codegen::Codegen codegen(flags, logger);
+  codegen.visitStmt(stmt);
+
+  auto *main =
+      reinterpret_cast<int (*)()>(compile(codegen.takeModule(), "main"));
+  runNative(logger, main);
+}
+
+void *JIT::compile(llvm::orc::ThreadSafeModule module, std::string_view name) {
+  // Functions of a lazy module are replaced with stubs compiling them
+  auto error =
+      lazy ? static_cast<llvm::orc::LLLazyJIT &>(*jit).addLazyIRModule(
+                 std::move(module))
+           : jit->addIRModule(std::move(module));
+  if (error)
+    throw reportError(logger, std::move(error));
+
+  auto symbol = jit->lookup(name);
+  if (!symbol)
+    throw reportError(logger, symbol.takeError());
+  return symbol->toPtr<void *>();
+}
+
+void JIT::reportCache(std::ostream &out) const {
+  if (cache)
+    cache->report(out);
+}
+
+} // namespace prsl::JIT
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/Cache/DiskCache.hpp"
+#include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/Debug/Errors.hpp"
+#include "prsl/Debug/Logger.hpp"
+#include "prsl/Utils/Input.hpp"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <csetjmp>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace prsl::JIT {
+
+using Errors::Logger;
+
+// Where the host functions called by native code jump to when the input
+// fails or the program divides by zero, exceptions cannot be thrown through
+// frames of generated code. The error to report is left in nativeFailure
+extern std::jmp_buf *nativeErrorHandler;
+extern Utils::Input::Failure nativeFailure;
+
+// Calls into native code, reporting its failures as runtime errors
+template <typename Func> decltype(auto) runNative(Logger &logger, Func func) {
+  std::jmp_buf handler;
+  auto *outer = std::exchange(nativeErrorHandler, &handler);
+  if (setjmp(handler)) {
+    nativeErrorHandler = outer;
+    logger.error(nativeFailure.pos, nativeFailure.message);
+    throw Errors::RuntimeError{};
+  }
+
+  if constexpr (std::is_void_v<decltype(func())>) {
+    func();
+    nativeErrorHandler = outer;
+  } else {
+    decltype(auto) res = func();
+    nativeErrorHandler = outer;
+    return res;
+  }
+}
+
+// Lowers programs with Codegen and runs them in-process with ORC LLJIT,
+// compiled for the host CPU. Modules are optimized when they get compiled.
+// With lazy compilation every function is compiled on its first call, so
+// functions that are never called cost nothing. With a cache directory the
+// objects are kept on disk and reused by later runs of the same program
+class JIT {
+public:
+  explicit JIT(Compiler::CompilerFlags *flags, Logger &logger);
+  bool dump(const std::filesystem::path &path) const;
+
+  void visitStmt(const AST::StmtPtrVariant &stmt);
+
+  // Adds the module to the JIT and returns the address of the named symbol,
+  // compiling it on first lookup
+  void *compile(llvm::orc::ThreadSafeModule module, std::string_view name);
+
+  void reportCache(std::ostream &out) const;
+
+private:
+  template <typename Builder>
+  void create(llvm::orc::JITTargetMachineBuilder machineBuilder);
+
+  Compiler::CompilerFlags *flags;
+  Logger &logger;
+  bool lazy;
+  std::unique_ptr<llvm::TargetMachine> targetMachine;
+  std::optional<Cache::DiskCache> cache;
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+};
+
+} // namespace prsl::JIT
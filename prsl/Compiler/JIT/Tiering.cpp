@@ -0,0 +1,319 @@
+#include "prsl/Compiler/JIT/Tiering.hpp"
+#include "prsl/AST/TreeWalkerVisitor.hpp"
+#include "prsl/Compiler/Codegen/Codegen.hpp"
+#include "prsl/Compiler/JIT/JIT.hpp"
+#include "prsl/Debug/Errors.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+#include <utility>
+
+namespace prsl::JIT {
+
+namespace {
+
+bool isComparison(Types::Token::Type type) {
+  switch (type) {
+  case Types::Token::Type::LESS:
+  case Types::Token::Type::LESS_EQUAL:
+  case Types::Token::Type::GREATER:
+  case Types::Token::Type::GREATER_EQUAL:
+  case Types::Token::Type::EQUAL_EQUAL:
+  case Types::Token::Type::NOT_EQUAL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Looks for code whose native version would behave differently from the
+// interpreter: function values, calls through variables, returns out of a
+// loop and comparisons used as values. Returns leave the innermost scope
+// expression, so the ones in a scope inside the loop stay in it. Comparisons
+// give bools, native code has them as ints outside of conditions. Called
+// functions are compiled into the same module, so they are checked too
+class SupportChecker : public AST::TreeWalkerVisitor<SupportChecker> {
+public:
+  bool check(const AST::FuncExpr &declaration) {
+    if (visited.insert(&declaration).second)
+      visitScopeExpr(std::get<AST::ScopeExprPtr>(declaration.body));
+    return supported;
+  }
+
+  bool check(const AST::WhileStmtPtr &loop) {
+    visitWhileStmt(loop);
+    return supported;
+  }
+
+private:
+  friend ASTVisitor;
+
+  void visitScopeExpr(const AST::ScopeExprPtr &expr) {
+    ++scopes;
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    --scopes;
+  }
+
+  void visitFuncExpr(const AST::FuncExprPtr &expr) {
+    supported = false;
+  }
+
+  void visitBinaryExpr(const AST::BinaryExprPtr &expr) {
+    if (isComparison(expr->op.getType()))
+      supported = false;
+    TreeWalkerVisitor::visitBinaryExpr(expr);
+  }
+
+  void visitCondition(const AST::ExprPtrVariant &condition) {
+    if (const auto *grouping = std::get_if<AST::GroupingExprPtr>(&condition))
+      return visitCondition((*grouping)->expression);
+    if (const auto *binary = std::get_if<AST::BinaryExprPtr>(&condition);
+        binary && isComparison((*binary)->op.getType()))
+      return TreeWalkerVisitor::visitBinaryExpr(*binary);
+    visitExpr(condition);
+  }
+
+  void visitIfStmt(const AST::IfStmtPtr &stmt) {
+    visitCondition(stmt->condition);
+    visitStmt(stmt->thenBranch);
+    if (stmt->elseBranch)
+      visitStmt(*stmt->elseBranch);
+  }
+
+  void visitWhileStmt(const AST::WhileStmtPtr &stmt) {
+    visitCondition(stmt->condition);
+    visitStmt(stmt->body);
+  }
+
+  void visitCallExpr(const AST::CallExprPtr &expr) {
+    if (expr->callee)
+      check(*expr->callee);
+    else
+      supported = false;
+    TreeWalkerVisitor::visitCallExpr(expr);
+  }
+
+  void visitReturnStmt(const AST::ReturnStmtPtr &stmt) {
+    if (scopes == 0)
+      supported = false;
+    TreeWalkerVisitor::visitReturnStmt(stmt);
+  }
+
+  std::unordered_set<const AST::FuncExpr *> visited;
+  // Scope expressions around the visited node, function bodies included
+  unsigned scopes = 0;
+  bool supported = true;
+};
+
+// Collects the variables a loop uses from the frames around it. Bindings
+// inside the loop are relative to the frames the loop itself enters, they
+// are rebased onto the frame the loop runs in
+class VariablesCollector
+    : public AST::TreeWalkerVisitor<VariablesCollector> {
+public:
+  std::vector<AST::Binding> collect(const AST::WhileStmtPtr &loop) {
+    visitWhileStmt(loop);
+    return std::move(variables);
+  }
+
+private:
+  friend ASTVisitor;
+
+  void use(const std::optional<AST::Binding> &binding) {
+    if (!binding || binding->depth < depth)
+      return;
+    AST::Binding outer{binding->depth - depth, binding->slot};
+    if (std::none_of(variables.begin(), variables.end(), [&](auto &known) {
+          return known.depth == outer.depth && known.slot == outer.slot;
+        }))
+      variables.push_back(outer);
+  }
+
+  void visitVarExpr(const AST::VarExprPtr &expr) {
+    use(expr->binding);
+  }
+
+  void visitAssignmentExpr(const AST::AssignmentExprPtr &expr) {
+    use(expr->binding);
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+
+  void visitPostfixExpr(const AST::PostfixExprPtr &expr) {
+    use(expr->binding);
+    TreeWalkerVisitor::visitPostfixExpr(expr);
+  }
+
+  void visitVarStmt(const AST::VarStmtPtr &stmt) {
+    use(stmt->binding);
+    TreeWalkerVisitor::visitVarStmt(stmt);
+  }
+
+  void visitScopeExpr(const AST::ScopeExprPtr &expr) {
+    ++depth;
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    --depth;
+  }
+
+  void visitBlockStmt(const AST::BlockStmtPtr &stmt) {
+    ++depth;
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    --depth;
+  }
+
+  std::vector<AST::Binding> variables;
+  // Frames entered inside the loop
+  unsigned depth = 0;
+};
+
+std::string describe(const Logger &logger, const Types::Token &token,
+                     std::string_view name) {
+  auto pos = logger.locate(token.getLocation());
+  return std::string(name) + " at " + std::to_string(pos.line) + ":" +
+         std::to_string(pos.col);
+}
+
+std::string describe(const Logger &logger, const AST::FuncExpr &declaration) {
+  return describe(logger, declaration.token,
+                  declaration.name ? declaration.name->getLexeme()
+                                   : "<anonymous>");
+}
+
+std::string describe(const Logger &logger, const AST::WhileStmt &loop) {
+  return describe(logger, loop.token, "while");
+}
+
+// Codegen reports constructs it can't lower as errors, here they only mean
+// that the code stays interpreted. Positions in the source are still needed
+// for the errors native code reports
+template <typename F>
+void *compile(JIT &jit, Compiler::CompilerFlags *flags, const Logger &logger,
+              const std::string &name, F &&emit) {
+  Logger quiet(Errors::LogLevel::QUIET, std::cerr);
+  quiet.setLines(logger.getLines());
+  Codegen::Codegen codegen(flags, quiet);
+  try {
+    if (!emit(codegen))
+      return nullptr;
+  } catch (const Errors::RuntimeError &) {
+    return nullptr;
+  }
+  return jit.compile(codegen.takeModule(), name);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+Tiering::Tiering(Compiler::CompilerFlags *flags, Logger &logger)
+    : flags(flags), logger(logger), threshold(flags->getTierThreshold()) {}
+
+Tiering::~Tiering() = default;
+
+JIT &Tiering::getJIT() {
+  if (!jit)
+    jit = std::make_unique<JIT>(flags, logger);
+  return *jit;
+}
+
+Tiering::NativeFunction Tiering::tierUp(Profile &profile,
+                                        const AST::FuncExpr &declaration) {
+  auto start = std::chrono::steady_clock::now();
+  profile.tier = Tier::UNSUPPORTED;
+
+  if (declaration.parameters.size() > maxParams ||
+      !SupportChecker().check(declaration))
+    return nullptr;
+
+  auto name = "prsl.tier." + std::to_string(declaration.id);
+  auto *address = compile(getJIT(), flags, logger, name, [&](auto &codegen) {
+    return codegen.emitEntryPoint(declaration, name);
+  });
+  if (!address)
+    return nullptr;
+
+  profile.native = reinterpret_cast<NativeFunction>(address);
+  profile.tier = Tier::NATIVE;
+  events.push_back({describe(logger, declaration),
+                    std::to_string(profile.calls) + " calls and " +
+                        std::to_string(profile.backEdges) + " loop iterations",
+                    millisecondsSince(start)});
+  return profile.native;
+}
+
+const Tiering::CompiledLoop *Tiering::tierUp(LoopProfile &profile,
+                                             const AST::WhileStmtPtr &loop) {
+  auto start = std::chrono::steady_clock::now();
+  profile.tier = Tier::UNSUPPORTED;
+
+  if (!SupportChecker().check(loop))
+    return nullptr;
+
+  auto variables = VariablesCollector().collect(loop);
+  auto name = "prsl.osr." + std::to_string(loop->id);
+  auto *address = compile(getJIT(), flags, logger, name, [&](auto &codegen) {
+    return codegen.emitLoop(loop, variables, name);
+  });
+  if (!address)
+    return nullptr;
+
+  profile.compiled = {reinterpret_cast<NativeLoop>(address),
+                      std::move(variables)};
+  profile.tier = Tier::NATIVE;
+  events.push_back({describe(logger, *loop),
+                    std::to_string(profile.iterations) + " iterations",
+                    millisecondsSince(start)});
+  return &profile.compiled;
+}
+
+void Tiering::reportCache(std::ostream &out) const {
+  if (jit)
+    jit->reportCache(out);
+}
+
+void Tiering::report(std::ostream &out) const {
+  auto describeTier = [](Tier tier) {
+    switch (tier) {
+    case Tier::NATIVE:
+      return "native";
+    case Tier::UNSUPPORTED:
+      return "interpreted, can't be compiled";
+    default:
+      return "interpreted";
+    }
+  };
+
+  out << "Tiered execution statistics (threshold " << threshold << ")\n";
+  out << "Tier-up events:\n";
+  for (const auto &event : events) {
+    out << "  " << event.subject << ": after " << event.counters
+        << ", compiled in " << std::fixed << std::setprecision(2)
+        << event.milliseconds << " ms\n";
+  }
+
+  out << "Functions:\n";
+  for (const auto &profile : profiles) {
+    if (!profile.calls)
+      continue;
+    out << "  " << describe(logger, *profile.declaration) << ": "
+        << profile.calls << " calls, " << profile.backEdges
+        << " loop iterations, " << describeTier(profile.tier) << "\n";
+  }
+
+  out << "Loops:\n";
+  for (const auto &profile : loops) {
+    if (!profile.iterations)
+      continue;
+    out << "  " << describe(logger, *profile.loop) << ": "
+        << profile.iterations << " interpreted iterations, " << profile.entries
+        << " native entries, " << describeTier(profile.tier) << "\n";
+  }
+}
+
+} // namespace prsl::JIT
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/Debug/Logger.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace prsl::JIT {
+
+using Errors::Logger;
+
+class JIT;
+
+// Profiles functions and loops run by the interpreter and compiles the hot
+// ones to native code with Codegen. A function is hot once its calls and loop
+// iterations together reach the threshold from the compiler flags, a loop
+// once its own iterations do
+class Tiering {
+public:
+  // Native code of a function, takes the arguments as an array
+  using NativeFunction = int (*)(const int *args);
+  // Functions with more parameters always stay interpreted
+  static constexpr size_t maxParams = 16;
+
+  // Native code of a loop, see Codegen::emitLoop
+  using NativeLoop = void (*)(int *variables);
+
+  struct CompiledLoop {
+    NativeLoop native{nullptr};
+    // Variables the loop uses from the frames around it, relative to the
+    // frame the loop runs in, in the order native expects them
+    std::vector<AST::Binding> variables;
+  };
+
+  explicit Tiering(Compiler::CompilerFlags *flags, Logger &logger);
+  ~Tiering();
+
+  // Counts a call of the function and returns its native code, compiling it
+  // first if the function has just become hot. Returns nullptr while the
+  // function has to be interpreted
+  NativeFunction onCall(const AST::FuncExpr &declaration) {
+    if (declaration.id >= profiles.size())
+      profiles.resize(declaration.id + 1);
+    auto &profile = profiles[declaration.id];
+    profile.declaration = &declaration;
+    ++profile.calls;
+    if (profile.tier != Tier::INTERPRETED) [[likely]]
+      return profile.native;
+    if (profile.calls + profile.backEdges < threshold)
+      return nullptr;
+    return tierUp(profile, declaration);
+  }
+
+  // Counts an iteration of a loop in the function, which must have been
+  // entered through onCall
+  void onBackEdge(const AST::FuncExpr &declaration) noexcept {
+    ++profiles[declaration.id].backEdges;
+  }
+
+  // Counts an iteration of the loop and returns its native code, compiling
+  // it first if the loop has just become hot. Returns nullptr while the loop
+  // has to be interpreted
+  const CompiledLoop *onLoopIteration(const AST::WhileStmtPtr &loop) {
+    if (loop->id >= loops.size())
+      loops.resize(loop->id + 1);
+    auto &profile = loops[loop->id];
+    profile.loop = loop.get();
+    ++profile.iterations;
+    if (profile.tier != Tier::INTERPRETED) [[likely]]
+      return profile.tier == Tier::NATIVE ? &profile.compiled : nullptr;
+    if (profile.iterations < threshold)
+      return nullptr;
+    return tierUp(profile, loop);
+  }
+
+  // Counts a switch from the interpreter to native code in the middle of
+  // the loop
+  void onLoopEntry(const AST::WhileStmtPtr &loop) noexcept {
+    ++loops[loop->id].entries;
+  }
+
+  void report(std::ostream &out) const;
+  void reportCache(std::ostream &out) const;
+
+private:
+  enum class Tier { INTERPRETED, NATIVE, UNSUPPORTED };
+
+  struct Profile {
+    const AST::FuncExpr *declaration{nullptr};
+    uint64_t calls{0};
+    uint64_t backEdges{0};
+    Tier tier{Tier::INTERPRETED};
+    NativeFunction native{nullptr};
+  };
+
+  struct LoopProfile {
+    const AST::WhileStmt *loop{nullptr};
+    uint64_t iterations{0};
+    uint64_t entries{0};
+    Tier tier{Tier::INTERPRETED};
+    CompiledLoop compiled;
+  };
+
+  struct TierUpEvent {
+    std::string subject;
+    std::string counters;
+    double milliseconds;
+  };
+
+  NativeFunction tierUp(Profile &profile, const AST::FuncExpr &declaration);
+  const CompiledLoop *tierUp(LoopProfile &profile,
+                             const AST::WhileStmtPtr &loop);
+  JIT &getJIT();
+
+  Compiler::CompilerFlags *flags;
+  Logger &logger;
+  // Created on the first tier-up, so cold programs never pay for it
+  std::unique_ptr<JIT> jit;
+  uint64_t threshold;
+  std::vector<Profile> profiles;
+  std::vector<LoopProfile> loops;
+  std::vector<TierUpEvent> events;
+};
+
+} // namespace prsl::JIT
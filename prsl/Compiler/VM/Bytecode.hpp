@@ -0,0 +1,108 @@
+#pragma once
+
+#include "prsl/Compiler/Interpreter/Objects.hpp"
+#include "prsl/Parser/Token.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace prsl::VM {
+
+using Interpreter::PrslObject;
+using Types::Token;
+
+using Reg = uint16_t;
+
+// Operands are described as R[x] (register x of the current frame),
+// K[x] (constant pool entry x) and imm (signed immediate)
+enum class OpCode : uint8_t {
+  LOADI,     // R[a] = sbx
+  LOADK,     // R[a] = K[bx]
+  LOADNIL,   // R[a] = nil
+  MOVE,      // R[a] = R[b]
+  ADD,       // R[a] = R[b] + R[c]
+  ADDI,      // R[a] = R[b] + imm(c)
+  SUB,       // R[a] = R[b] - R[c]
+  MUL,       // R[a] = R[b] * R[c]
+  DIV,       // R[a] = R[b] / R[c]
+  NEG,       // R[a] = -R[b]
+  EQ,        // R[a] = R[b] == R[c]
+  NE,        // R[a] = R[b] != R[c]
+  LT,        // R[a] = R[b] < R[c]
+  LE,        // R[a] = R[b] <= R[c]
+  GT,        // R[a] = R[b] > R[c]
+  GE,        // R[a] = R[b] >= R[c]
+  POSTFIX,   // R[a] = R[b]; R[b] = R[b] + imm(c)
+  JMP,       // pc += sbx
+  JMPF,      // if !R[a] then pc += sbx
+  JMPT,      // if R[a] then pc += sbx
+  JLT,       // if R[a] < R[b] then pc += imm(c)
+  JLE,       // if R[a] <= R[b] then pc += imm(c)
+  JGT,       // if R[a] > R[b] then pc += imm(c)
+  JGE,       // if R[a] >= R[b] then pc += imm(c)
+  JEQ,       // if R[a] == R[b] then pc += imm(c)
+  JNE,       // if R[a] != R[b] then pc += imm(c)
+  INPUT,     // R[a] = ?
+  PRINT,     // print R[a]
+  CHECKCALL, // check that R[a] is a function taking c arguments
+  CALL,      // R[a] = R[a](R[a + 1], ..., R[a + c])
+  CALLD,     // R[a] = chunks[b](R[a + 1], ..., R[a + c])
+  RET,       // return R[a]
+  ERROR,     // raise errors[bx]
+};
+
+struct Instr {
+  OpCode op;
+  Reg a;
+  Reg b;
+  Reg c;
+
+  static constexpr Instr ABC(OpCode op, Reg a, Reg b, Reg c) noexcept {
+    return {op, a, b, c};
+  }
+  static constexpr Instr ABx(OpCode op, Reg a, uint32_t bx) noexcept {
+    return {op, a, static_cast<Reg>(bx & 0xFFFF), static_cast<Reg>(bx >> 16)};
+  }
+  static constexpr Instr ASBx(OpCode op, Reg a, int32_t sbx) noexcept {
+    return ABx(op, a, static_cast<uint32_t>(sbx));
+  }
+
+  [[nodiscard]] constexpr uint32_t bx() const noexcept {
+    return static_cast<uint32_t>(b) | (static_cast<uint32_t>(c) << 16);
+  }
+  [[nodiscard]] constexpr int32_t sbx() const noexcept {
+    return static_cast<int32_t>(bx());
+  }
+  [[nodiscard]] constexpr int16_t sc() const noexcept {
+    return static_cast<int16_t>(c);
+  }
+};
+
+static_assert(sizeof(Instr) == 8, "Instructions must stay compact");
+
+// A compiled function: the top-level program or a single FuncExpr
+struct Chunk {
+  std::string name;
+  std::vector<Instr> code;
+  // Index into Program::tokens for each instruction, used for diagnostics
+  std::vector<uint32_t> debugTokens;
+  Reg paramsCount{0};
+  Reg regsCount{0};
+};
+
+struct RuntimeErrorInfo {
+  uint32_t token;
+  std::string message;
+};
+
+struct Program {
+  std::vector<Chunk> chunks;
+  std::vector<PrslObject> constants;
+  std::vector<Token> tokens;
+  std::vector<RuntimeErrorInfo> errors;
+
+  static constexpr uint32_t mainChunk = 0;
+};
+
+} // namespace prsl::VM
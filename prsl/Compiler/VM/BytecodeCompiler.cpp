@@ -0,0 +1,604 @@
+#include "prsl/Compiler/VM/BytecodeCompiler.hpp"
+#include "prsl/AST/TreeWalkerVisitor.hpp"
+#include "prsl/Debug/Errors.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace prsl::VM {
+
+namespace {
+
+// Checks whether evaluating an expression can change a local variable of the
+// enclosing function. Function bodies are skipped: they have their own frames.
+class LocalsWriteDetector : public TreeWalkerVisitor<LocalsWriteDetector> {
+public:
+  [[nodiscard]] bool found() const noexcept { return writes; }
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    writes = true;
+  }
+  void visitPostfixExpr(const PostfixExprPtr &expr) { writes = true; }
+  void visitScopeExpr(const ScopeExprPtr &expr) { writes = true; }
+  void visitFuncExpr(const FuncExprPtr &expr) {}
+
+private:
+  bool writes{false};
+};
+
+// Collects variables assigned directly inside an expression (not inside its
+// nested scopes, which get their own locals)
+class AssignedVariablesCollector
+    : public TreeWalkerVisitor<AssignedVariablesCollector> {
+public:
+  [[nodiscard]] const std::vector<std::string_view> &get() const noexcept {
+    return names;
+  }
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    names.push_back(expr->varName.getLexeme());
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+  void visitScopeExpr(const ScopeExprPtr &expr) {}
+  void visitFuncExpr(const FuncExprPtr &expr) {}
+
+private:
+  std::vector<std::string_view> names;
+};
+
+bool mayWriteLocals(const ExprPtrVariant &expr) {
+  LocalsWriteDetector detector;
+  detector.visitExpr(expr);
+  return detector.found();
+}
+
+std::optional<OpCode> comparisonOpCode(Token::Type type,
+                                       bool jump) noexcept {
+  switch (type) {
+  case Token::Type::EQUAL_EQUAL:
+    return jump ? OpCode::JEQ : OpCode::EQ;
+  case Token::Type::NOT_EQUAL:
+    return jump ? OpCode::JNE : OpCode::NE;
+  case Token::Type::LESS:
+    return jump ? OpCode::JLT : OpCode::LT;
+  case Token::Type::LESS_EQUAL:
+    return jump ? OpCode::JLE : OpCode::LE;
+  case Token::Type::GREATER:
+    return jump ? OpCode::JGT : OpCode::GT;
+  case Token::Type::GREATER_EQUAL:
+    return jump ? OpCode::JGE : OpCode::GE;
+  default:
+    return std::nullopt;
+  }
+}
+
+bool fitsImmediate(long long value) noexcept {
+  return value >= std::numeric_limits<int16_t>::min() &&
+         value <= std::numeric_limits<int16_t>::max();
+}
+
+} // namespace
+
+BytecodeCompiler::BytecodeCompiler(Logger &logger) : logger(logger) {}
+
+Program BytecodeCompiler::compile(const StmtPtrVariant &stmt) {
+  program = Program{};
+  program.chunks.emplace_back().name = "main";
+  visitStmt(stmt);
+  return std::move(program);
+}
+
+Reg BytecodeCompiler::visitLiteralExpr(const LiteralExprPtr &expr) {
+  Reg dest = targetOrTemp();
+  emit(Instr::ASBx(OpCode::LOADI, dest, expr->literalVal));
+  return dest;
+}
+
+Reg BytecodeCompiler::visitGroupingExpr(const GroupingExprPtr &expr) {
+  return compileExpr(expr->expression, takeTarget());
+}
+
+Reg BytecodeCompiler::visitVarExpr(const VarExprPtr &expr) {
+  // The variable register itself is the result, compileExpr copies it into
+  // the target if one was requested
+  std::ignore = takeTarget();
+  if (auto reg = resolve(expr->ident.getLexeme()))
+    return *reg;
+
+  Reg dest = allocReg();
+  emitError(expr->ident, "Attempt to access an undef variable");
+  return dest;
+}
+
+Reg BytecodeCompiler::visitInputExpr(const InputExprPtr &expr) {
+  Reg dest = targetOrTemp();
+  emit(Instr::ABC(OpCode::INPUT, dest, 0, 0));
+  return dest;
+}
+
+Reg BytecodeCompiler::visitAssignmentExpr(const AssignmentExprPtr &expr) {
+  std::ignore = takeTarget();
+  auto name = expr->varName.getLexeme();
+  auto reg = resolve(name);
+  if (!reg)
+    reg = define(name);
+  return compileExpr(expr->initializer, *reg);
+}
+
+Reg BytecodeCompiler::visitUnaryExpr(const UnaryExprPtr &expr) {
+  Reg dest = targetOrTemp();
+  Reg value = compileExpr(expr->expression);
+
+  switch (expr->op.getType()) {
+  case Token::Type::MINUS:
+    emit(Instr::ABC(OpCode::NEG, dest, value, 0), &expr->op);
+    break;
+  default:
+    emitError(expr->op, "Illegal unary expression: " + expr->op.toString());
+    break;
+  }
+
+  freeReg(value);
+  return dest;
+}
+
+Reg BytecodeCompiler::visitBinaryExpr(const BinaryExprPtr &expr) {
+  Reg dest = targetOrTemp();
+  auto type = expr->op.getType();
+
+  // x + imm and x - imm are common enough in loops to get their own opcode
+  if ((type == Token::Type::PLUS || type == Token::Type::MINUS) &&
+      std::holds_alternative<LiteralExprPtr>(expr->rhsExpression)) {
+    long long imm =
+        std::get<LiteralExprPtr>(expr->rhsExpression)->literalVal;
+    if (type == Token::Type::MINUS)
+      imm = -imm;
+    if (fitsImmediate(imm)) {
+      Reg lhs = compileExpr(expr->lhsExpression);
+      emit(Instr::ABC(OpCode::ADDI, dest, lhs, static_cast<Reg>(imm)),
+           &expr->op);
+      freeReg(lhs);
+      return dest;
+    }
+  }
+
+  auto [lhs, rhs] = compileOperands(expr->lhsExpression, expr->rhsExpression);
+  std::optional<OpCode> op = comparisonOpCode(type, false);
+  switch (type) {
+  case Token::Type::PLUS:
+    op = OpCode::ADD;
+    break;
+  case Token::Type::MINUS:
+    op = OpCode::SUB;
+    break;
+  case Token::Type::STAR:
+    op = OpCode::MUL;
+    break;
+  case Token::Type::SLASH:
+    op = OpCode::DIV;
+    break;
+  default:
+    break;
+  }
+
+  if (op) {
+    emit(Instr::ABC(*op, dest, lhs, rhs), &expr->op);
+  } else {
+    emitError(expr->op, "Illegal operator in expression");
+  }
+
+  freeReg(rhs);
+  freeReg(lhs);
+  return dest;
+}
+
+Reg BytecodeCompiler::visitPostfixExpr(const PostfixExprPtr &expr) {
+  if (!std::holds_alternative<VarExprPtr>(expr->expression))
+    return compileExpr(expr->expression, takeTarget());
+
+  const auto &ident = std::get<VarExprPtr>(expr->expression)->ident;
+  auto var = resolve(ident.getLexeme());
+  if (!var)
+    return compileExpr(expr->expression, takeTarget());
+
+  // The old value must not be written into the variable we are updating
+  Reg dest = targetOrTemp();
+  if (dest == *var)
+    dest = allocReg();
+
+  int16_t delta = expr->op.getType() == Token::Type::PLUS_PLUS ? 1 : -1;
+  if (expr->op.getType() != Token::Type::PLUS_PLUS &&
+      expr->op.getType() != Token::Type::MINUS_MINUS) {
+    emitError(expr->op, "Illegal operator in expression: " +
+                            expr->op.toString());
+    return dest;
+  }
+  emit(Instr::ABC(OpCode::POSTFIX, dest, *var, static_cast<Reg>(delta)),
+       &expr->op);
+  return dest;
+}
+
+Reg BytecodeCompiler::visitScopeExpr(const ScopeExprPtr &expr) {
+  Reg dest = targetOrTemp();
+  pushScope();
+  state().scopeExprs.push_back({dest, {}});
+
+  const auto &statements = expr->statements;
+  bool returnsAtEnd = !statements.empty() &&
+                      std::holds_alternative<ReturnStmtPtr>(statements.back());
+  for (size_t i = 0; i < statements.size(); ++i) {
+    if (returnsAtEnd && i + 1 == statements.size()) {
+      // The final return falls through into the end of the scope
+      compileExpr(std::get<ReturnStmtPtr>(statements[i])->retValue, dest);
+      state().freeReg = state().localTop;
+    } else {
+      compileStmt(statements[i]);
+    }
+  }
+  if (!returnsAtEnd)
+    emit(Instr::ABC(OpCode::LOADNIL, dest, 0, 0));
+
+  auto exits = std::move(state().scopeExprs.back().exits);
+  state().scopeExprs.pop_back();
+  for (auto exit : exits)
+    patchJump(exit);
+
+  popScope();
+  return dest;
+}
+
+Reg BytecodeCompiler::visitFuncExpr(const FuncExprPtr &expr) {
+  Reg dest = targetOrTemp();
+
+  auto chunk = static_cast<uint32_t>(program.chunks.size());
+  auto &newChunk = program.chunks.emplace_back();
+  newChunk.name = expr->name ? std::string(expr->name->getLexeme()) : "func";
+  newChunk.paramsCount = static_cast<Reg>(expr->parameters.size());
+
+  // Registered before compiling the body, so recursive calls are direct
+  if (expr->name)
+    namedFunctions[expr->name->getLexeme()] = chunk;
+  compileFunction(expr, chunk);
+
+  // Function values are handles of their chunks
+  auto constant = static_cast<uint32_t>(program.constants.size());
+  program.constants.push_back(PrslObject::function(chunk));
+  emit(Instr::ABx(OpCode::LOADK, dest, constant));
+  return dest;
+}
+
+Reg BytecodeCompiler::visitCallExpr(const CallExprPtr &expr) {
+  auto dest = takeTarget();
+  auto name = expr->ident.getLexeme();
+
+  if (auto it = namedFunctions.find(name); it != namedFunctions.end()) {
+    if (program.chunks[it->second].paramsCount != expr->arguments.size()) {
+      Reg res = dest ? *dest : allocReg();
+      emitError(expr->ident, "Wrong number of arguments");
+      return res;
+    }
+    return compileCall(expr, std::nullopt, it->second, dest);
+  }
+
+  if (auto var = resolve(name))
+    return compileCall(expr, *var, std::nullopt, dest);
+
+  Reg res = dest ? *dest : allocReg();
+  emitError(expr->ident, "Attempt to access an undef function");
+  return res;
+}
+
+void BytecodeCompiler::visitVarStmt(const VarStmtPtr &stmt) {
+  auto name = stmt->varName.getLexeme();
+  auto reg = resolve(name);
+  if (!reg)
+    reg = define(name);
+  compileExpr(stmt->initializer, *reg);
+}
+
+void BytecodeCompiler::visitIfStmt(const IfStmtPtr &stmt) {
+  Reg condition = compileExpr(stmt->condition);
+  size_t toElse = emitJump(OpCode::JMPF, condition);
+  freeReg(condition);
+
+  compileStmt(stmt->thenBranch);
+  if (stmt->elseBranch) {
+    size_t toEnd = emitJump(OpCode::JMP, 0);
+    patchJump(toElse);
+    compileStmt(*stmt->elseBranch);
+    patchJump(toEnd);
+  } else {
+    patchJump(toElse);
+  }
+}
+
+void BytecodeCompiler::visitWhileStmt(const WhileStmtPtr &stmt) {
+  // The condition is placed after the body, so every iteration executes a
+  // single conditional jump
+  size_t toCondition = emitJump(OpCode::JMP, 0);
+  size_t bodyStart = currentPc();
+  compileStmt(stmt->body);
+  patchJump(toCondition);
+
+  const ExprPtrVariant *condition = &stmt->condition;
+  while (std::holds_alternative<GroupingExprPtr>(*condition))
+    condition = &std::get<GroupingExprPtr>(*condition)->expression;
+
+  if (std::holds_alternative<BinaryExprPtr>(*condition)) {
+    const auto &binary = std::get<BinaryExprPtr>(*condition);
+    if (auto op = comparisonOpCode(binary->op.getType(), true)) {
+      auto [lhs, rhs] =
+          compileOperands(binary->lhsExpression, binary->rhsExpression);
+      auto offset = static_cast<long long>(bodyStart) -
+                    static_cast<long long>(currentPc() + 1);
+      if (fitsImmediate(offset)) {
+        emit(Instr::ABC(*op, lhs, rhs, static_cast<Reg>(offset)),
+             &binary->op);
+        return;
+      }
+      Reg res = allocReg();
+      emit(Instr::ABC(*comparisonOpCode(binary->op.getType(), false), res, lhs,
+                      rhs),
+           &binary->op);
+      emit(Instr::ASBx(OpCode::JMPT, res,
+                       static_cast<int32_t>(bodyStart - (currentPc() + 1))));
+      return;
+    }
+  }
+
+  Reg res = compileExpr(*condition);
+  emit(Instr::ASBx(OpCode::JMPT, res,
+                   static_cast<int32_t>(bodyStart - (currentPc() + 1))));
+}
+
+void BytecodeCompiler::visitPrintStmt(const PrintStmtPtr &stmt) {
+  Reg value = compileExpr(stmt->value);
+  emit(Instr::ABC(OpCode::PRINT, value, 0, 0));
+}
+
+void BytecodeCompiler::visitExprStmt(const ExprStmtPtr &stmt) {
+  std::ignore = compileExpr(stmt->expression); // We don't need the result
+}
+
+void BytecodeCompiler::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  functions.push_back(FunctionState{Program::mainChunk});
+  pushScope();
+  for (const auto &param : stmt->params)
+    define(param.getLexeme());
+  compileBody(stmt->body);
+  popScope();
+  functions.pop_back();
+}
+
+void BytecodeCompiler::visitBlockStmt(const BlockStmtPtr &stmt) {
+  pushScope();
+  for (const auto &stmt : stmt->statements)
+    compileStmt(stmt);
+  popScope();
+}
+
+void BytecodeCompiler::visitReturnStmt(const ReturnStmtPtr &stmt) {
+  // A return leaves the innermost scope expression, or the function itself
+  if (!state().scopeExprs.empty()) {
+    compileExpr(stmt->retValue, state().scopeExprs.back().dest);
+    size_t exit = emitJump(OpCode::JMP, 0);
+    state().scopeExprs.back().exits.push_back(exit);
+    return;
+  }
+
+  Reg value = compileExpr(stmt->retValue);
+  emit(Instr::ABC(OpCode::RET, value, 0, 0));
+}
+
+void BytecodeCompiler::visitNullStmt(const NullStmtPtr &stmt) {}
+
+Reg BytecodeCompiler::compileExpr(const ExprPtrVariant &expr,
+                                  std::optional<Reg> dest) {
+  target = dest;
+  Reg res = visitExpr(expr);
+  if (dest && res != *dest) {
+    emit(Instr::ABC(OpCode::MOVE, *dest, res, 0));
+    freeReg(res);
+    return *dest;
+  }
+  return res;
+}
+
+void BytecodeCompiler::compileStmt(const StmtPtrVariant &stmt) {
+  visitStmt(stmt);
+  // Temporaries never outlive a statement
+  state().freeReg = state().localTop;
+}
+
+std::pair<Reg, Reg>
+BytecodeCompiler::compileOperands(const ExprPtrVariant &lhs,
+                                  const ExprPtrVariant &rhs) {
+  Reg lhsReg = compileExpr(lhs);
+  // The left operand is read after the right one is evaluated, so a variable
+  // modified by the right operand has to be copied first
+  if (!isTemp(lhsReg) && mayWriteLocals(rhs)) {
+    Reg copy = allocReg();
+    emit(Instr::ABC(OpCode::MOVE, copy, lhsReg, 0));
+    lhsReg = copy;
+  }
+  Reg rhsReg = compileExpr(rhs);
+  return {lhsReg, rhsReg};
+}
+
+void BytecodeCompiler::compileBody(
+    const AST::List<StmtPtrVariant> &statements) {
+  for (const auto &stmt : statements)
+    compileStmt(stmt);
+
+  Reg nil = allocReg();
+  emit(Instr::ABC(OpCode::LOADNIL, nil, 0, 0));
+  emit(Instr::ABC(OpCode::RET, nil, 0, 0));
+}
+
+void BytecodeCompiler::compileFunction(const FuncExprPtr &expr,
+                                       uint32_t chunk) {
+  auto savedTarget = takeTarget();
+  functions.push_back(FunctionState{chunk});
+  pushScope();
+  for (const auto &param : expr->parameters)
+    define(param.getLexeme());
+
+  // Function body is evaluated in the frame of the parameters
+  compileBody(std::get<ScopeExprPtr>(expr->body)->statements);
+
+  popScope();
+  functions.pop_back();
+  target = savedTarget;
+}
+
+Reg BytecodeCompiler::compileCall(const CallExprPtr &expr,
+                                  std::optional<Reg> callee,
+                                  std::optional<uint32_t> chunk,
+                                  std::optional<Reg> dest) {
+  // Arguments are evaluated right into the registers that become the
+  // parameters of the callee, so the frame above them must stay free
+  declareAssignedVariables(expr->arguments);
+
+  auto argsCount = static_cast<Reg>(expr->arguments.size());
+  Reg base = allocReg();
+  if (callee) {
+    emit(Instr::ABC(OpCode::MOVE, base, *callee, 0));
+    emit(Instr::ABC(OpCode::CHECKCALL, base, 0, argsCount), &expr->ident);
+  }
+
+  for (const auto &arg : expr->arguments) {
+    Reg argReg = allocReg();
+    compileExpr(arg, argReg);
+    state().freeReg = argReg + 1;
+  }
+
+  if (chunk) {
+    emit(Instr::ABC(OpCode::CALLD, base, static_cast<Reg>(*chunk), argsCount),
+         &expr->ident);
+  } else {
+    emit(Instr::ABC(OpCode::CALL, base, 0, argsCount), &expr->ident);
+  }
+
+  state().freeReg = base + 1;
+  if (dest) {
+    emit(Instr::ABC(OpCode::MOVE, *dest, base, 0));
+    freeReg(base);
+    return *dest;
+  }
+  return base;
+}
+
+void BytecodeCompiler::declareAssignedVariables(
+    const AST::List<ExprPtrVariant> &exprs) {
+  AssignedVariablesCollector collector;
+  for (const auto &expr : exprs)
+    collector.visitExpr(expr);
+  for (auto name : collector.get()) {
+    if (!resolve(name))
+      define(name);
+  }
+}
+
+std::optional<Reg> BytecodeCompiler::takeTarget() noexcept {
+  return std::exchange(target, std::nullopt);
+}
+
+Reg BytecodeCompiler::targetOrTemp() {
+  if (auto dest = takeTarget())
+    return *dest;
+  return allocReg();
+}
+
+Reg BytecodeCompiler::allocReg() {
+  auto &fs = state();
+  if (fs.freeReg == std::numeric_limits<Reg>::max()) {
+    logger.error(program.chunks[fs.chunk].name,
+                 "function requires too many registers");
+    throw Errors::RuntimeError{};
+  }
+  Reg reg = fs.freeReg++;
+  auto &regsCount = program.chunks[fs.chunk].regsCount;
+  regsCount = std::max(regsCount, fs.freeReg);
+  return reg;
+}
+
+void BytecodeCompiler::freeReg(Reg reg) noexcept {
+  auto &fs = state();
+  if (isTemp(reg) && reg + 1 == fs.freeReg)
+    --fs.freeReg;
+}
+
+bool BytecodeCompiler::isTemp(Reg reg) const noexcept {
+  return reg >= functions.back().localTop;
+}
+
+std::optional<Reg> BytecodeCompiler::resolve(std::string_view name) const {
+  const auto &scopes = functions.back().scopes;
+  for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+    if (auto local = it->locals.find(name); local != it->locals.end())
+      return local->second;
+  }
+  return std::nullopt;
+}
+
+Reg BytecodeCompiler::define(std::string_view name) {
+  Reg reg = allocReg();
+  auto &fs = state();
+  fs.localTop = std::max<Reg>(fs.localTop, reg + 1);
+  fs.scopes.back().locals[name] = reg;
+  return reg;
+}
+
+void BytecodeCompiler::pushScope() {
+  auto &fs = state();
+  fs.scopes.push_back({{}, fs.freeReg, fs.localTop});
+  // Temporaries of the enclosing expression stay alive inside the scope
+  fs.localTop = fs.freeReg;
+}
+
+void BytecodeCompiler::popScope() {
+  auto &fs = state();
+  fs.freeReg = fs.scopes.back().savedFreeReg;
+  fs.localTop = fs.scopes.back().savedLocalTop;
+  fs.scopes.pop_back();
+}
+
+size_t BytecodeCompiler::emit(Instr instr, const Token *token) {
+  auto &chunk = program.chunks[state().chunk];
+  chunk.code.push_back(instr);
+  chunk.debugTokens.push_back(token ? addToken(*token)
+                                    : std::numeric_limits<uint32_t>::max());
+  return chunk.code.size() - 1;
+}
+
+size_t BytecodeCompiler::emitJump(OpCode op, Reg a) {
+  return emit(Instr::ASBx(op, a, 0));
+}
+
+void BytecodeCompiler::patchJump(size_t index) {
+  auto &code = program.chunks[state().chunk].code;
+  auto offset = static_cast<int32_t>(code.size() - (index + 1));
+  code[index] = Instr::ASBx(code[index].op, code[index].a, offset);
+}
+
+size_t BytecodeCompiler::emitError(const Token &token, std::string message) {
+  auto error = static_cast<uint32_t>(program.errors.size());
+  program.errors.push_back({addToken(token), std::move(message)});
+  return emit(Instr::ABx(OpCode::ERROR, 0, error), &token);
+}
+
+uint32_t BytecodeCompiler::addToken(const Token &token) {
+  program.tokens.push_back(token);
+  return static_cast<uint32_t>(program.tokens.size() - 1);
+}
+
+size_t BytecodeCompiler::currentPc() const noexcept {
+  return program.chunks[functions.back().chunk].code.size();
+}
+
+BytecodeCompiler::FunctionState &BytecodeCompiler::state() noexcept {
+  return functions.back();
+}
+
+} // namespace prsl::VM
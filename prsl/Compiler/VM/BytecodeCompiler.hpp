@@ -0,0 +1,114 @@
+#pragma once
+
+#include "prsl/AST/ASTVisitor.hpp"
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/VM/Bytecode.hpp"
+#include "prsl/Debug/Logger.hpp"
+
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace prsl::VM {
+
+using namespace AST;
+
+using Errors::Logger;
+
+// Lowers a checked AST into register-based bytecode. Every function gets its
+// own register window: parameters occupy the first registers, then locals and
+// temporaries. Variables are resolved to registers once, at compile time.
+class BytecodeCompiler : public ASTVisitor<BytecodeCompiler, Reg> {
+public:
+  explicit BytecodeCompiler(Logger &logger);
+
+  Program compile(const StmtPtrVariant &stmt);
+
+private:
+  friend ASTVisitor;
+
+  Reg visitLiteralExpr(const LiteralExprPtr &expr);
+  Reg visitGroupingExpr(const GroupingExprPtr &expr);
+  Reg visitVarExpr(const VarExprPtr &expr);
+  Reg visitInputExpr(const InputExprPtr &expr);
+  Reg visitAssignmentExpr(const AssignmentExprPtr &expr);
+  Reg visitUnaryExpr(const UnaryExprPtr &expr);
+  Reg visitBinaryExpr(const BinaryExprPtr &expr);
+  Reg visitPostfixExpr(const PostfixExprPtr &expr);
+  Reg visitScopeExpr(const ScopeExprPtr &expr);
+  Reg visitFuncExpr(const FuncExprPtr &expr);
+  Reg visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitIfStmt(const IfStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitPrintStmt(const PrintStmtPtr &stmt);
+  void visitExprStmt(const ExprStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
+  void visitNullStmt(const NullStmtPtr &stmt);
+
+  struct Scope {
+    std::unordered_map<std::string_view, Reg> locals;
+    Reg savedFreeReg;
+    Reg savedLocalTop;
+  };
+
+  struct ScopeExprState {
+    Reg dest;
+    std::vector<size_t> exits;
+  };
+
+  struct FunctionState {
+    uint32_t chunk;
+    std::vector<Scope> scopes{};
+    std::vector<ScopeExprState> scopeExprs{};
+    // First register that is not occupied by a live local or temporary
+    Reg freeReg{0};
+    // Registers below localTop may hold live locals and are never released
+    // by temporaries
+    Reg localTop{0};
+  };
+
+  Reg compileExpr(const ExprPtrVariant &expr,
+                  std::optional<Reg> dest = std::nullopt);
+  void compileStmt(const StmtPtrVariant &stmt);
+  std::pair<Reg, Reg> compileOperands(const ExprPtrVariant &lhs,
+                                      const ExprPtrVariant &rhs);
+  void compileBody(const AST::List<StmtPtrVariant> &statements);
+  void compileFunction(const FuncExprPtr &expr, uint32_t chunk);
+  Reg compileCall(const CallExprPtr &expr, std::optional<Reg> callee,
+                  std::optional<uint32_t> chunk,
+                  std::optional<Reg> dest);
+  void declareAssignedVariables(const AST::List<ExprPtrVariant> &exprs);
+
+  std::optional<Reg> takeTarget() noexcept;
+  Reg targetOrTemp();
+
+  Reg allocReg();
+  void freeReg(Reg reg) noexcept;
+  [[nodiscard]] bool isTemp(Reg reg) const noexcept;
+  std::optional<Reg> resolve(std::string_view name) const;
+  Reg define(std::string_view name);
+  void pushScope();
+  void popScope();
+
+  size_t emit(Instr instr, const Token *token = nullptr);
+  size_t emitJump(OpCode op, Reg a);
+  void patchJump(size_t index);
+  size_t emitError(const Token &token, std::string message);
+  uint32_t addToken(const Token &token);
+  [[nodiscard]] size_t currentPc() const noexcept;
+  [[nodiscard]] FunctionState &state() noexcept;
+
+private:
+  Logger &logger;
+  Program program;
+  std::vector<FunctionState> functions;
+  std::unordered_map<std::string_view, uint32_t> namedFunctions;
+  std::optional<Reg> target;
+};
+
+} // namespace prsl::VM
@@ -0,0 +1,541 @@
+#include "prsl/Compiler/VM/IRCompiler.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace prsl::VM {
+
+using IR::BasicBlock;
+using IR::Instruction;
+using IR::Opcode;
+
+namespace {
+
+constexpr Reg noReg = std::numeric_limits<Reg>::max();
+constexpr uint32_t noToken = std::numeric_limits<uint32_t>::max();
+
+bool fitsImmediate(long long value) noexcept {
+  return value >= std::numeric_limits<int16_t>::min() &&
+         value <= std::numeric_limits<int16_t>::max();
+}
+
+// The value a copy copies, through chains of copies
+const Instruction *getRoot(const Instruction *value) {
+  while (value->op == Opcode::COPY)
+    value = value->operands.front();
+  return value;
+}
+
+// Operand of an addition or subtraction that becomes the immediate of ADDI,
+// and the immediate
+std::optional<std::pair<size_t, int>>
+getImmediate(const Instruction &instr) {
+  auto getConstant = [&](size_t index) -> std::optional<long long> {
+    const auto *operand = instr.operands[index];
+    if (operand->op != Opcode::CONST)
+      return std::nullopt;
+    return operand->imm;
+  };
+
+  if (instr.op == Opcode::ADD) {
+    for (size_t index : {1, 0})
+      if (auto value = getConstant(index); value && fitsImmediate(*value))
+        return std::pair{index, static_cast<int>(*value)};
+  } else if (instr.op == Opcode::SUB) {
+    if (auto value = getConstant(1); value && fitsImmediate(-*value))
+      return std::pair{size_t{1}, static_cast<int>(-*value)};
+  }
+  return std::nullopt;
+}
+
+// Constants are loaded right where phis, calls and ADDI take them
+bool isFoldedOperand(const Instruction &user, size_t index) {
+  switch (user.op) {
+  case Opcode::PHI:
+  case Opcode::CALL:
+    return true;
+  case Opcode::ADD:
+  case Opcode::SUB: {
+    auto immediate = getImmediate(user);
+    return immediate && immediate->first == index;
+  }
+  default:
+    return false;
+  }
+}
+
+bool needsRegister(const Instruction &constant) {
+  return std::ranges::any_of(constant.users, [&](const auto *user) {
+    for (size_t i = 0; i != user->operands.size(); ++i)
+      if (user->operands[i] == &constant && !isFoldedOperand(*user, i))
+        return true;
+    return false;
+  });
+}
+
+size_t getPredIndex(const BasicBlock &to, const BasicBlock &from,
+                    size_t occurrence) {
+  for (size_t i = 0; i != to.preds.size(); ++i)
+    if (to.preds[i] == &from && occurrence-- == 0)
+      return i;
+  return to.preds.size();
+}
+
+// The phi the value can be computed right into: the value is what the phi
+// gets from the block the value is defined in, and the phi itself is unused
+// from the definition to the jump to its block
+const Instruction *getCoalescedPhi(const Instruction &value,
+                                   const std::vector<Reg> &regs) {
+  if (value.users.size() != 1 || value.users.front()->op != Opcode::PHI)
+    return nullptr;
+  const auto *phi = value.users.front();
+  const auto *block = value.parent;
+  const auto *terminator = block->getTerminator();
+  // Only phis of blocks laid out before have registers, i.e., loop headers
+  if (terminator->op != Opcode::JMP || regs[phi->id] == noReg)
+    return nullptr;
+  auto index = getPredIndex(*phi->parent, *block, 0);
+  if (phi->operands[index] != &value)
+    return nullptr;
+
+  auto it = std::find(block->instructions.begin(), block->instructions.end(),
+                      &value);
+  for (++it; it != block->instructions.end(); ++it) {
+    for (const auto *operand : (*it)->operands)
+      if (getRoot(operand) == phi)
+        return nullptr;
+  }
+  for (const auto *other : phi->parent->instructions) {
+    if (other->op != Opcode::PHI)
+      break;
+    if (other != phi && getRoot(other->operands[index]) == phi)
+      return nullptr;
+  }
+  return phi;
+}
+
+OpCode getOpCode(Opcode op) {
+  switch (op) {
+  case Opcode::ADD:
+    return OpCode::ADD;
+  case Opcode::SUB:
+    return OpCode::SUB;
+  case Opcode::MUL:
+    return OpCode::MUL;
+  case Opcode::DIV:
+    return OpCode::DIV;
+  case Opcode::EQ:
+    return OpCode::EQ;
+  case Opcode::NE:
+    return OpCode::NE;
+  case Opcode::LT:
+    return OpCode::LT;
+  case Opcode::LE:
+    return OpCode::LE;
+  case Opcode::GT:
+    return OpCode::GT;
+  default:
+    return OpCode::GE;
+  }
+}
+
+// Jump taken if the comparison holds, or if it doesn't
+OpCode getJumpOpCode(Opcode op, bool holds) {
+  switch (op) {
+  case Opcode::EQ:
+    return holds ? OpCode::JEQ : OpCode::JNE;
+  case Opcode::NE:
+    return holds ? OpCode::JNE : OpCode::JEQ;
+  case Opcode::LT:
+    return holds ? OpCode::JLT : OpCode::JGE;
+  case Opcode::LE:
+    return holds ? OpCode::JLE : OpCode::JGT;
+  case Opcode::GT:
+    return holds ? OpCode::JGT : OpCode::JLE;
+  default:
+    return holds ? OpCode::JGE : OpCode::JLT;
+  }
+}
+
+bool isComparison(Opcode op) {
+  return op == Opcode::EQ || op == Opcode::NE || op == Opcode::LT ||
+         op == Opcode::LE || op == Opcode::GT || op == Opcode::GE;
+}
+
+bool isComparisonJump(OpCode op) {
+  return op == OpCode::JLT || op == OpCode::JLE || op == OpCode::JGT ||
+         op == OpCode::JGE || op == OpCode::JEQ || op == OpCode::JNE;
+}
+
+} // namespace
+
+std::optional<Program> IRCompiler::compile(const IR::Module &module) {
+  program = Program{};
+  for (const auto &function : module.functions) {
+    chunks[function.get()] = static_cast<uint32_t>(program.chunks.size());
+    auto &chunk = program.chunks.emplace_back();
+    chunk.name = function->name;
+    chunk.paramsCount = static_cast<Reg>(function->paramsCount);
+  }
+
+  try {
+    for (size_t i = 0; i != module.functions.size(); ++i)
+      compileFunction(*module.functions[i], program.chunks[i]);
+  } catch (const Overflow &) {
+    return std::nullopt;
+  }
+  return std::move(program);
+}
+
+void IRCompiler::compileFunction(const IR::Function &function, Chunk &chunk) {
+  this->chunk = &chunk;
+  assignRegisters(function);
+
+  blockStarts.assign(function.blocks.size(), std::nullopt);
+  jumps.clear();
+  for (size_t i = 0; i != function.blocks.size(); ++i) {
+    const auto &block = *function.blocks[i];
+    const auto *next =
+        i + 1 != function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+    blockStarts[block.id] = currentPc();
+    for (const auto *instr : block.instructions)
+      if (!IR::isTerminator(instr->op))
+        compileInstruction(*instr);
+    compileTerminator(block, next);
+  }
+
+  for (auto [index, target] : jumps)
+    patchJump(index, *blockStarts[target->id]);
+}
+
+void IRCompiler::assignRegisters(const IR::Function &function) {
+  regs.assign(function.values.size(), noReg);
+  freeReg = static_cast<Reg>(function.paramsCount);
+  size_t maxPhis = 0;
+  size_t maxArgs = 0;
+  bool calls = false;
+
+  for (const auto &block : function.blocks) {
+    size_t phis = 0;
+    for (const auto *instr : block->instructions) {
+      switch (instr->op) {
+      case Opcode::PARAM:
+        regs[instr->id] = static_cast<Reg>(instr->imm);
+        break;
+      case Opcode::COPY:
+        regs[instr->id] = getReg(instr->operands.front());
+        break;
+      case Opcode::CONST:
+        if (needsRegister(*instr))
+          regs[instr->id] = allocReg();
+        break;
+      case Opcode::PHI:
+        ++phis;
+        regs[instr->id] = allocReg();
+        break;
+      case Opcode::CALL:
+        calls = true;
+        maxArgs = std::max(maxArgs, instr->operands.size());
+        regs[instr->id] = allocReg();
+        break;
+      case Opcode::PRINT:
+      case Opcode::JMP:
+      case Opcode::BR:
+      case Opcode::RET:
+        break;
+      default:
+        if (isFused(*instr))
+          break;
+        if (const auto *phi = getCoalescedPhi(*instr, regs))
+          regs[instr->id] = getReg(phi);
+        else
+          regs[instr->id] = allocReg();
+        break;
+      }
+    }
+    maxPhis = std::max(maxPhis, phis);
+  }
+
+  size_t regsCount = freeReg + maxPhis;
+  scratch = freeReg;
+  callBase = static_cast<Reg>(regsCount);
+  if (calls)
+    regsCount += 1 + maxArgs;
+  if (regsCount >= noReg)
+    throw Overflow{};
+  chunk->regsCount = static_cast<Reg>(regsCount);
+}
+
+void IRCompiler::compileInstruction(const Instruction &instr) {
+  switch (instr.op) {
+  case Opcode::CONST:
+    if (regs[instr.id] != noReg)
+      emit(Instr::ASBx(OpCode::LOADI, getReg(&instr), instr.imm));
+    break;
+  case Opcode::INPUT:
+    emit(Instr::ABC(OpCode::INPUT, getReg(&instr), 0, 0));
+    break;
+  case Opcode::NEG:
+    emit(Instr::ABC(OpCode::NEG, getReg(&instr),
+                    getReg(instr.operands.front()), 0));
+    break;
+  case Opcode::ADD:
+  case Opcode::SUB:
+    if (auto immediate = getImmediate(instr)) {
+      auto [index, value] = *immediate;
+      emit(Instr::ABC(OpCode::ADDI, getReg(&instr),
+                      getReg(instr.operands[1 - index]),
+                      static_cast<Reg>(value)));
+      break;
+    }
+    [[fallthrough]];
+  case Opcode::MUL:
+  case Opcode::DIV:
+  case Opcode::EQ:
+  case Opcode::NE:
+  case Opcode::LT:
+  case Opcode::LE:
+  case Opcode::GT:
+  case Opcode::GE:
+    // Comparisons only branched on are evaluated by the branch
+    if (isFused(instr))
+      break;
+    emit(Instr::ABC(getOpCode(instr.op), getReg(&instr),
+                    getReg(instr.operands[0]), getReg(instr.operands[1])),
+         instr.token);
+    break;
+  case Opcode::CALL: {
+    // Arguments are placed right after the callee frame base, where they
+    // become the parameters
+    for (size_t i = 0; i != instr.operands.size(); ++i) {
+      const auto *arg = instr.operands[i];
+      auto dest = static_cast<Reg>(callBase + 1 + i);
+      if (arg->op == Opcode::CONST)
+        emit(Instr::ASBx(OpCode::LOADI, dest, arg->imm));
+      else
+        emit(Instr::ABC(OpCode::MOVE, dest, getReg(arg), 0));
+    }
+    emit(Instr::ABC(OpCode::CALLD, callBase, chunks.at(instr.callee),
+                    static_cast<Reg>(instr.operands.size())),
+         instr.token);
+    emit(Instr::ABC(OpCode::MOVE, getReg(&instr), callBase, 0));
+    break;
+  }
+  case Opcode::PRINT:
+    emit(Instr::ABC(OpCode::PRINT, getReg(instr.operands.front()), 0, 0));
+    break;
+  default:
+    // Parameters and copies are registers already, phis get their values
+    // on the edges
+    break;
+  }
+}
+
+void IRCompiler::compileTerminator(const BasicBlock &block,
+                                   const BasicBlock *next) {
+  const auto *terminator = block.getTerminator();
+  switch (terminator->op) {
+  case Opcode::RET:
+    emit(Instr::ABC(OpCode::RET, getReg(terminator->operands.front()), 0, 0));
+    return;
+  case Opcode::JMP: {
+    const auto *target = terminator->targets.front();
+    emitMoves(getMoves(block, *target));
+    if (target == next)
+      return;
+    // The loop test is repeated at the end of the body, so every iteration
+    // executes a single conditional jump
+    if (blockStarts[target->id] && compileLoopTest(*target, next))
+      return;
+    emitJump(target);
+    return;
+  }
+  default:
+    break;
+  }
+
+  const auto *thenBlock = terminator->targets[0];
+  const auto *elseBlock = terminator->targets[1];
+  auto thenMoves = getMoves(block, *thenBlock);
+  auto elseMoves = getMoves(block, *elseBlock, thenBlock == elseBlock);
+
+  if (thenMoves.empty() && elseMoves.empty()) {
+    if (thenBlock == next) {
+      emitTest(*terminator, false, elseBlock);
+    } else {
+      emitTest(*terminator, true, thenBlock);
+      if (elseBlock != next)
+        emitJump(elseBlock);
+    }
+  } else if (elseMoves.empty()) {
+    emitTest(*terminator, false, elseBlock);
+    emitMoves(std::move(thenMoves));
+    if (thenBlock != next)
+      emitJump(thenBlock);
+  } else if (thenMoves.empty()) {
+    emitTest(*terminator, true, thenBlock);
+    emitMoves(std::move(elseMoves));
+    if (elseBlock != next)
+      emitJump(elseBlock);
+  } else {
+    // Moves of the else edge are skipped by a jump within the block
+    emitTest(*terminator, false, nullptr);
+    size_t toElse = jumps.back().first;
+    jumps.pop_back();
+    emitMoves(std::move(thenMoves));
+    emitJump(thenBlock);
+    patchJump(toElse, currentPc());
+    emitMoves(std::move(elseMoves));
+    if (elseBlock != next)
+      emitJump(elseBlock);
+  }
+}
+
+bool IRCompiler::compileLoopTest(const BasicBlock &header,
+                                 const BasicBlock *next) {
+  const auto *terminator = header.getTerminator();
+  if (terminator->op != Opcode::BR)
+    return false;
+  // Constants the test compares with are loaded again
+  std::vector<const Instruction *> constants;
+  for (const auto *instr : header.instructions) {
+    if (instr->op == Opcode::CONST)
+      constants.push_back(instr);
+    else if (instr->op != Opcode::PHI && instr != terminator &&
+             !isFused(*instr))
+      return false;
+  }
+  const auto *thenBlock = terminator->targets[0];
+  const auto *elseBlock = terminator->targets[1];
+  if (thenBlock == elseBlock || !getMoves(header, *thenBlock).empty() ||
+      !getMoves(header, *elseBlock).empty())
+    return false;
+
+  for (const auto *constant : constants)
+    compileInstruction(*constant);
+  emitTest(*terminator, true, thenBlock);
+  if (elseBlock != next)
+    emitJump(elseBlock);
+  return true;
+}
+
+std::vector<IRCompiler::Move> IRCompiler::getMoves(const BasicBlock &from,
+                                                   const BasicBlock &to,
+                                                   size_t occurrence) const {
+  std::vector<Move> moves;
+  auto index = getPredIndex(to, from, occurrence);
+  for (const auto *phi : to.instructions) {
+    if (phi->op != Opcode::PHI)
+      break;
+    const auto *value = phi->operands[index];
+    if (value->op == Opcode::CONST)
+      moves.push_back({getReg(phi), noReg, value->imm});
+    else if (getReg(value) != getReg(phi))
+      moves.push_back({getReg(phi), getReg(value), std::nullopt});
+  }
+  return moves;
+}
+
+void IRCompiler::emitMoves(std::vector<Move> moves) {
+  // Phis take the values they had before the edge, so a register is
+  // overwritten only once no other move reads it. Constants don't read any
+  auto isRead = [&](Reg reg) {
+    return std::ranges::any_of(moves, [&](const Move &move) {
+      return !move.imm && move.src == reg;
+    });
+  };
+
+  Reg temp = scratch;
+  while (!moves.empty()) {
+    auto it = std::ranges::find_if(moves, [&](const Move &move) {
+      return !move.imm && !isRead(move.dest);
+    });
+    if (it == moves.end()) {
+      it = std::ranges::find_if(moves,
+                                [](const Move &move) { return !move.imm; });
+      if (it == moves.end())
+        break;
+      // Every register left is read by another move: the cycle is broken by
+      // saving the one about to be overwritten
+      Reg dest = it->dest;
+      emit(Instr::ABC(OpCode::MOVE, temp, dest, 0));
+      for (auto &move : moves)
+        if (!move.imm && move.src == dest)
+          move.src = temp;
+      ++temp;
+      continue;
+    }
+    emit(Instr::ABC(OpCode::MOVE, it->dest, it->src, 0));
+    moves.erase(it);
+  }
+  for (const auto &move : moves)
+    emit(Instr::ASBx(OpCode::LOADI, move.dest, *move.imm));
+}
+
+void IRCompiler::emitTest(const Instruction &branch, bool value,
+                          const BasicBlock *target) {
+  const auto *condition = branch.operands.front();
+  if (isFused(*condition)) {
+    emit(Instr::ABC(getJumpOpCode(condition->op, value),
+                    getReg(condition->operands[0]),
+                    getReg(condition->operands[1]), 0),
+         condition->token);
+  } else {
+    emit(Instr::ASBx(value ? OpCode::JMPT : OpCode::JMPF, getReg(condition),
+                     0));
+  }
+  jumps.emplace_back(currentPc() - 1, target);
+}
+
+void IRCompiler::emitJump(const BasicBlock *target) {
+  emit(Instr::ASBx(OpCode::JMP, 0, 0));
+  jumps.emplace_back(currentPc() - 1, target);
+}
+
+bool IRCompiler::isFused(const Instruction &instr) const {
+  if (!isComparison(instr.op) || instr.users.size() != 1)
+    return false;
+  const auto *user = instr.users.front();
+  return user->op == Opcode::BR && user->parent == instr.parent;
+}
+
+Reg IRCompiler::getReg(const Instruction *value) const {
+  return regs[value->id];
+}
+
+Reg IRCompiler::allocReg() {
+  if (freeReg == noReg)
+    throw Overflow{};
+  return freeReg++;
+}
+
+size_t IRCompiler::emit(Instr instr, const Token *token) {
+  chunk->code.push_back(instr);
+  if (token) {
+    chunk->debugTokens.push_back(
+        static_cast<uint32_t>(program.tokens.size()));
+    program.tokens.push_back(*token);
+  } else {
+    chunk->debugTokens.push_back(noToken);
+  }
+  return chunk->code.size() - 1;
+}
+
+void IRCompiler::patchJump(size_t index, size_t target) {
+  auto &instr = chunk->code[index];
+  auto offset = static_cast<long long>(target) -
+                static_cast<long long>(index + 1);
+  if (isComparisonJump(instr.op)) {
+    // Comparison jumps take 16-bit offsets
+    if (!fitsImmediate(offset))
+      throw Overflow{};
+    instr.c = static_cast<Reg>(offset);
+    return;
+  }
+  instr = Instr::ASBx(instr.op, instr.a, static_cast<int32_t>(offset));
+}
+
+size_t IRCompiler::currentPc() const noexcept { return chunk->code.size(); }
+
+} // namespace prsl::VM
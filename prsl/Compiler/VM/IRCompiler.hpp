@@ -0,0 +1,77 @@
+#pragma once
+
+#include "prsl/Compiler/VM/Bytecode.hpp"
+#include "prsl/IR/IR.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace prsl::VM {
+
+// Lowers the IR of a program into bytecode. Every value gets a register of
+// its own: copies share the register of the value they copy, and a value
+// assigned to a loop variable at the end of an iteration is computed right
+// into the register of the variable. Phis are resolved with moves on the
+// edges entering their blocks
+class IRCompiler {
+public:
+  // Nullopt if the program doesn't fit the bytecode encoding, e.g., a
+  // function needs too many registers
+  std::optional<Program> compile(const IR::Module &module);
+
+private:
+  struct Overflow {};
+
+  // A phi getting its value on an edge, from a register or a constant
+  struct Move {
+    Reg dest;
+    Reg src;
+    std::optional<int> imm;
+  };
+
+  void compileFunction(const IR::Function &function, Chunk &chunk);
+  void assignRegisters(const IR::Function &function);
+  void compileInstruction(const IR::Instruction &instr);
+  void compileTerminator(const IR::BasicBlock &block,
+                         const IR::BasicBlock *next);
+  // Moves out of the loop header test into the blocks jumping back to it,
+  // if the header holds nothing else
+  bool compileLoopTest(const IR::BasicBlock &header,
+                       const IR::BasicBlock *next);
+
+  // Moves on the occurrence-th edge between the blocks
+  std::vector<Move> getMoves(const IR::BasicBlock &from,
+                             const IR::BasicBlock &to,
+                             size_t occurrence = 0) const;
+  void emitMoves(std::vector<Move> moves);
+  // Jumps to the target if the branch condition is the value given
+  void emitTest(const IR::Instruction &branch, bool value,
+                const IR::BasicBlock *target);
+  void emitJump(const IR::BasicBlock *target);
+
+  [[nodiscard]] bool isFused(const IR::Instruction &instr) const;
+  [[nodiscard]] Reg getReg(const IR::Instruction *value) const;
+  Reg allocReg();
+
+  size_t emit(Instr instr, const Token *token = nullptr);
+  void patchJump(size_t index, size_t target);
+  [[nodiscard]] size_t currentPc() const noexcept;
+
+private:
+  Program program;
+  std::unordered_map<const IR::Function *, uint32_t> chunks;
+
+  // State of the function being compiled
+  Chunk *chunk{nullptr};
+  std::vector<Reg> regs;
+  Reg freeReg{0};
+  // Registers breaking cycles of phi moves, then the callee frame
+  Reg scratch{0};
+  Reg callBase{0};
+  std::vector<std::optional<size_t>> blockStarts;
+  std::vector<std::pair<size_t, const IR::BasicBlock *>> jumps;
+};
+
+} // namespace prsl::VM
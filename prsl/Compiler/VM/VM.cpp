@@ -0,0 +1,262 @@
+#include "prsl/Compiler/VM/VM.hpp"
+#include "prsl/Compiler/VM/BytecodeCompiler.hpp"
+#include "prsl/Compiler/VM/IRCompiler.hpp"
+#include "prsl/Debug/Errors.hpp"
+#include "prsl/IR/PassManager.hpp"
+#include "prsl/Utils/Input.hpp"
+
+#include <algorithm>
+
+namespace prsl::VM {
+
+VM::VM(Compiler::CompilerFlags *flags, Logger &logger)
+    : flags(flags), logger(logger) {}
+
+bool VM::dump(const std::filesystem::path &path) const { return false; }
+
+void VM::visitStmt(const AST::StmtPtrVariant &stmt) {
+  // Programs the IR expresses are compiled from it, the rest from the AST
+  if (const auto *program = std::get_if<AST::FunctionStmtPtr>(&stmt)) {
+    auto module = IR::compile(*program, flags->getOptimizationLevel());
+    if (module) {
+      if (auto bytecode = IRCompiler().compile(*module)) {
+        execute(*bytecode);
+        return;
+      }
+    }
+  }
+
+  BytecodeCompiler compiler(logger);
+  auto program = compiler.compile(stmt);
+  execute(program);
+}
+
+namespace {
+
+struct CallFrame {
+  const Chunk *chunk;
+  const Instr *returnPc;
+  size_t base;
+};
+
+} // namespace
+
+void VM::execute(const Program &program) {
+  std::vector<PrslObject> stack(1024, PrslObject{nullptr});
+  std::vector<CallFrame> frames;
+
+  const Chunk *chunk = &program.chunks[Program::mainChunk];
+  size_t base = 0;
+  stack.resize(std::max<size_t>(stack.size(), chunk->regsCount));
+  PrslObject *regs = stack.data();
+  const Instr *pc = chunk->code.data();
+
+  auto error = [&](const std::string &message) {
+    auto index = static_cast<size_t>(pc - 1 - chunk->code.data());
+    return Errors::reportRuntimeError(
+        logger, program.tokens[chunk->debugTokens[index]], message);
+  };
+
+  auto getInt = [&](const PrslObject &obj) {
+    if (obj.isInt()) [[likely]]
+      return obj.asInt();
+    throw error(
+        "Attempt to perform arithmetic operation on non-numeric literal " +
+        toString(obj));
+  };
+
+  // Callee frame starts right after the callee register, so the arguments
+  // already evaluated there become its parameters without copying
+  auto enterFrame = [&](const Chunk &callee, Reg calleeReg, Reg argsCount) {
+    size_t newBase = base + calleeReg + 1;
+    size_t required = newBase + callee.regsCount;
+    if (required > stack.size())
+      stack.resize(std::max(required, stack.size() * 2), PrslObject{nullptr});
+
+    std::fill(stack.begin() + newBase + argsCount, stack.begin() + required,
+              PrslObject{nullptr});
+    frames.push_back({chunk, pc, base});
+
+    chunk = &callee;
+    base = newBase;
+    regs = stack.data() + base;
+    pc = callee.code.data();
+  };
+
+  for (;;) {
+    const Instr instr = *pc++;
+    switch (instr.op) {
+    case OpCode::LOADI:
+      regs[instr.a] = instr.sbx();
+      break;
+    case OpCode::LOADK:
+      regs[instr.a] = program.constants[instr.bx()];
+      break;
+    case OpCode::LOADNIL:
+      regs[instr.a] = nullptr;
+      break;
+    case OpCode::MOVE:
+      regs[instr.a] = regs[instr.b];
+      break;
+    case OpCode::ADD: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs + getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::ADDI:
+      regs[instr.a] = getInt(regs[instr.b]) + instr.sc();
+      break;
+    case OpCode::SUB: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs - getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::MUL: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs * getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::DIV: {
+      int denominator = getInt(regs[instr.c]);
+      if (denominator == 0)
+        throw error("Division by zero");
+      regs[instr.a] = getInt(regs[instr.b]) / denominator;
+      break;
+    }
+    case OpCode::NEG:
+      regs[instr.a] = -getInt(regs[instr.b]);
+      break;
+    case OpCode::EQ:
+      regs[instr.a] = areEqual(regs[instr.b], regs[instr.c]);
+      break;
+    case OpCode::NE:
+      regs[instr.a] = !areEqual(regs[instr.b], regs[instr.c]);
+      break;
+    case OpCode::LT: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs < getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::LE: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs <= getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::GT: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs > getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::GE: {
+      int lhs = getInt(regs[instr.b]);
+      regs[instr.a] = lhs >= getInt(regs[instr.c]);
+      break;
+    }
+    case OpCode::POSTFIX: {
+      PrslObject &var = regs[instr.b];
+      if (!var.isInt()) {
+        auto index = static_cast<size_t>(pc - 1 - chunk->code.data());
+        throw error("Illegal operator in expression: " +
+                    program.tokens[chunk->debugTokens[index]].toString() +
+                    toString(var));
+      }
+      int old = var.asInt();
+      var = old + instr.sc();
+      regs[instr.a] = old;
+      break;
+    }
+    case OpCode::JMP:
+      pc += instr.sbx();
+      break;
+    case OpCode::JMPF:
+      if (!isTrue(regs[instr.a]))
+        pc += instr.sbx();
+      break;
+    case OpCode::JMPT:
+      if (isTrue(regs[instr.a]))
+        pc += instr.sbx();
+      break;
+    case OpCode::JLT: {
+      int lhs = getInt(regs[instr.a]);
+      if (lhs < getInt(regs[instr.b]))
+        pc += instr.sc();
+      break;
+    }
+    case OpCode::JLE: {
+      int lhs = getInt(regs[instr.a]);
+      if (lhs <= getInt(regs[instr.b]))
+        pc += instr.sc();
+      break;
+    }
+    case OpCode::JGT: {
+      int lhs = getInt(regs[instr.a]);
+      if (lhs > getInt(regs[instr.b]))
+        pc += instr.sc();
+      break;
+    }
+    case OpCode::JGE: {
+      int lhs = getInt(regs[instr.a]);
+      if (lhs >= getInt(regs[instr.b]))
+        pc += instr.sc();
+      break;
+    }
+    case OpCode::JEQ:
+      if (areEqual(regs[instr.a], regs[instr.b]))
+        pc += instr.sc();
+      break;
+    case OpCode::JNE:
+      if (!areEqual(regs[instr.a], regs[instr.b]))
+        pc += instr.sc();
+      break;
+    case OpCode::INPUT: {
+      auto &input = Utils::Input::get();
+      auto value = input.read();
+      if (!value) {
+        logger.error(input.getFailure().pos, input.getFailure().message);
+        throw Errors::RuntimeError{};
+      }
+      regs[instr.a] = *value;
+      break;
+    }
+    case OpCode::PRINT:
+      print(regs[instr.a]);
+      break;
+    case OpCode::CHECKCALL: {
+      // Function values hold the index of their chunk
+      if (!regs[instr.a].isFunc())
+        throw error("Not a function");
+      if (program.chunks[regs[instr.a].asFunc()].paramsCount != instr.c)
+        throw error("Wrong number of arguments");
+      break;
+    }
+    case OpCode::CALL:
+      enterFrame(program.chunks[regs[instr.a].asFunc()], instr.a, instr.c);
+      break;
+    case OpCode::CALLD:
+      enterFrame(program.chunks[instr.b], instr.a, instr.c);
+      break;
+    case OpCode::RET: {
+      if (frames.empty())
+        return;
+      PrslObject value = regs[instr.a];
+      auto frame = frames.back();
+      frames.pop_back();
+
+      chunk = frame.chunk;
+      pc = frame.returnPc;
+      base = frame.base;
+      regs = stack.data() + base;
+      // The call instruction names the register receiving the result
+      regs[(pc - 1)->a] = value;
+      break;
+    }
+    case OpCode::ERROR: {
+      const auto &info = program.errors[instr.bx()];
+      throw Errors::reportRuntimeError(logger, program.tokens[info.token],
+                                       info.message);
+    }
+    }
+  }
+}
+
+} // namespace prsl::VM
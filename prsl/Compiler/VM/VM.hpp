@@ -0,0 +1,31 @@
+#pragma once
+
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/Compiler/VM/Bytecode.hpp"
+#include "prsl/Debug/Logger.hpp"
+
+#include <filesystem>
+
+namespace prsl::VM {
+
+using Errors::Logger;
+
+// Executes programs by compiling them into bytecode first and running it on a
+// register machine, instead of walking the AST
+class VM {
+public:
+  explicit VM(Compiler::CompilerFlags *flags, Logger &logger);
+  bool dump(const std::filesystem::path &path) const;
+
+  void visitStmt(const AST::StmtPtrVariant &stmt);
+
+private:
+  void execute(const Program &program);
+
+private:
+  Compiler::CompilerFlags *flags;
+  Logger &logger;
+};
+
+} // namespace prsl::VM
@@ -13,7 +13,7 @@ namespace prsl::Errors {
 template <typename T>
 T reportError(Logger &logger, const prsl::Types::Token &token,
               const std::string &message) noexcept {
-  logger.error(token.getStartPos(),
+  logger.error(logger.locate(token.getLocation()),
                "at '"s + token.toString() + "': "s + message);
   return T{};
 }
@@ -1,4 +1,5 @@
 #include "prsl/Debug/Logger.hpp"
+#include "prsl/Utils/Output.hpp"
 #include <config.hpp>
 
 #include <iostream>
@@ -21,6 +22,8 @@ void Logger::log(const LogLevel logLevel, std::string_view filename, int line,
                  int col, const string &msg) {
   counts[(unsigned int)logLevel]++;
   if (logLevel >= level) {
+    // Messages come after the output the program printed before them
+    Utils::Output::get().flush();
     ostream &outStream = (logLevel == LogLevel::ERROR) ? err : out;
     if (!filename.empty()) {
       outStream << filename;
@@ -97,4 +100,14 @@ void Logger::setLevel(LogLevel level) { this->level = level; }
 
 void Logger::setColor(bool color) { this->color = color; }
 
+void Logger::setLines(const Utils::LineTable *lines) { this->lines = lines; }
+
+const Utils::LineTable *Logger::getLines() const { return lines; }
+
+Utils::FilePos Logger::locate(const char *pos) const {
+  if (!lines)
+    return Utils::FilePos::UNKNOWN();
+  return lines->locate(pos);
+}
+
 } // namespace prsl::Errors
\ No newline at end of file
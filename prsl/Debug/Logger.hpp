@@ -1,5 +1,6 @@
 #pragma once
 
+#include "prsl/Utils/LineTable.hpp"
 #include "prsl/Utils/Utils.hpp"
 
 #include <array>
@@ -39,6 +40,11 @@ public:
   void setLevel(LogLevel level);
   void setColor(bool color);
 
+  // Lines of the source being compiled, positions in it are resolved by them
+  void setLines(const Utils::LineTable *lines);
+  [[nodiscard]] const Utils::LineTable *getLines() const;
+  [[nodiscard]] Utils::FilePos locate(const char *pos) const;
+
 private:
   void log(LogLevel level, std::string_view fileName, int line, int col,
            const string &msg);
@@ -50,6 +56,7 @@ private:
   ostream &out, &err;
   std::array<int, (size_t)LogLevel::QUIET> counts;
   bool color;
+  const Utils::LineTable *lines{nullptr};
   std::array<const char *, (size_t)LogLevel::QUIET> messages;
   std::array<std::pair<const char *, const char *>, (size_t)LogLevel::QUIET>
       colors;
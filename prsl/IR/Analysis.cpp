@@ -0,0 +1,140 @@
+#include "prsl/IR/Analysis.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace prsl::IR {
+
+namespace {
+
+constexpr unsigned none = std::numeric_limits<unsigned>::max();
+
+size_t getBlockIdsCount(const Function &function) {
+  unsigned count = 0;
+  for (const auto &block : function.blocks)
+    count = std::max(count, block->id + 1);
+  return count;
+}
+
+} // namespace
+
+std::vector<BasicBlock *> getReversePostOrder(const Function &function) {
+  std::vector<BasicBlock *> order;
+  std::vector<bool> visited(getBlockIdsCount(function));
+  // Successors are visited from the last one, so the first one is finished
+  // last and comes first in the reverse
+  std::vector<std::pair<BasicBlock *, size_t>> stack;
+  auto visit = [&](BasicBlock *block) {
+    visited[block->id] = true;
+    stack.emplace_back(block, block->getSuccessors().size());
+  };
+  visit(function.getEntry());
+  while (!stack.empty()) {
+    auto &[block, remaining] = stack.back();
+    if (remaining == 0) {
+      order.push_back(block);
+      stack.pop_back();
+      continue;
+    }
+    auto *succ = block->getSuccessors()[--remaining];
+    if (!visited[succ->id])
+      visit(succ);
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+DominatorTree::DominatorTree(const Function &function)
+    : order(getReversePostOrder(function)),
+      positions(getBlockIdsCount(function), none), idoms(order.size(), none),
+      children(order.size()) {
+  for (unsigned i = 0; i != order.size(); ++i)
+    positions[order[i]->id] = i;
+
+  auto intersect = [&](unsigned lhs, unsigned rhs) {
+    while (lhs != rhs) {
+      while (lhs > rhs)
+        lhs = idoms[lhs];
+      while (rhs > lhs)
+        rhs = idoms[rhs];
+    }
+    return lhs;
+  };
+
+  idoms[0] = 0;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (unsigned i = 1; i != order.size(); ++i) {
+      unsigned idom = none;
+      for (const auto *pred : order[i]->preds) {
+        unsigned position = positions[pred->id];
+        if (position == none || idoms[position] == none)
+          continue;
+        idom = idom == none ? position : intersect(position, idom);
+      }
+      if (idoms[i] != idom) {
+        idoms[i] = idom;
+        changed = true;
+      }
+    }
+  }
+
+  for (unsigned i = 1; i != order.size(); ++i)
+    children[idoms[i]].push_back(order[i]);
+}
+
+const std::vector<BasicBlock *> &
+DominatorTree::getChildren(const BasicBlock *block) const {
+  return children[positions[block->id]];
+}
+
+bool DominatorTree::dominates(const BasicBlock *dominator,
+                              const BasicBlock *block) const {
+  unsigned target = positions[dominator->id];
+  unsigned position = positions[block->id];
+  if (target == none || position == none)
+    return false;
+  // Dominators come before the blocks they dominate
+  while (position > target)
+    position = idoms[position];
+  return position == target;
+}
+
+std::vector<Loop> findLoops(const Function &function,
+                            const DominatorTree &tree) {
+  std::vector<Loop> loops;
+  auto idsCount = getBlockIdsCount(function);
+  for (auto *header : tree.getOrder()) {
+    Loop loop{header, {header}, std::vector<bool>(idsCount)};
+    loop.contains[header->id] = true;
+
+    // Blocks branching back to the header, and everything leading to them
+    std::vector<BasicBlock *> worklist;
+    for (auto *pred : header->preds)
+      if (tree.dominates(header, pred))
+        worklist.push_back(pred);
+    if (worklist.empty())
+      continue;
+    while (!worklist.empty()) {
+      auto *block = worklist.back();
+      worklist.pop_back();
+      if (loop.contains[block->id])
+        continue;
+      loop.contains[block->id] = true;
+      loop.blocks.push_back(block);
+      for (auto *pred : block->preds)
+        worklist.push_back(pred);
+    }
+    loops.push_back(std::move(loop));
+  }
+
+  // Loops nested in another one are smaller than it
+  std::stable_sort(loops.begin(), loops.end(), [](const auto &lhs,
+                                                  const auto &rhs) {
+    return lhs.blocks.size() < rhs.blocks.size();
+  });
+  return loops;
+}
+
+} // namespace prsl::IR
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "prsl/IR/IR.hpp"
+
+#include <vector>
+
+namespace prsl::IR {
+
+// Blocks reachable from the entry, each after its dominators. Of the two
+// successors of a branch, the first one comes first
+std::vector<BasicBlock *> getReversePostOrder(const Function &function);
+
+// Immediate dominators of the blocks, after Cooper, Harvey and Kennedy
+class DominatorTree {
+public:
+  explicit DominatorTree(const Function &function);
+
+  [[nodiscard]] const std::vector<BasicBlock *> &getOrder() const noexcept {
+    return order;
+  }
+  [[nodiscard]] const std::vector<BasicBlock *> &
+  getChildren(const BasicBlock *block) const;
+  [[nodiscard]] bool dominates(const BasicBlock *dominator,
+                               const BasicBlock *block) const;
+
+private:
+  // Reverse postorder and the position of every block in it, by block id
+  std::vector<BasicBlock *> order;
+  std::vector<unsigned> positions;
+  // Position of the immediate dominator, by position
+  std::vector<unsigned> idoms;
+  std::vector<std::vector<BasicBlock *>> children;
+};
+
+// A natural loop: the header and the blocks on the paths from it to the
+// blocks branching back to it
+struct Loop {
+  BasicBlock *header;
+  std::vector<BasicBlock *> blocks;
+  // By block id
+  std::vector<bool> contains;
+};
+
+// Loops of the function, inner ones before the loops around them
+std::vector<Loop> findLoops(const Function &function,
+                            const DominatorTree &tree);
+
+} // namespace prsl::IR
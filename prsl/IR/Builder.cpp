@@ -0,0 +1,633 @@
+#include "prsl/IR/Builder.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace prsl::IR {
+
+namespace {
+
+// Slot of the value a scope expression returns, in the frame of the scope
+constexpr unsigned resultSlot = std::numeric_limits<unsigned>::max();
+
+} // namespace
+
+std::unique_ptr<Module> Builder::build(const FunctionStmtPtr &program) {
+  module = std::make_unique<Module>();
+  try {
+    visitFunctionStmt(program);
+    for (auto &function : module->functions)
+      finish(*function);
+    // Before dead code goes, unused arithmetic fails in the AST backends too
+    checkTypes();
+    for (auto &function : module->functions)
+      removeBuildValues(*function);
+  } catch (const Unsupported &) {
+    return nullptr;
+  }
+  return std::move(module);
+}
+
+Instruction *Builder::visitLiteralExpr(const LiteralExprPtr &expr) {
+  auto *instr = emit(Opcode::CONST);
+  instr->imm = expr->literalVal;
+  return instr;
+}
+
+Instruction *Builder::visitGroupingExpr(const GroupingExprPtr &expr) {
+  return visitExpr(expr->expression);
+}
+
+Instruction *Builder::visitVarExpr(const VarExprPtr &expr) {
+  return read(expr->binding);
+}
+
+Instruction *Builder::visitInputExpr(const InputExprPtr &expr) {
+  return emit(Opcode::INPUT);
+}
+
+Instruction *Builder::visitAssignmentExpr(const AssignmentExprPtr &expr) {
+  return assign(expr->binding, visitExpr(expr->initializer));
+}
+
+Instruction *Builder::visitUnaryExpr(const UnaryExprPtr &expr) {
+  auto *value = visitExpr(expr->expression);
+  if (expr->op.getType() != Token::Type::MINUS)
+    throw Unsupported{};
+  return emit(Opcode::NEG, {value});
+}
+
+Instruction *Builder::visitBinaryExpr(const BinaryExprPtr &expr) {
+  auto *lhs = visitExpr(expr->lhsExpression);
+  auto *rhs = visitExpr(expr->rhsExpression);
+
+  Opcode op;
+  switch (expr->op.getType()) {
+  case Token::Type::PLUS:
+    op = Opcode::ADD;
+    break;
+  case Token::Type::MINUS:
+    op = Opcode::SUB;
+    break;
+  case Token::Type::STAR:
+    op = Opcode::MUL;
+    break;
+  case Token::Type::SLASH:
+    op = Opcode::DIV;
+    break;
+  case Token::Type::EQUAL_EQUAL:
+    op = Opcode::EQ;
+    break;
+  case Token::Type::NOT_EQUAL:
+    op = Opcode::NE;
+    break;
+  case Token::Type::LESS:
+    op = Opcode::LT;
+    break;
+  case Token::Type::LESS_EQUAL:
+    op = Opcode::LE;
+    break;
+  case Token::Type::GREATER:
+    op = Opcode::GT;
+    break;
+  case Token::Type::GREATER_EQUAL:
+    op = Opcode::GE;
+    break;
+  default:
+    throw Unsupported{};
+  }
+
+  auto *instr = emit(op, {lhs, rhs});
+  instr->token = &expr->op;
+  return instr;
+}
+
+Instruction *Builder::visitPostfixExpr(const PostfixExprPtr &expr) {
+  auto type = expr->op.getType();
+  if (type != Token::Type::PLUS_PLUS && type != Token::Type::MINUS_MINUS)
+    throw Unsupported{};
+  auto *old = visitExpr(expr->expression);
+  if (!std::holds_alternative<VarExprPtr>(expr->expression))
+    return old;
+
+  auto *one = emit(Opcode::CONST);
+  one->imm = 1;
+  auto *value = emit(
+      type == Token::Type::PLUS_PLUS ? Opcode::ADD : Opcode::SUB, {old, one});
+  if (!expr->binding)
+    throw Unsupported{};
+  writeVariable(frames.resolve(*expr->binding), state.block, value);
+  return old;
+}
+
+Instruction *Builder::visitScopeExpr(const ScopeExprPtr &expr) {
+  auto *exit = state.function->createBlock();
+  Variable result{expr.get(), resultSlot};
+  state.scopes.emplace_back(expr.get(), exit);
+  enterFrame(expr.get(), expr->slotsCount);
+
+  for (const auto &stmt : expr->statements)
+    visitStmt(stmt);
+  // Scopes ending without a return have no value
+  if (!isDead()) {
+    writeVariable(result, state.block, getUndef(*state.function));
+    jump(exit);
+  }
+
+  frames.leave();
+  state.scopes.pop_back();
+  sealBlock(exit);
+  state.block = exit;
+  return readVariable(result, exit);
+}
+
+Instruction *Builder::visitFuncExpr(const FuncExprPtr &expr) {
+  return getCallee(getFunction(*expr));
+}
+
+Instruction *Builder::visitCallExpr(const CallExprPtr &expr) {
+  // Which function is called is known once the variables are, after the
+  // whole program is built
+  auto *callee = expr->callee ? getCallee(getFunction(*expr->callee))
+                              : read(expr->binding);
+  std::vector<Instruction *> args;
+  for (const auto &arg : expr->arguments)
+    args.push_back(visitExpr(arg));
+
+  auto *call = emit(Opcode::CALL, {callee});
+  for (auto *arg : args)
+    call->addOperand(resolve(arg));
+  call->token = &expr->ident;
+  return call;
+}
+
+void Builder::visitVarStmt(const VarStmtPtr &stmt) {
+  std::ignore = assign(stmt->binding, visitExpr(stmt->initializer));
+}
+
+void Builder::visitIfStmt(const IfStmtPtr &stmt) {
+  auto *condition = visitExpr(stmt->condition);
+  auto *thenBlock = state.function->createBlock();
+  auto *mergeBlock = state.function->createBlock();
+  auto *elseBlock =
+      stmt->elseBranch ? state.function->createBlock() : mergeBlock;
+  branch(condition, thenBlock, elseBlock);
+  sealBlock(thenBlock);
+
+  state.block = thenBlock;
+  visitStmt(stmt->thenBranch);
+  jump(mergeBlock);
+
+  if (stmt->elseBranch) {
+    sealBlock(elseBlock);
+    state.block = elseBlock;
+    visitStmt(*stmt->elseBranch);
+    jump(mergeBlock);
+  }
+
+  sealBlock(mergeBlock);
+  state.block = mergeBlock;
+}
+
+void Builder::visitWhileStmt(const WhileStmtPtr &stmt) {
+  // The header is sealed once the body has jumped back to it
+  auto *header = state.function->createBlock();
+  jump(header);
+  state.block = header;
+
+  auto *condition = visitExpr(stmt->condition);
+  auto *body = state.function->createBlock();
+  auto *exit = state.function->createBlock();
+  branch(condition, body, exit);
+  sealBlock(body);
+  sealBlock(exit);
+
+  state.block = body;
+  visitStmt(stmt->body);
+  jump(header);
+  sealBlock(header);
+
+  state.block = exit;
+}
+
+void Builder::visitPrintStmt(const PrintStmtPtr &stmt) {
+  emit(Opcode::PRINT, {visitExpr(stmt->value)});
+}
+
+void Builder::visitExprStmt(const ExprStmtPtr &stmt) {
+  std::ignore = visitExpr(stmt->expression); // We don't need the result
+}
+
+void Builder::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  if (!stmt->params.empty())
+    throw Unsupported{};
+  startFunction("main");
+  frames.enter(stmt.get());
+
+  for (const auto &stmt : stmt->body)
+    visitStmt(stmt);
+  auto *zero = emit(Opcode::CONST);
+  emit(Opcode::RET, {zero});
+
+  frames.leave();
+}
+
+void Builder::visitBlockStmt(const BlockStmtPtr &stmt) {
+  enterFrame(stmt.get(), stmt->slotsCount);
+  for (const auto &stmt : stmt->statements)
+    visitStmt(stmt);
+  frames.leave();
+}
+
+void Builder::visitReturnStmt(const ReturnStmtPtr &stmt) {
+  // A return leaves the innermost scope expression, or the function itself
+  auto *value = visitExpr(stmt->retValue);
+  if (!state.scopes.empty()) {
+    auto [scope, exit] = state.scopes.back();
+    writeVariable({scope, resultSlot}, state.block, value);
+    jump(exit);
+  } else {
+    emit(Opcode::RET, {value});
+  }
+  startDeadBlock();
+}
+
+void Builder::visitNullStmt(const NullStmtPtr &stmt) {}
+
+Function *Builder::getFunction(const FuncExpr &expr) {
+  if (auto it = functions.find(&expr); it != functions.end())
+    return it->second;
+
+  auto caller = std::move(state);
+  startFunction(expr.name ? expr.name->getLexeme() : "func");
+  auto *function = state.function;
+  function->paramsCount = static_cast<unsigned>(expr.parameters.size());
+  // Registered before the body is built, so recursive calls find it
+  functions.emplace(&expr, function);
+
+  // Function body is evaluated in the frame of the parameters
+  frames.enter(&expr);
+  for (unsigned i = 0; i != function->paramsCount; ++i) {
+    auto *param = emit(Opcode::PARAM);
+    param->imm = static_cast<int>(i);
+    writeVariable({&expr, i}, state.block, param);
+  }
+  for (const auto &stmt : std::get<ScopeExprPtr>(expr.body)->statements)
+    visitStmt(stmt);
+  emit(Opcode::RET, {getUndef(*function)});
+  frames.leave();
+
+  state = std::move(caller);
+  return function;
+}
+
+void Builder::startFunction(std::string_view name) {
+  // Names are kept unique for the backends
+  std::string unique(name);
+  if (auto count = names[unique]++)
+    unique += "." + std::to_string(count);
+
+  auto *function =
+      module->functions.emplace_back(std::make_unique<Function>()).get();
+  function->name = std::move(unique);
+  state = FunctionState{function, function->createBlock()};
+  sealed.insert(state.block);
+}
+
+void Builder::finish(Function &function) {
+  // Phis lose the operands of blocks after returns, which makes some of them
+  // trivial
+  removeUnreachableBlocks(function);
+  for (auto &block : function.blocks) {
+    auto phis = std::vector(block->instructions.begin(),
+                            block->getFirstNonPhi());
+    for (auto *phi : phis)
+      if (phi->parent)
+        tryRemoveTrivialPhi(phi);
+  }
+
+  for (auto &block : function.blocks) {
+    for (auto *instr : block->instructions) {
+      if (instr->op != Opcode::CALL)
+        continue;
+      auto *callee = instr->operands.front();
+      while (callee->op == Opcode::COPY)
+        callee = callee->operands.front();
+      if (callee->op != Opcode::FUNC ||
+          callee->callee->paramsCount != instr->operands.size() - 1)
+        throw Unsupported{};
+      instr->callee = callee->callee;
+      instr->removeOperand(0);
+    }
+  }
+}
+
+void Builder::removeBuildValues(Function &function) {
+  eliminateDeadCode(function);
+
+  // Whatever is left of them is used as a value
+  for (auto &block : function.blocks) {
+    for (auto *instr : block->instructions)
+      if (instr->op == Opcode::UNDEF || instr->op == Opcode::FUNC)
+        throw Unsupported{};
+  }
+}
+
+void Builder::checkTypes() const {
+  // Whatever a value may be on some run. Parameters are what the arguments
+  // are, calls what the returns are
+  enum class Type { NONE, INT, BOOL, MIXED };
+  auto join = [](Type lhs, Type rhs) {
+    if (lhs == Type::NONE || lhs == rhs)
+      return rhs;
+    return rhs == Type::NONE ? lhs : Type::MIXED;
+  };
+
+  std::unordered_map<const Instruction *, Type> types;
+  std::unordered_map<const Function *, std::vector<Type>> params;
+  std::unordered_map<const Function *, Type> returns;
+  for (const auto &function : module->functions)
+    params[function.get()].resize(function->paramsCount);
+
+  auto update = [&](Type &type, Type value) {
+    auto joined = join(type, value);
+    bool changed = joined != type;
+    type = joined;
+    return changed;
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (const auto &function : module->functions) {
+      for (const auto &block : function->blocks) {
+        for (const auto *instr : block->instructions) {
+          Type type = Type::INT;
+          switch (instr->op) {
+          case Opcode::EQ:
+          case Opcode::NE:
+          case Opcode::LT:
+          case Opcode::LE:
+          case Opcode::GT:
+          case Opcode::GE:
+            type = Type::BOOL;
+            break;
+          case Opcode::PARAM:
+            type = params[function.get()][instr->imm];
+            break;
+          case Opcode::CALL:
+            for (size_t i = 0; i != instr->operands.size(); ++i)
+              changed |= update(params[instr->callee][i],
+                                types[instr->operands[i]]);
+            type = returns[instr->callee];
+            break;
+          case Opcode::PHI:
+            type = Type::NONE;
+            for (const auto *operand : instr->operands)
+              type = join(type, types[operand]);
+            break;
+          case Opcode::COPY:
+            type = types[instr->operands.front()];
+            break;
+          case Opcode::RET:
+            changed |= update(returns[function.get()],
+                              types[instr->operands.front()]);
+            break;
+          default:
+            break;
+          }
+          changed |= update(types[instr], type);
+        }
+      }
+    }
+  }
+
+  // Values that are never computed have no type and fail nothing
+  auto isInt = [&](const Instruction *value) {
+    auto type = types.at(value);
+    return type == Type::INT || type == Type::NONE;
+  };
+  for (const auto &function : module->functions) {
+    for (const auto &block : function->blocks) {
+      for (const auto *instr : block->instructions) {
+        switch (instr->op) {
+        case Opcode::EQ:
+        case Opcode::NE: {
+          // Ints never equal bools
+          if (join(types.at(instr->operands[0]),
+                   types.at(instr->operands[1])) == Type::MIXED)
+            throw Unsupported{};
+          break;
+        }
+        case Opcode::NEG:
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::LT:
+        case Opcode::LE:
+        case Opcode::GT:
+        case Opcode::GE:
+          if (!std::ranges::all_of(instr->operands, isInt))
+            throw Unsupported{};
+          break;
+        default:
+          break;
+        }
+      }
+    }
+  }
+}
+
+Instruction *Builder::emit(Opcode op,
+                           std::initializer_list<Instruction *> operands) {
+  auto *instr = state.function->create(op);
+  for (auto *operand : operands)
+    instr->addOperand(resolve(operand));
+  state.block->append(instr);
+  return instr;
+}
+
+Instruction *Builder::getUndef(Function &function) {
+  auto &undef = undefs[&function];
+  if (!undef) {
+    undef = function.create(Opcode::UNDEF);
+    undef->parent = function.getEntry();
+    auto &instructions = function.getEntry()->instructions;
+    instructions.insert(instructions.begin(), undef);
+  }
+  return undef;
+}
+
+Instruction *Builder::getCallee(Function *function) {
+  auto &callee = state.callees[function];
+  if (!callee) {
+    callee = state.function->create(Opcode::FUNC);
+    callee->callee = function;
+    callee->parent = state.function->getEntry();
+    auto &instructions = state.function->getEntry()->instructions;
+    instructions.insert(instructions.begin(), callee);
+  }
+  return callee;
+}
+
+Instruction *Builder::createPhi(BasicBlock *block) {
+  auto *phi = block->parent->create(Opcode::PHI);
+  phi->parent = block;
+  block->instructions.insert(block->instructions.begin(), phi);
+  return phi;
+}
+
+void Builder::jump(BasicBlock *target) {
+  if (isDead())
+    return;
+  auto *instr = emit(Opcode::JMP);
+  instr->targets = {target};
+  target->preds.push_back(state.block);
+}
+
+void Builder::branch(Instruction *condition, BasicBlock *thenBlock,
+                     BasicBlock *elseBlock) {
+  auto *instr = emit(Opcode::BR, {condition});
+  instr->targets = {thenBlock, elseBlock};
+  thenBlock->preds.push_back(state.block);
+  elseBlock->preds.push_back(state.block);
+}
+
+void Builder::startDeadBlock() {
+  state.block = state.function->createBlock();
+  sealed.insert(state.block);
+}
+
+bool Builder::isDead() const noexcept {
+  return state.block->preds.empty() &&
+         state.block != state.function->getEntry();
+}
+
+void Builder::enterFrame(const void *owner, unsigned slotsCount) {
+  frames.enter(owner);
+  for (unsigned slot = 0; slot != slotsCount; ++slot)
+    writeVariable({owner, slot}, state.block, getUndef(*state.function));
+}
+
+Instruction *Builder::assign(const std::optional<Binding> &binding,
+                             Instruction *value) {
+  if (!binding)
+    throw Unsupported{};
+  // Functions are not values, calls find them through the variables
+  if (value->op != Opcode::FUNC)
+    value = emit(Opcode::COPY, {value});
+  writeVariable(frames.resolve(*binding), state.block, value);
+  return value;
+}
+
+Instruction *Builder::read(const std::optional<Binding> &binding) {
+  if (!binding)
+    throw Unsupported{};
+  return readVariable(frames.resolve(*binding), state.block);
+}
+
+void Builder::writeVariable(const Variable &var, BasicBlock *block,
+                            Instruction *value) {
+  definitions[block][var] = value;
+}
+
+Instruction *Builder::readVariable(const Variable &var, BasicBlock *block) {
+  // Blocks with a single predecessor take the definition from it. They are
+  // walked in a loop, long chains of them would overflow the stack otherwise
+  std::vector<BasicBlock *> path;
+  Instruction *value;
+  for (;;) {
+    const auto &blockDefinitions = definitions[block];
+    if (auto it = blockDefinitions.find(var); it != blockDefinitions.end()) {
+      value = resolve(it->second);
+      break;
+    }
+    if (!sealed.contains(block) || block->preds.size() != 1) {
+      value = readVariableRecursive(var, block);
+      break;
+    }
+    // Only unreachable blocks, such as a loop after a return, lead back to
+    // themselves this way
+    if (path.size() == block->parent->blocks.size()) {
+      value = getUndef(*block->parent);
+      break;
+    }
+    path.push_back(block);
+    block = block->preds.front();
+  }
+  for (auto *visited : path)
+    writeVariable(var, visited, value);
+  return value;
+}
+
+Instruction *Builder::readVariableRecursive(const Variable &var,
+                                            BasicBlock *block) {
+  Instruction *value;
+  if (!sealed.contains(block)) {
+    // Operands are added once all the predecessors are known
+    value = createPhi(block);
+    incompletePhis[block].emplace_back(var, value);
+  } else if (block->preds.empty()) {
+    value = getUndef(*block->parent);
+  } else {
+    // Defined before the operands are read, to break cycles in loops
+    auto *phi = createPhi(block);
+    writeVariable(var, block, phi);
+    value = addPhiOperands(var, phi);
+  }
+  writeVariable(var, block, value);
+  return value;
+}
+
+Instruction *Builder::addPhiOperands(const Variable &var, Instruction *phi) {
+  for (auto *pred : phi->parent->preds)
+    phi->addOperand(readVariable(var, pred));
+  return tryRemoveTrivialPhi(phi);
+}
+
+Instruction *Builder::tryRemoveTrivialPhi(Instruction *phi) {
+  Instruction *same = nullptr;
+  for (auto *operand : phi->operands) {
+    if (operand == same || operand == phi)
+      continue;
+    if (same)
+      return phi;
+    same = operand;
+  }
+  // Phis of unreachable blocks and of the entry have no operands
+  if (!same)
+    same = getUndef(*phi->parent->parent);
+
+  std::vector<Instruction *> users;
+  for (auto *user : phi->users)
+    if (user != phi)
+      users.push_back(user);
+  phi->replaceAllUsesWith(same);
+  replaced[phi] = same;
+  phi->parent->parent->erase(phi);
+
+  // Phis using this one may have become trivial as well
+  for (auto *user : users)
+    if (user->op == Opcode::PHI && user->parent)
+      tryRemoveTrivialPhi(user);
+  return resolve(same);
+}
+
+void Builder::sealBlock(BasicBlock *block) {
+  // Reading the operands may add more incomplete phis to the block
+  auto &phis = incompletePhis[block];
+  for (size_t i = 0; i != phis.size(); ++i) {
+    auto [var, phi] = phis[i];
+    addPhiOperands(var, phi);
+  }
+  incompletePhis.erase(block);
+  sealed.insert(block);
+}
+
+Instruction *Builder::resolve(Instruction *value) const {
+  for (auto it = replaced.find(value); it != replaced.end();
+       it = replaced.find(value))
+    value = it->second;
+  return value;
+}
+
+} // namespace prsl::IR
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "prsl/AST/ASTVisitor.hpp"
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/IR/IR.hpp"
+#include "prsl/Optimizer/Optimizer.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace prsl::IR {
+
+using namespace AST;
+
+using Optimizer::Frames;
+using Optimizer::Variable;
+using Optimizer::VariableHash;
+
+// Builds the IR of a checked program. Variables are put in SSA form as the
+// blocks are built, after Braun et al., "Simple and Efficient Construction of
+// Static Single Assignment Form". The IR has integers only, comparisons give
+// 0 or 1: programs using functions as values, calling functions not known
+// before they run, reading variables that may be unassigned or doing
+// arithmetic on the results of comparisons are left to the AST backends,
+// which report the errors
+class Builder : public ASTVisitor<Builder, Instruction *> {
+public:
+  // Null if the IR can't express the program
+  std::unique_ptr<Module> build(const FunctionStmtPtr &program);
+
+private:
+  friend ASTVisitor;
+
+  struct Unsupported {};
+
+  Instruction *visitLiteralExpr(const LiteralExprPtr &expr);
+  Instruction *visitGroupingExpr(const GroupingExprPtr &expr);
+  Instruction *visitVarExpr(const VarExprPtr &expr);
+  Instruction *visitInputExpr(const InputExprPtr &expr);
+  Instruction *visitAssignmentExpr(const AssignmentExprPtr &expr);
+  Instruction *visitUnaryExpr(const UnaryExprPtr &expr);
+  Instruction *visitBinaryExpr(const BinaryExprPtr &expr);
+  Instruction *visitPostfixExpr(const PostfixExprPtr &expr);
+  Instruction *visitScopeExpr(const ScopeExprPtr &expr);
+  Instruction *visitFuncExpr(const FuncExprPtr &expr);
+  Instruction *visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitIfStmt(const IfStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitPrintStmt(const PrintStmtPtr &stmt);
+  void visitExprStmt(const ExprStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
+  void visitNullStmt(const NullStmtPtr &stmt);
+
+  // Builds the function on its first call or evaluation
+  Function *getFunction(const FuncExpr &expr);
+  // Creates the function with its entry block and continues in it
+  void startFunction(std::string_view name);
+  // Calls get their callees
+  void finish(Function &function);
+  // Bools only meet bools in comparisons and never get to arithmetic, where
+  // the AST backends fail
+  void checkTypes() const;
+  // Dead code goes, values that exist only while building must go with it
+  void removeBuildValues(Function &function);
+
+  Instruction *emit(Opcode op,
+                    std::initializer_list<Instruction *> operands = {});
+  Instruction *getUndef(Function &function);
+  Instruction *getCallee(Function *function);
+  Instruction *createPhi(BasicBlock *block);
+  void jump(BasicBlock *target);
+  void branch(Instruction *condition, BasicBlock *thenBlock,
+              BasicBlock *elseBlock);
+  // Continues in a block no code jumps to, after a jump or a return
+  void startDeadBlock();
+  // Whether the code being built never runs. Dead code doesn't jump, so the
+  // blocks it would jump to don't get predecessors that never run
+  [[nodiscard]] bool isDead() const noexcept;
+  // Variables of a new frame are unassigned, even in loops
+  void enterFrame(const void *owner, unsigned slotsCount);
+  Instruction *assign(const std::optional<Binding> &binding,
+                     Instruction *value);
+  Instruction *read(const std::optional<Binding> &binding);
+
+  void writeVariable(const Variable &var, BasicBlock *block,
+                     Instruction *value);
+  Instruction *readVariable(const Variable &var, BasicBlock *block);
+  Instruction *readVariableRecursive(const Variable &var, BasicBlock *block);
+  Instruction *addPhiOperands(const Variable &var, Instruction *phi);
+  Instruction *tryRemoveTrivialPhi(Instruction *phi);
+  void sealBlock(BasicBlock *block);
+  [[nodiscard]] Instruction *resolve(Instruction *value) const;
+
+  struct FunctionState {
+    Function *function{nullptr};
+    BasicBlock *block{nullptr};
+    // Scope expressions being built and the blocks their returns jump to,
+    // innermost last
+    std::vector<std::pair<const ScopeExpr *, BasicBlock *>> scopes{};
+    std::unordered_map<const Function *, Instruction *> callees{};
+  };
+
+  std::unique_ptr<Module> module;
+  FunctionState state;
+  std::unordered_map<const FuncExpr *, Function *> functions;
+  std::unordered_map<std::string, unsigned> names;
+  std::unordered_map<const Function *, Instruction *> undefs;
+  Frames frames;
+
+  using Definitions = std::unordered_map<Variable, Instruction *, VariableHash>;
+  std::unordered_map<const BasicBlock *, Definitions> definitions;
+  std::unordered_set<const BasicBlock *> sealed;
+  std::unordered_map<const BasicBlock *,
+                     std::vector<std::pair<Variable, Instruction *>>>
+      incompletePhis;
+  // Trivial phis and the values they were replaced with
+  std::unordered_map<const Instruction *, Instruction *> replaced;
+};
+
+} // namespace prsl::IR
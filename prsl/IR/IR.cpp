@@ -0,0 +1,342 @@
+#include "prsl/IR/IR.hpp"
+#include "prsl/IR/Analysis.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace prsl::IR {
+
+const char *getName(Opcode op) noexcept {
+  switch (op) {
+  case Opcode::CONST:
+    return "const";
+  case Opcode::PARAM:
+    return "param";
+  case Opcode::UNDEF:
+    return "undef";
+  case Opcode::FUNC:
+    return "func";
+  case Opcode::INPUT:
+    return "input";
+  case Opcode::NEG:
+    return "neg";
+  case Opcode::ADD:
+    return "add";
+  case Opcode::SUB:
+    return "sub";
+  case Opcode::MUL:
+    return "mul";
+  case Opcode::DIV:
+    return "div";
+  case Opcode::EQ:
+    return "eq";
+  case Opcode::NE:
+    return "ne";
+  case Opcode::LT:
+    return "lt";
+  case Opcode::LE:
+    return "le";
+  case Opcode::GT:
+    return "gt";
+  case Opcode::GE:
+    return "ge";
+  case Opcode::CALL:
+    return "call";
+  case Opcode::PHI:
+    return "phi";
+  case Opcode::COPY:
+    return "copy";
+  case Opcode::PRINT:
+    return "print";
+  case Opcode::JMP:
+    return "jmp";
+  case Opcode::BR:
+    return "br";
+  case Opcode::RET:
+    return "ret";
+  }
+  return "unknown";
+}
+
+bool isTerminator(Opcode op) noexcept {
+  return op == Opcode::JMP || op == Opcode::BR || op == Opcode::RET;
+}
+
+bool hasValue(Opcode op) noexcept {
+  return op != Opcode::PRINT && !isTerminator(op);
+}
+
+bool hasSideEffects(Opcode op) noexcept {
+  switch (op) {
+  case Opcode::INPUT:
+  case Opcode::DIV:
+  case Opcode::CALL:
+  case Opcode::PRINT:
+    return true;
+  default:
+    return isTerminator(op);
+  }
+}
+
+bool isCommutative(Opcode op) noexcept {
+  return op == Opcode::ADD || op == Opcode::MUL || op == Opcode::EQ ||
+         op == Opcode::NE;
+}
+
+void Instruction::addOperand(Instruction *value) {
+  operands.push_back(value);
+  value->users.push_back(this);
+}
+
+void Instruction::setOperand(size_t index, Instruction *value) {
+  auto &old = operands[index]->users;
+  old.erase(std::find(old.begin(), old.end(), this));
+  operands[index] = value;
+  value->users.push_back(this);
+}
+
+void Instruction::removeOperand(size_t index) {
+  auto &old = operands[index]->users;
+  old.erase(std::find(old.begin(), old.end(), this));
+  operands.erase(operands.begin() + index);
+}
+
+void Instruction::dropOperands() {
+  while (!operands.empty())
+    removeOperand(operands.size() - 1);
+}
+
+void Instruction::replaceAllUsesWith(Instruction *value) {
+  if (value == this)
+    return;
+  for (auto *user : users) {
+    for (auto &operand : user->operands) {
+      if (operand == this) {
+        operand = value;
+        value->users.push_back(user);
+        break;
+      }
+    }
+  }
+  users.clear();
+}
+
+Instruction *BasicBlock::getTerminator() const noexcept {
+  if (instructions.empty() || !isTerminator(instructions.back()->op))
+    return nullptr;
+  return instructions.back();
+}
+
+const std::vector<BasicBlock *> &BasicBlock::getSuccessors() const noexcept {
+  static const std::vector<BasicBlock *> none;
+  auto *terminator = getTerminator();
+  return terminator ? terminator->targets : none;
+}
+
+std::vector<Instruction *>::iterator BasicBlock::getFirstNonPhi() {
+  return std::find_if(instructions.begin(), instructions.end(),
+                      [](auto *instr) { return instr->op != Opcode::PHI; });
+}
+
+void BasicBlock::append(Instruction *instr) {
+  instr->parent = this;
+  instructions.push_back(instr);
+}
+
+void BasicBlock::insertBeforeTerminator(Instruction *instr) {
+  instr->parent = this;
+  instructions.insert(instructions.end() - 1, instr);
+}
+
+void BasicBlock::removePred(size_t index) {
+  preds.erase(preds.begin() + index);
+  for (auto it = instructions.begin(); it != getFirstNonPhi(); ++it)
+    (*it)->removeOperand(index);
+}
+
+BasicBlock *Function::createBlock() {
+  auto &block = blocks.emplace_back(std::make_unique<BasicBlock>());
+  block->id = nextBlock++;
+  block->parent = this;
+  return block.get();
+}
+
+Instruction *Function::create(Opcode op,
+                              std::initializer_list<Instruction *> operands) {
+  auto &instr = values.emplace_back(std::make_unique<Instruction>());
+  instr->op = op;
+  instr->id = static_cast<unsigned>(values.size() - 1);
+  for (auto *operand : operands)
+    instr->addOperand(operand);
+  return instr.get();
+}
+
+void Function::erase(Instruction *instr) {
+  instr->dropOperands();
+  auto &instructions = instr->parent->instructions;
+  instructions.erase(
+      std::find(instructions.begin(), instructions.end(), instr));
+  instr->parent = nullptr;
+}
+
+void Function::compact() {
+  std::erase_if(values, [](const auto &instr) { return !instr->parent; });
+
+  // Blocks are put in the order they execute in, where possible
+  std::unordered_map<const BasicBlock *, size_t> positions;
+  for (size_t i = 0; i != blocks.size(); ++i)
+    positions[blocks[i].get()] = i;
+  std::vector<std::unique_ptr<BasicBlock>> sorted;
+  for (auto *block : getReversePostOrder(*this))
+    sorted.push_back(std::move(blocks[positions[block]]));
+  blocks = std::move(sorted);
+
+  // Values are numbered before the instructions that produce none
+  unsigned value = 0;
+  nextBlock = 0;
+  for (auto &block : blocks) {
+    block->id = nextBlock++;
+    for (auto *instr : block->instructions)
+      if (hasValue(instr->op))
+        instr->id = value++;
+  }
+  for (auto &block : blocks) {
+    for (auto *instr : block->instructions)
+      if (!hasValue(instr->op))
+        instr->id = value++;
+  }
+}
+
+void removeUnreachableBlocks(Function &function) {
+  std::unordered_set<const BasicBlock *> reachable;
+  std::vector<BasicBlock *> worklist{function.getEntry()};
+  while (!worklist.empty()) {
+    auto *block = worklist.back();
+    worklist.pop_back();
+    if (!reachable.insert(block).second)
+      continue;
+    for (auto *succ : block->getSuccessors())
+      worklist.push_back(succ);
+  }
+  if (reachable.size() == function.blocks.size())
+    return;
+
+  for (auto &block : function.blocks) {
+    if (reachable.contains(block.get()))
+      continue;
+    for (auto *succ : block->getSuccessors()) {
+      if (!reachable.contains(succ))
+        continue;
+      for (size_t i = succ->preds.size(); i-- != 0;)
+        if (succ->preds[i] == block.get())
+          succ->removePred(i);
+    }
+  }
+  // Values of unreachable blocks are used by unreachable blocks only
+  for (auto &block : function.blocks) {
+    if (reachable.contains(block.get()))
+      continue;
+    for (auto *instr : block->instructions)
+      instr->dropOperands();
+    for (auto *instr : block->instructions)
+      instr->parent = nullptr;
+  }
+  std::erase_if(function.blocks, [&](const auto &block) {
+    return !reachable.contains(block.get());
+  });
+}
+
+void eliminateDeadCode(Function &function) {
+  std::unordered_set<const Instruction *> live;
+  std::vector<Instruction *> worklist;
+  for (auto &block : function.blocks) {
+    for (auto *instr : block->instructions)
+      if (hasSideEffects(instr->op))
+        worklist.push_back(instr);
+  }
+  while (!worklist.empty()) {
+    auto *instr = worklist.back();
+    worklist.pop_back();
+    if (!live.insert(instr).second)
+      continue;
+    for (auto *operand : instr->operands)
+      worklist.push_back(operand);
+  }
+
+  // Dead values may use each other, phis even themselves
+  std::vector<Instruction *> dead;
+  for (auto &block : function.blocks) {
+    for (auto *instr : block->instructions)
+      if (!live.contains(instr))
+        dead.push_back(instr);
+  }
+  for (auto *instr : dead)
+    instr->dropOperands();
+  for (auto *instr : dead)
+    function.erase(instr);
+}
+
+namespace {
+
+void printValue(std::ostream &os, const Instruction *value) {
+  os << '%' << value->id;
+}
+
+void printInstruction(std::ostream &os, const Instruction &instr) {
+  os << "  ";
+  if (hasValue(instr.op))
+    os << '%' << instr.id << " = ";
+  os << getName(instr.op);
+
+  switch (instr.op) {
+  case Opcode::CONST:
+  case Opcode::PARAM:
+    os << ' ' << instr.imm;
+    break;
+  case Opcode::FUNC:
+    os << " @" << instr.callee->name;
+    break;
+  case Opcode::CALL:
+    os << " @" << (instr.callee ? instr.callee->name : "?") << '(';
+    for (size_t i = 0; i != instr.operands.size(); ++i) {
+      os << (i ? ", " : "");
+      printValue(os, instr.operands[i]);
+    }
+    os << ')';
+    break;
+  case Opcode::PHI:
+    for (size_t i = 0; i != instr.operands.size(); ++i) {
+      os << (i ? ", [" : " [");
+      printValue(os, instr.operands[i]);
+      os << ", bb" << instr.parent->preds[i]->id << ']';
+    }
+    break;
+  default:
+    for (size_t i = 0; i != instr.operands.size(); ++i) {
+      os << (i ? ", " : " ");
+      printValue(os, instr.operands[i]);
+    }
+    for (auto *target : instr.targets)
+      os << (instr.operands.empty() ? " bb" : ", bb") << target->id;
+    break;
+  }
+  os << '\n';
+}
+
+} // namespace
+
+void print(const Module &module, std::ostream &os) {
+  for (size_t i = 0; i != module.functions.size(); ++i) {
+    const auto &function = *module.functions[i];
+    os << (i ? "\n" : "") << "func @" << function.name << " {\n";
+    for (const auto &block : function.blocks) {
+      os << "bb" << block->id << ":\n";
+      for (const auto *instr : block->instructions)
+        printInstruction(os, *instr);
+    }
+    os << "}\n";
+  }
+}
+
+} // namespace prsl::IR
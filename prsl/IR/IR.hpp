@@ -0,0 +1,139 @@
+#pragma once
+
+#include "prsl/Parser/Token.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace prsl::IR {
+
+using Types::Token;
+
+struct BasicBlock;
+struct Function;
+
+// Operands are described as a, b, ... in the order of Instruction::operands.
+// Every instruction but the ones marked (void) is a value of type int
+enum class Opcode : uint8_t {
+  CONST, // imm
+  PARAM, // parameter number imm of the function
+  UNDEF, // variable not assigned on some path, only while building
+  FUNC,  // callee, only while building: functions are not values
+  INPUT, // ?
+  NEG,   // -a
+  ADD,   // a + b
+  SUB,   // a - b
+  MUL,   // a * b
+  DIV,   // a / b, fails if b is zero
+  EQ,    // a == b
+  NE,    // a != b
+  LT,    // a < b
+  LE,    // a <= b
+  GT,    // a > b
+  GE,    // a >= b
+  CALL,  // callee(a, b, ...)
+  PHI,   // the operand of the predecessor the block was entered from
+  COPY,  // a
+  PRINT, // print a (void)
+  JMP,   // goto targets[0] (void)
+  BR,    // goto a ? targets[0] : targets[1] (void)
+  RET,   // return a (void)
+};
+
+[[nodiscard]] const char *getName(Opcode op) noexcept;
+[[nodiscard]] bool isTerminator(Opcode op) noexcept;
+// Whether the instruction is a value, not marked (void)
+[[nodiscard]] bool hasValue(Opcode op) noexcept;
+// Whether the instruction does more than produce its value, or may fail, so
+// it can't be removed when the value is unused or executed where it wasn't
+[[nodiscard]] bool hasSideEffects(Opcode op) noexcept;
+[[nodiscard]] bool isCommutative(Opcode op) noexcept;
+
+struct Instruction {
+  Opcode op;
+  // Number of the value, unique in its function
+  unsigned id;
+  int imm{0};
+  std::vector<Instruction *> operands;
+  // Instructions using the value, once for every operand they use it as
+  std::vector<Instruction *> users;
+  std::vector<BasicBlock *> targets;
+  Function *callee{nullptr};
+  // Operator of divisions, reported if the divisor is zero
+  const Token *token{nullptr};
+  // Null once the instruction is removed from its block
+  BasicBlock *parent{nullptr};
+
+  void addOperand(Instruction *value);
+  void setOperand(size_t index, Instruction *value);
+  void removeOperand(size_t index);
+  void dropOperands();
+  // Makes every user of the instruction use the value instead
+  void replaceAllUsesWith(Instruction *value);
+};
+
+struct BasicBlock {
+  // Number of the block, unique in its function
+  unsigned id;
+  // Phis come first, the terminator last
+  std::vector<Instruction *> instructions;
+  std::vector<BasicBlock *> preds;
+  Function *parent;
+
+  // Null while the block is being built
+  [[nodiscard]] Instruction *getTerminator() const noexcept;
+  [[nodiscard]] const std::vector<BasicBlock *> &getSuccessors() const noexcept;
+  [[nodiscard]] std::vector<Instruction *>::iterator getFirstNonPhi();
+
+  void append(Instruction *instr);
+  // Places the instruction right before the terminator
+  void insertBeforeTerminator(Instruction *instr);
+  // Removes the predecessor together with the operands phis take from it
+  void removePred(size_t index);
+};
+
+struct Function {
+  std::string name;
+  unsigned paramsCount{0};
+  // The entry block comes first
+  std::vector<std::unique_ptr<BasicBlock>> blocks;
+  // Every instruction created, including the removed ones
+  std::vector<std::unique_ptr<Instruction>> values;
+
+  [[nodiscard]] BasicBlock *getEntry() const noexcept {
+    return blocks.front().get();
+  }
+  BasicBlock *createBlock();
+  // The instruction is not placed in any block yet
+  Instruction *create(Opcode op,
+                      std::initializer_list<Instruction *> operands = {});
+  // Removes the instruction from its block and from the users of its
+  // operands. It must have no users itself
+  void erase(Instruction *instr);
+  // Frees the removed instructions and numbers the rest in the order of the
+  // blocks, blocks too
+  void compact();
+
+private:
+  unsigned nextBlock{0};
+};
+
+// A program: the top-level code and the functions it calls
+struct Module {
+  // The top-level code comes first
+  std::vector<std::unique_ptr<Function>> functions;
+};
+
+// Blocks the entry never leads to are removed, with the phi operands coming
+// from them
+void removeUnreachableBlocks(Function &function);
+// Removes instructions without side effects whose values are unused
+void eliminateDeadCode(Function &function);
+
+void print(const Module &module, std::ostream &os);
+
+} // namespace prsl::IR
@@ -0,0 +1,33 @@
+#include "prsl/IR/PassManager.hpp"
+#include "prsl/IR/Builder.hpp"
+
+namespace prsl::IR {
+
+PassManager::PassManager(Compiler::OptimizationLevel level) {
+  if (level == Compiler::OptimizationLevel::O0)
+    return;
+  passes.push_back(std::make_unique<CopyPropagation>());
+  passes.push_back(std::make_unique<GlobalValueNumbering>());
+  if (level == Compiler::OptimizationLevel::O1)
+    return;
+  passes.push_back(std::make_unique<LoopInvariantCodeMotion>());
+}
+
+void PassManager::run(Module &module) const {
+  for (auto &function : module.functions) {
+    for (const auto &pass : passes)
+      if (pass->run(*function))
+        eliminateDeadCode(*function);
+    function->compact();
+  }
+}
+
+std::unique_ptr<Module> compile(const AST::FunctionStmtPtr &program,
+                                Compiler::OptimizationLevel level) {
+  auto module = Builder().build(program);
+  if (module)
+    PassManager(level).run(*module);
+  return module;
+}
+
+} // namespace prsl::IR
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/IR/IR.hpp"
+#include "prsl/IR/Passes.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace prsl::IR {
+
+// Passes run at an optimization level: copy propagation and value numbering
+// from -O1 on, moving invariants out of loops from -O2 on. Unused values are
+// removed after every pass that changes the function
+class PassManager {
+public:
+  explicit PassManager(Compiler::OptimizationLevel level);
+
+  void run(Module &module) const;
+
+private:
+  std::vector<std::unique_ptr<Pass>> passes;
+};
+
+// IR of the program optimized at the level, null if the IR can't express it
+std::unique_ptr<Module> compile(const AST::FunctionStmtPtr &program,
+                                Compiler::OptimizationLevel level);
+
+} // namespace prsl::IR
@@ -0,0 +1,247 @@
+#include "prsl/IR/Passes.hpp"
+#include "prsl/IR/Analysis.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace prsl::IR {
+
+namespace {
+
+// The single value a phi chooses between, ignoring the phi itself
+Instruction *getSingleValue(const Instruction &phi) {
+  Instruction *same = nullptr;
+  for (auto *operand : phi.operands) {
+    if (operand == same || operand == &phi)
+      continue;
+    if (same)
+      return nullptr;
+    same = operand;
+  }
+  return same;
+}
+
+struct ValueKey {
+  Opcode op;
+  int imm;
+  std::vector<Instruction *> operands;
+  // Phis choose between the same values only in the same block
+  const BasicBlock *block;
+
+  bool operator==(const ValueKey &) const = default;
+};
+
+struct ValueKeyHash {
+  size_t operator()(const ValueKey &key) const noexcept {
+    size_t hash = std::hash<int>{}(static_cast<int>(key.op));
+    auto combine = [&](size_t value) {
+      hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+    combine(std::hash<int>{}(key.imm));
+    for (auto *operand : key.operands)
+      combine(std::hash<Instruction *>{}(operand));
+    combine(std::hash<const BasicBlock *>{}(key.block));
+    return hash;
+  }
+};
+
+bool isNumbered(Opcode op) {
+  switch (op) {
+  case Opcode::CONST:
+  case Opcode::PARAM:
+  case Opcode::NEG:
+  case Opcode::ADD:
+  case Opcode::SUB:
+  case Opcode::MUL:
+  // A division computed before has already failed if it was going to
+  case Opcode::DIV:
+  case Opcode::EQ:
+  case Opcode::NE:
+  case Opcode::LT:
+  case Opcode::LE:
+  case Opcode::GT:
+  case Opcode::GE:
+  case Opcode::PHI:
+    return true;
+  default:
+    return false;
+  }
+}
+
+ValueKey getKey(const Instruction &instr) {
+  ValueKey key{instr.op, instr.imm, instr.operands, nullptr};
+  if (isCommutative(instr.op))
+    std::sort(key.operands.begin(), key.operands.end());
+  if (instr.op == Opcode::PHI)
+    key.block = instr.parent;
+  return key;
+}
+
+// Gives the loop a block all the edges entering it from outside come through
+bool createPreheader(Function &function, BasicBlock *header,
+                     const Loop &loop) {
+  std::vector<size_t> outside;
+  for (size_t i = 0; i != header->preds.size(); ++i)
+    if (!loop.contains[header->preds[i]->id])
+      outside.push_back(i);
+  if (outside.empty())
+    return false;
+  if (outside.size() == 1) {
+    auto *terminator = header->preds[outside.front()]->getTerminator();
+    if (terminator->op == Opcode::JMP)
+      return false;
+  }
+
+  auto *preheader = function.createBlock();
+  for (auto index : outside) {
+    auto *pred = header->preds[index];
+    preheader->preds.push_back(pred);
+    for (auto &target : pred->getTerminator()->targets)
+      if (target == header)
+        target = preheader;
+  }
+  auto *jump = function.create(Opcode::JMP);
+  jump->targets = {header};
+  preheader->append(jump);
+
+  auto end = header->getFirstNonPhi();
+  for (auto it = header->instructions.begin(); it != end; ++it) {
+    auto *phi = *it;
+    Instruction *value = phi->operands[outside.front()];
+    if (outside.size() != 1) {
+      value = function.create(Opcode::PHI);
+      for (auto index : outside)
+        value->addOperand(phi->operands[index]);
+      value->parent = preheader;
+      preheader->instructions.insert(preheader->instructions.begin(), value);
+    }
+    for (auto index = outside.rbegin(); index != outside.rend(); ++index)
+      phi->removeOperand(*index);
+    phi->addOperand(value);
+  }
+  for (auto index = outside.rbegin(); index != outside.rend(); ++index)
+    header->preds.erase(header->preds.begin() + *index);
+  header->preds.push_back(preheader);
+  return true;
+}
+
+} // namespace
+
+bool CopyPropagation::run(Function &function) {
+  bool changed = false;
+  for (bool replaced = true; replaced;) {
+    replaced = false;
+    for (auto &block : function.blocks) {
+      auto instructions = block->instructions;
+      for (auto *instr : instructions) {
+        Instruction *value = nullptr;
+        if (instr->op == Opcode::COPY)
+          value = instr->operands.front();
+        else if (instr->op == Opcode::PHI)
+          value = getSingleValue(*instr);
+        if (!value)
+          continue;
+        instr->replaceAllUsesWith(value);
+        function.erase(instr);
+        replaced = true;
+      }
+    }
+    changed |= replaced;
+  }
+  return changed;
+}
+
+bool GlobalValueNumbering::run(Function &function) {
+  // Values are visible in the blocks their block dominates, so the table
+  // forgets the ones of a subtree once it is walked
+  DominatorTree tree(function);
+  std::unordered_map<ValueKey, Instruction *, ValueKeyHash> table;
+  std::vector<const ValueKey *> added;
+  bool changed = false;
+
+  auto number = [&](BasicBlock *block) {
+    auto instructions = block->instructions;
+    for (auto *instr : instructions) {
+      if (!isNumbered(instr->op))
+        continue;
+      auto [it, inserted] = table.try_emplace(getKey(*instr), instr);
+      if (inserted) {
+        added.push_back(&it->first);
+        continue;
+      }
+      instr->replaceAllUsesWith(it->second);
+      function.erase(instr);
+      changed = true;
+    }
+  };
+
+  struct Node {
+    BasicBlock *block;
+    size_t nextChild;
+    size_t addedCount;
+  };
+  std::vector<Node> stack;
+  auto enter = [&](BasicBlock *block) {
+    stack.push_back({block, 0, added.size()});
+    number(block);
+  };
+  enter(function.getEntry());
+  while (!stack.empty()) {
+    auto &node = stack.back();
+    const auto &children = tree.getChildren(node.block);
+    if (node.nextChild != children.size()) {
+      enter(children[node.nextChild++]);
+      continue;
+    }
+    for (auto count = node.addedCount; added.size() != count;) {
+      table.erase(*added.back());
+      added.pop_back();
+    }
+    stack.pop_back();
+  }
+  return changed;
+}
+
+bool LoopInvariantCodeMotion::run(Function &function) {
+  bool changed = false;
+  {
+    DominatorTree tree(function);
+    for (const auto &loop : findLoops(function, tree))
+      changed |= createPreheader(function, loop.header, loop);
+  }
+
+  DominatorTree tree(function);
+  for (const auto &loop : findLoops(function, tree)) {
+    BasicBlock *preheader = nullptr;
+    for (auto *pred : loop.header->preds)
+      if (!loop.contains[pred->id])
+        preheader = pred;
+
+    // Operands are hoisted before their users, as blocks are walked in the
+    // order they execute in
+    for (auto *block : tree.getOrder()) {
+      if (!loop.contains[block->id])
+        continue;
+      auto instructions = block->instructions;
+      for (auto *instr : instructions) {
+        if (instr->op == Opcode::PHI || hasSideEffects(instr->op))
+          continue;
+        bool invariant = std::ranges::none_of(
+            instr->operands,
+            [&](auto *operand) { return loop.contains[operand->parent->id]; });
+        if (!invariant)
+          continue;
+        auto &from = block->instructions;
+        from.erase(std::find(from.begin(), from.end(), instr));
+        preheader->insertBeforeTerminator(instr);
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+} // namespace prsl::IR
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "prsl/IR/IR.hpp"
+
+#include <string_view>
+
+namespace prsl::IR {
+
+class Pass {
+public:
+  virtual ~Pass() = default;
+
+  [[nodiscard]] virtual std::string_view getName() const = 0;
+  // Whether the function was changed
+  virtual bool run(Function &function) = 0;
+};
+
+// Copies and phis choosing between one value only are replaced with the value
+class CopyPropagation : public Pass {
+public:
+  [[nodiscard]] std::string_view getName() const override {
+    return "copy-propagation";
+  }
+  bool run(Function &function) override;
+};
+
+// Instructions computing a value that was already computed in a dominating
+// block are replaced with it
+class GlobalValueNumbering : public Pass {
+public:
+  [[nodiscard]] std::string_view getName() const override { return "gvn"; }
+  bool run(Function &function) override;
+};
+
+// Instructions computing the same value on every iteration of a loop are moved
+// before the loop
+class LoopInvariantCodeMotion : public Pass {
+public:
+  [[nodiscard]] std::string_view getName() const override { return "licm"; }
+  bool run(Function &function) override;
+};
+
+} // namespace prsl::IR
@@ -0,0 +1,537 @@
+#include "prsl/Optimizer/Inliner.hpp"
+#include "prsl/AST/TreeWalkerVisitor.hpp"
+#include "prsl/Utils/Utils.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace prsl::Optimizer {
+
+namespace {
+
+using Functions = std::unordered_set<const FuncExpr *>;
+
+// Measures a function body, in nodes, and looks for what keeps it from being
+// inlined. Reads are checked against the variables assigned on every path to
+// them, in the frame of the function and in the frames of its blocks
+class BodyChecker : public TreeWalkerVisitor<BodyChecker> {
+public:
+  explicit BodyChecker(const Functions &unfinished) : unfinished(unfinished) {}
+
+  bool check(const FuncExpr &function) {
+    paramsCount = function.parameters.size();
+    assigned.emplace_back(function.slotsCount, false);
+    std::fill_n(assigned.back().begin(), function.parameters.size(), true);
+    for (const auto &stmt : std::get<ScopeExprPtr>(function.body)->statements) {
+      // Returns of the body itself leave the scope replacing the call
+      if (const auto *ret = std::get_if<ReturnStmtPtr>(&stmt)) {
+        ++size;
+        visitExpr((*ret)->retValue);
+      } else {
+        visitStmt(stmt);
+      }
+    }
+    return inlinable;
+  }
+
+  [[nodiscard]] unsigned getSize() const noexcept { return size; }
+  [[nodiscard]] bool getWrites() const noexcept { return writes; }
+  [[nodiscard]] std::vector<int> &getTrace() noexcept { return trace; }
+  [[nodiscard]] std::vector<const CallExpr *> &getCalls() noexcept {
+    return calls;
+  }
+
+private:
+  friend ASTVisitor;
+
+  void visitLiteralExpr(const LiteralExprPtr &expr) { ++size; }
+
+  void visitGroupingExpr(const GroupingExprPtr &expr) {
+    ++size;
+    TreeWalkerVisitor::visitGroupingExpr(expr);
+  }
+
+  void visitVarExpr(const VarExprPtr &expr) {
+    ++size;
+    read(expr->binding);
+    if (assigned.size() == 1 && expr->binding->slot < paramsCount)
+      trace.push_back(static_cast<int>(expr->binding->slot));
+  }
+
+  void visitInputExpr(const InputExprPtr &expr) {
+    ++size;
+    trace.push_back(-1);
+  }
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    ++size;
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+    write(expr->binding);
+  }
+
+  void visitUnaryExpr(const UnaryExprPtr &expr) {
+    ++size;
+    TreeWalkerVisitor::visitUnaryExpr(expr);
+    trace.push_back(-1);
+  }
+
+  void visitBinaryExpr(const BinaryExprPtr &expr) {
+    ++size;
+    TreeWalkerVisitor::visitBinaryExpr(expr);
+    trace.push_back(-1);
+  }
+
+  void visitPostfixExpr(const PostfixExprPtr &expr) {
+    ++size;
+    TreeWalkerVisitor::visitPostfixExpr(expr);
+    write(expr->binding);
+  }
+
+  void visitScopeExpr(const ScopeExprPtr &expr) { inlinable = false; }
+
+  void visitFuncExpr(const FuncExprPtr &expr) { inlinable = false; }
+
+  // Calls through variables may reach any function, calls of the functions
+  // around this one may come back to it
+  void visitCallExpr(const CallExprPtr &expr) {
+    ++size;
+    if (!expr->callee || unfinished.contains(expr->callee))
+      inlinable = false;
+    calls.push_back(expr.get());
+    TreeWalkerVisitor::visitCallExpr(expr);
+    trace.push_back(-1);
+  }
+
+  void visitVarStmt(const VarStmtPtr &stmt) {
+    ++size;
+    TreeWalkerVisitor::visitVarStmt(stmt);
+    write(stmt->binding);
+  }
+
+  void visitIfStmt(const IfStmtPtr &stmt) {
+    ++size;
+    visitExpr(stmt->condition);
+    auto before = assigned;
+    visitStmt(stmt->thenBranch);
+    assigned = before;
+    if (stmt->elseBranch) {
+      visitStmt(*stmt->elseBranch);
+      assigned = std::move(before);
+    }
+  }
+
+  void visitWhileStmt(const WhileStmtPtr &stmt) { inlinable = false; }
+
+  void visitPrintStmt(const PrintStmtPtr &stmt) {
+    ++size;
+    TreeWalkerVisitor::visitPrintStmt(stmt);
+  }
+
+  void visitExprStmt(const ExprStmtPtr &stmt) {
+    ++size;
+    TreeWalkerVisitor::visitExprStmt(stmt);
+  }
+
+  void visitBlockStmt(const BlockStmtPtr &stmt) {
+    ++size;
+    assigned.emplace_back(stmt->slotsCount, false);
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    assigned.pop_back();
+  }
+
+  void visitReturnStmt(const ReturnStmtPtr &stmt) { inlinable = false; }
+
+  void read(const std::optional<Binding> &binding) {
+    if (!binding || binding->depth >= assigned.size() ||
+        !assigned[assigned.size() - 1 - binding->depth][binding->slot])
+      inlinable = false;
+  }
+
+  void write(const std::optional<Binding> &binding) {
+    writes = true;
+    if (binding && binding->depth < assigned.size())
+      assigned[assigned.size() - 1 - binding->depth][binding->slot] = true;
+  }
+
+  const Functions &unfinished;
+  // Slots assigned so far in the frames around the visited node
+  std::vector<std::vector<bool>> assigned;
+  std::vector<const CallExpr *> calls;
+  std::vector<int> trace;
+  size_t paramsCount{0};
+  unsigned size{0};
+  bool writes{false};
+  bool inlinable{true};
+};
+
+// Looks for writes of variables in an argument. Assignments in the frame of
+// the call may create variables, which the modes resolving variables by name
+// would create in the scope replacing the call
+class WritesFinder : public TreeWalkerVisitor<WritesFinder> {
+public:
+  [[nodiscard]] bool writes() const noexcept { return writesVariables; }
+  [[nodiscard]] bool assigns() const noexcept { return assignsCallFrame; }
+
+private:
+  friend ASTVisitor;
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    writesVariables = true;
+    assignsCallFrame |= depth == 0;
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+
+  void visitPostfixExpr(const PostfixExprPtr &expr) { writesVariables = true; }
+
+  void visitScopeExpr(const ScopeExprPtr &expr) {
+    ++depth;
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    --depth;
+  }
+
+  void visitFuncExpr(const FuncExprPtr &expr) {}
+
+  // Scopes entered inside the argument
+  unsigned depth{0};
+  bool writesVariables{false};
+  bool assignsCallFrame{false};
+};
+
+// Rebinds an argument moved into the scope replacing its call: the variables
+// it takes from around the call are a frame further away
+class BindingShifter : public TreeWalkerVisitor<BindingShifter> {
+private:
+  friend ASTVisitor;
+
+  void visitVarExpr(const VarExprPtr &expr) { shift(expr->binding); }
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    shift(expr->binding);
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+
+  void visitPostfixExpr(const PostfixExprPtr &expr) {
+    shift(expr->binding);
+    TreeWalkerVisitor::visitPostfixExpr(expr);
+  }
+
+  void visitScopeExpr(const ScopeExprPtr &expr) {
+    ++depth;
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    --depth;
+  }
+
+  // Functions see none of the variables around them
+  void visitFuncExpr(const FuncExprPtr &expr) {}
+
+  void visitCallExpr(const CallExprPtr &expr) {
+    shift(expr->binding);
+    TreeWalkerVisitor::visitCallExpr(expr);
+  }
+
+  void visitVarStmt(const VarStmtPtr &stmt) {
+    shift(stmt->binding);
+    TreeWalkerVisitor::visitVarStmt(stmt);
+  }
+
+  void visitBlockStmt(const BlockStmtPtr &stmt) {
+    ++depth;
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    --depth;
+  }
+
+  void shift(std::optional<Binding> &binding) const {
+    if (binding && binding->depth >= depth)
+      ++binding->depth;
+  }
+
+  // Frames entered inside the argument
+  unsigned depth{0};
+};
+
+// Whether an argument gives the same value wherever and however many times
+// it is evaluated in the body, with nothing else to observe
+bool isStable(const ExprPtrVariant &arg,
+              const std::function<bool(const Binding &)> &isAssigned) {
+  if (std::holds_alternative<LiteralExprPtr>(arg))
+    return true;
+  const auto *var = std::get_if<VarExprPtr>(&arg);
+  return var && (*var)->binding && isAssigned(*(*var)->binding);
+}
+
+// Arguments can take the place of the parameters in the returned expression
+// if it evaluates each of the others once, in the order of the call, before
+// anything that may fail or have an effect. The stable ones must not change
+// while the others are evaluated
+bool canSubstitute(const std::vector<int> &trace,
+                   const List<ExprPtrVariant> &args,
+                   const std::function<bool(const Binding &)> &isAssigned) {
+  std::vector<bool> stable;
+  std::vector<int> order;
+  for (const auto &arg : args) {
+    stable.push_back(isStable(arg, isAssigned));
+    if (stable.back())
+      continue;
+    WritesFinder finder;
+    finder.visitExpr(arg);
+    if (finder.writes())
+      return false;
+    order.push_back(static_cast<int>(stable.size() - 1));
+  }
+
+  size_t evaluated = 0;
+  for (int event : trace) {
+    if (event >= 0 && stable[event])
+      continue;
+    if (evaluated == order.size()) {
+      if (event >= 0)
+        return false;
+      continue;
+    }
+    if (event != order[evaluated])
+      return false;
+    ++evaluated;
+  }
+  return evaluated == order.size();
+}
+
+// Copies a function body checked by BodyChecker, renaming its variables.
+// The frames stay as they were, so do the bindings
+class Cloner : public ASTVisitor<Cloner, ExprPtrVariant, StmtPtrVariant> {
+public:
+  Cloner(Arena &arena, unsigned expansion)
+      : arena(arena), expansion(expansion) {}
+
+  // Variables get a suffix no name in the source can have
+  Token rename(const Token &name) {
+    auto [it, inserted] = names.try_emplace(name.getLexeme());
+    if (inserted) {
+      auto text = std::string(name.getLexeme()) + "." +
+                  std::to_string(expansion);
+      auto *memory = static_cast<char *>(arena.allocate(text.size(), 1));
+      std::ranges::copy(text, memory);
+      it->second = {memory, text.size()};
+    }
+    return Token(Token::Type::IDENT, it->second);
+  }
+
+  // Reads of the parameters are replaced with the arguments, which
+  // canSubstitute allowed. Constants and variables are copied, the others
+  // are read once and moved
+  void substitute(List<ExprPtrVariant> &args) { arguments = &args; }
+
+private:
+  friend ASTVisitor;
+
+  ExprPtrVariant visitLiteralExpr(const LiteralExprPtr &expr) {
+    return createLiteralEPV(arena, expr->literalVal);
+  }
+
+  ExprPtrVariant visitGroupingExpr(const GroupingExprPtr &expr) {
+    return createGroupingEPV(arena, visitExpr(expr->expression));
+  }
+
+  ExprPtrVariant visitVarExpr(const VarExprPtr &expr) {
+    if (arguments && expr->binding->depth == 0 &&
+        expr->binding->slot < arguments->size()) {
+      auto &arg = (*arguments)[expr->binding->slot];
+      if (const auto *literal = std::get_if<LiteralExprPtr>(&arg))
+        return createLiteralEPV(arena, (*literal)->literalVal);
+      const auto *var = std::get_if<VarExprPtr>(&arg);
+      // Inlined calls come grouped already
+      if (!var)
+        return std::holds_alternative<GroupingExprPtr>(arg) ||
+                       std::holds_alternative<CallExprPtr>(arg)
+                   ? std::move(arg)
+                   : createGroupingEPV(arena, std::move(arg));
+      auto clone = createVarEPV(arena, (*var)->ident);
+      std::get<VarExprPtr>(clone)->binding = (*var)->binding;
+      return clone;
+    }
+    auto clone = createVarEPV(arena, rename(expr->ident));
+    std::get<VarExprPtr>(clone)->binding = expr->binding;
+    return clone;
+  }
+
+  ExprPtrVariant visitInputExpr(const InputExprPtr &expr) {
+    return createInputEPV(arena);
+  }
+
+  ExprPtrVariant visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    auto clone = createAssignmentEPV(arena, rename(expr->varName),
+                                     visitExpr(expr->initializer));
+    std::get<AssignmentExprPtr>(clone)->binding = expr->binding;
+    return clone;
+  }
+
+  ExprPtrVariant visitUnaryExpr(const UnaryExprPtr &expr) {
+    return createUnaryEPV(arena, visitExpr(expr->expression), expr->op);
+  }
+
+  ExprPtrVariant visitBinaryExpr(const BinaryExprPtr &expr) {
+    return createBinaryEPV(arena, visitExpr(expr->lhsExpression), expr->op,
+                           visitExpr(expr->rhsExpression));
+  }
+
+  ExprPtrVariant visitPostfixExpr(const PostfixExprPtr &expr) {
+    auto clone = createPostfixEPV(arena, visitExpr(expr->expression), expr->op);
+    std::get<PostfixExprPtr>(clone)->binding = expr->binding;
+    return clone;
+  }
+
+  ExprPtrVariant visitScopeExpr(const ScopeExprPtr &expr) {
+    Utils::unreachable();
+  }
+
+  ExprPtrVariant visitFuncExpr(const FuncExprPtr &expr) {
+    Utils::unreachable();
+  }
+
+  // Named functions are called by their name, it stays
+  ExprPtrVariant visitCallExpr(const CallExprPtr &expr) {
+    auto arguments = arena.list<ExprPtrVariant>();
+    for (const auto &arg : expr->arguments)
+      arguments.push_back(visitExpr(arg));
+    auto clone = createCallEPV(arena, expr->ident, std::move(arguments));
+    auto &call = std::get<CallExprPtr>(clone);
+    call->binding = expr->binding;
+    call->callee = expr->callee;
+    return clone;
+  }
+
+  StmtPtrVariant visitVarStmt(const VarStmtPtr &stmt) {
+    auto clone = createVarSPV(arena, rename(stmt->varName),
+                              visitExpr(stmt->initializer));
+    std::get<VarStmtPtr>(clone)->binding = stmt->binding;
+    return clone;
+  }
+
+  StmtPtrVariant visitIfStmt(const IfStmtPtr &stmt) {
+    std::optional<StmtPtrVariant> elseBranch;
+    if (stmt->elseBranch)
+      elseBranch = visitStmt(*stmt->elseBranch);
+    return createIfSPV(arena, visitExpr(stmt->condition),
+                       visitStmt(stmt->thenBranch), std::move(elseBranch));
+  }
+
+  StmtPtrVariant visitWhileStmt(const WhileStmtPtr &stmt) {
+    Utils::unreachable();
+  }
+
+  StmtPtrVariant visitPrintStmt(const PrintStmtPtr &stmt) {
+    return createPrintSPV(arena, visitExpr(stmt->value));
+  }
+
+  StmtPtrVariant visitExprStmt(const ExprStmtPtr &stmt) {
+    return createExprSPV(arena, visitExpr(stmt->expression));
+  }
+
+  StmtPtrVariant visitFunctionStmt(const FunctionStmtPtr &stmt) {
+    Utils::unreachable();
+  }
+
+  StmtPtrVariant visitBlockStmt(const BlockStmtPtr &stmt) {
+    auto statements = arena.list<StmtPtrVariant>();
+    for (const auto &stmt : stmt->statements)
+      statements.push_back(visitStmt(stmt));
+    auto clone = createBlockSPV(arena, std::move(statements));
+    std::get<BlockStmtPtr>(clone)->slotsCount = stmt->slotsCount;
+    return clone;
+  }
+
+  // Returns of the body leave the scope now, not the function around it
+  StmtPtrVariant visitReturnStmt(const ReturnStmtPtr &stmt) {
+    return createReturnSPV(arena, stmt->retToken, visitExpr(stmt->retValue),
+                           false);
+  }
+
+  StmtPtrVariant visitNullStmt(const NullStmtPtr &stmt) {
+    return createNullSPV(arena);
+  }
+
+  Arena &arena;
+  unsigned expansion;
+  std::unordered_map<std::string_view, std::string_view> names;
+  List<ExprPtrVariant> *arguments{nullptr};
+};
+
+} // namespace
+
+Inliner::Inliner(Arena &arena, unsigned budget)
+    : arena(arena), budget(budget) {}
+
+void Inliner::enterFunction(const FuncExpr &function) {
+  if (function.name)
+    named[function.name->getLexeme()] = &function;
+  unfinished.insert(&function);
+}
+
+// Bodies are checked once optimized, they stay the same afterwards. The
+// functions around are still unfinished, calling them makes a cycle
+void Inliner::leaveFunction(const FuncExpr &function) {
+  BodyChecker checker(unfinished);
+  auto &summary = checked[&function];
+  if (checker.check(function) && checker.getSize() <= budget) {
+    const auto &statements = std::get<ScopeExprPtr>(function.body)->statements;
+    summary = {std::move(checker.getCalls()),
+               statements.size() == 1 && !checker.getWrites() &&
+                   std::holds_alternative<ReturnStmtPtr>(statements.front()),
+               std::move(checker.getTrace())};
+  }
+  unfinished.erase(&function);
+}
+
+std::optional<ExprPtrVariant>
+Inliner::expand(CallExpr &call, const FuncExpr &callee,
+                const std::function<bool(const Binding &)> &isAssigned) {
+  auto checkedIt = checked.find(&callee);
+  if (checkedIt == checked.end() || !checkedIt->second ||
+      call.arguments.size() != callee.parameters.size())
+    return std::nullopt;
+  const auto &summary = *checkedIt->second;
+  // The modes calling functions by name must find the same ones here
+  for (const auto *inner : summary.calls) {
+    auto it = named.find(inner->ident.getLexeme());
+    if (it == named.end() || it->second != inner->callee)
+      return std::nullopt;
+  }
+
+  const auto &body = std::get<ScopeExprPtr>(callee.body)->statements;
+  if (summary.isExpression &&
+      canSubstitute(summary.trace, call.arguments, isAssigned)) {
+    Cloner cloner(arena, 0);
+    cloner.substitute(call.arguments);
+    auto value =
+        cloner.visitExpr(std::get<ReturnStmtPtr>(body.front())->retValue);
+    if (std::holds_alternative<LiteralExprPtr>(value) ||
+        std::holds_alternative<VarExprPtr>(value))
+      return value;
+    return createGroupingEPV(arena, std::move(value));
+  }
+
+  for (const auto &arg : call.arguments) {
+    WritesFinder finder;
+    finder.visitExpr(arg);
+    if (finder.assigns())
+      return std::nullopt;
+  }
+
+  Cloner cloner(arena, ++expansions);
+  auto statements = arena.list<StmtPtrVariant>();
+  for (unsigned slot = 0; slot != call.arguments.size(); ++slot) {
+    auto &arg = call.arguments[slot];
+    BindingShifter().visitExpr(arg);
+    auto param = createVarSPV(arena, cloner.rename(callee.parameters[slot]),
+                              std::move(arg));
+    std::get<VarStmtPtr>(param)->binding = Binding{0, slot};
+    statements.push_back(std::move(param));
+  }
+  for (const auto &stmt : body)
+    statements.push_back(cloner.visitStmt(stmt));
+
+  auto scope = createScopeEPV(arena, std::move(statements));
+  std::get<ScopeExprPtr>(scope)->slotsCount = callee.slotsCount;
+  return scope;
+}
+
+} // namespace prsl::Optimizer
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "prsl/AST/NodeTypes.hpp"
+
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace prsl::Optimizer {
+
+using namespace AST;
+
+// Replaces calls of small functions with scope expressions computing the same
+// value. The parameters become the first variables of the scope, assigned
+// the arguments, and the returns of the body leave the scope. Every variable
+// of the body is renamed, so none of them meets a variable of the code around
+// the call in the modes resolving variables by name. Bodies only returning an
+// expression are substituted with no scope if the arguments are constants,
+// assigned variables, or evaluated first and once as in the call
+//
+// Functions calling themselves, directly or through the functions they are
+// defined in, are never inlined. Neither are the ones holding loops, nested
+// functions or scopes, returns out of a branch, or reads of variables that
+// may be unassigned, whose diagnostics would name the renamed variable
+class Inliner {
+public:
+  // Bodies of more nodes than the budget are left called
+  Inliner(Arena &arena, unsigned budget);
+
+  // Called around the optimization of every function. Functions are
+  // inlined once they are left, calls inside them are not replaced with
+  // them
+  void enterFunction(const FuncExpr &function);
+  void leaveFunction(const FuncExpr &function);
+
+  // The expression to replace the call with. The arguments are moved into
+  // it, the call is left empty. Variables isAssigned holds for are assigned
+  // on every path to the call
+  std::optional<ExprPtrVariant>
+  expand(CallExpr &call, const FuncExpr &callee,
+         const std::function<bool(const Binding &)> &isAssigned);
+
+private:
+  struct Summary {
+    // Calls of named functions in the body
+    std::vector<const CallExpr *> calls;
+    // The body returns an expression writing no variable and does nothing
+    // else
+    bool isExpression;
+    // Parameters the expression reads, and with -1 the operations that may
+    // fail or have an effect, in the order they are evaluated
+    std::vector<int> trace;
+  };
+
+  Arena &arena;
+  unsigned budget;
+  // Functions the names of calls resolve to, as semantic analysis did
+  std::unordered_map<std::string_view, const FuncExpr *> named;
+  std::unordered_set<const FuncExpr *> unfinished;
+  // Functions left, with the summaries of the ones that can be inlined
+  std::unordered_map<const FuncExpr *, std::optional<Summary>> checked;
+  unsigned expansions{0};
+};
+
+} // namespace prsl::Optimizer
@@ -0,0 +1,494 @@
+#include "prsl/Optimizer/Optimizer.hpp"
+#include "prsl/AST/TreeWalkerVisitor.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <tuple>
+
+namespace prsl::Optimizer {
+
+namespace {
+
+using Writes = std::unordered_map<Variable, unsigned, VariableHash>;
+using Defined = std::unordered_set<Variable, VariableHash>;
+
+// Counts the assignments, including increments and decrements, to every
+// variable of the program
+class WritesCounter : public TreeWalkerVisitor<WritesCounter> {
+public:
+  // Bindings are resolved against the frames the visited node is in
+  WritesCounter(Writes &writes, Frames frames)
+      : writes(writes), frames(std::move(frames)) {}
+
+private:
+  friend ASTVisitor;
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    count(expr->binding);
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+
+  void visitPostfixExpr(const PostfixExprPtr &expr) {
+    count(expr->binding);
+    TreeWalkerVisitor::visitPostfixExpr(expr);
+  }
+
+  void visitScopeExpr(const ScopeExprPtr &expr) {
+    frames.enter(expr.get());
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    frames.leave();
+  }
+
+  // Function bodies share the frame of the parameters, which the calls
+  // assign first
+  void visitFuncExpr(const FuncExprPtr &expr) {
+    frames.enter(expr.get());
+    for (unsigned slot = 0; slot != expr->parameters.size(); ++slot)
+      ++writes[{expr.get(), slot}];
+    TreeWalkerVisitor::visitScopeExpr(std::get<ScopeExprPtr>(expr->body));
+    frames.leave();
+  }
+
+  void visitVarStmt(const VarStmtPtr &stmt) {
+    count(stmt->binding);
+    TreeWalkerVisitor::visitVarStmt(stmt);
+  }
+
+  void visitFunctionStmt(const FunctionStmtPtr &stmt) {
+    frames.enter(stmt.get());
+    TreeWalkerVisitor::visitFunctionStmt(stmt);
+    frames.leave();
+  }
+
+  void visitBlockStmt(const BlockStmtPtr &stmt) {
+    frames.enter(stmt.get());
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    frames.leave();
+  }
+
+  void count(const std::optional<Binding> &binding) {
+    if (binding)
+      ++writes[frames.resolve(*binding)];
+  }
+
+  Writes &writes;
+  Frames frames;
+};
+
+// Looks for what the code being removed would take from the rest of the
+// program: the first assignment of a variable of the frames around it, which
+// backends compiling the program in order define the variable by, or a named
+// function, which calls after it refer to
+class RemovalChecker : public TreeWalkerVisitor<RemovalChecker> {
+public:
+  RemovalChecker(const Frames &frames, const Defined &defined)
+      : frames(frames), defined(defined) {}
+
+  [[nodiscard]] bool isRemovable() const noexcept { return removable; }
+
+private:
+  friend ASTVisitor;
+
+  void visitAssignmentExpr(const AssignmentExprPtr &expr) {
+    check(expr->binding);
+    TreeWalkerVisitor::visitAssignmentExpr(expr);
+  }
+
+  void visitScopeExpr(const ScopeExprPtr &expr) {
+    ++depth;
+    TreeWalkerVisitor::visitScopeExpr(expr);
+    --depth;
+  }
+
+  void visitFuncExpr(const FuncExprPtr &expr) {
+    if (expr->name)
+      removable = false;
+    ++functions;
+    TreeWalkerVisitor::visitFuncExpr(expr);
+    --functions;
+  }
+
+  void visitVarStmt(const VarStmtPtr &stmt) {
+    check(stmt->binding);
+    TreeWalkerVisitor::visitVarStmt(stmt);
+  }
+
+  void visitBlockStmt(const BlockStmtPtr &stmt) {
+    ++depth;
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    --depth;
+  }
+
+  // Variables of the frames inside the code go away with it, functions see
+  // none of the variables around them
+  void check(const std::optional<Binding> &binding) {
+    if (!binding || functions || binding->depth < depth)
+      return;
+    auto var = frames.resolve({binding->depth - depth, binding->slot});
+    if (!defined.contains(var))
+      removable = false;
+  }
+
+  const Frames &frames;
+  const Defined &defined;
+  // Frames and functions entered inside the code
+  unsigned depth{0};
+  unsigned functions{0};
+  bool removable{true};
+};
+
+// Computes as the backends do, on 32-bit integers wrapping around. Division
+// by zero and the division overflowing are left to fail when the program runs
+std::optional<int> evaluateArithmetic(Token::Type type, int lhs, int rhs) {
+  switch (type) {
+  case Token::Type::PLUS:
+    return static_cast<int>(int64_t{lhs} + rhs);
+  case Token::Type::MINUS:
+    return static_cast<int>(int64_t{lhs} - rhs);
+  case Token::Type::STAR:
+    return static_cast<int>(int64_t{lhs} * rhs);
+  case Token::Type::SLASH:
+    if (rhs == 0 || (lhs == INT32_MIN && rhs == -1))
+      return std::nullopt;
+    return lhs / rhs;
+  default:
+    return std::nullopt;
+  }
+}
+
+// Comparisons of ints, and equality of values of the same type. Arithmetic
+// on bools and equality of a bool and an int are left to the modes, the
+// interpreter fails on the former while native code computes on ints
+std::optional<Constant> evaluate(Token::Type type, Constant lhs,
+                                 Constant rhs) {
+  switch (type) {
+  case Token::Type::NOT_EQUAL:
+    if (lhs.isBool != rhs.isBool)
+      return std::nullopt;
+    return Constant{lhs.value != rhs.value, true};
+  case Token::Type::EQUAL_EQUAL:
+    if (lhs.isBool != rhs.isBool)
+      return std::nullopt;
+    return Constant{lhs.value == rhs.value, true};
+  default:
+    break;
+  }
+
+  if (lhs.isBool || rhs.isBool)
+    return std::nullopt;
+  switch (type) {
+  case Token::Type::LESS:
+    return Constant{lhs.value < rhs.value, true};
+  case Token::Type::LESS_EQUAL:
+    return Constant{lhs.value <= rhs.value, true};
+  case Token::Type::GREATER:
+    return Constant{lhs.value > rhs.value, true};
+  case Token::Type::GREATER_EQUAL:
+    return Constant{lhs.value >= rhs.value, true};
+  default:
+    if (auto value = evaluateArithmetic(type, lhs.value, rhs.value))
+      return Constant{*value};
+    return std::nullopt;
+  }
+}
+
+// The value of a scope expression left assigning only constants to its own
+// variables before returning a constant, as inlined calls with constant
+// arguments are
+std::optional<int> getConstantValue(const ScopeExpr &scope) {
+  const auto &statements = scope.statements;
+  if (statements.empty() ||
+      !std::holds_alternative<ReturnStmtPtr>(statements.back()))
+    return std::nullopt;
+  const auto &value = std::get<ReturnStmtPtr>(statements.back())->retValue;
+  if (!std::holds_alternative<LiteralExprPtr>(value))
+    return std::nullopt;
+  for (size_t i = 0; i + 1 < statements.size(); ++i) {
+    const auto *stmt = std::get_if<VarStmtPtr>(&statements[i]);
+    if (!stmt || !(*stmt)->binding || (*stmt)->binding->depth != 0 ||
+        !std::holds_alternative<LiteralExprPtr>((*stmt)->initializer))
+      return std::nullopt;
+  }
+  return std::get<LiteralExprPtr>(value)->literalVal;
+}
+
+} // namespace
+
+size_t VariableHash::operator()(const Variable &var) const noexcept {
+  return std::hash<const void *>()(var.first) * 31 + var.second;
+}
+
+Variable Frames::resolve(const Binding &binding) const {
+  return {owners[owners.size() - 1 - binding.depth], binding.slot};
+}
+
+Optimizer::Optimizer(Arena &arena, Compiler::OptimizationLevel level,
+                     unsigned inlineBudget)
+    : arena(arena), propagate(level >= Compiler::OptimizationLevel::O2),
+      inlining(inlineBudget != 0), inliner(arena, inlineBudget) {}
+
+void Optimizer::run(StmtPtrVariant &program) {
+  if (propagate || inlining) {
+    WritesCounter counter(writes, frames);
+    counter.visitStmt(program);
+  }
+  optimize(program);
+}
+
+std::optional<Constant>
+Optimizer::visitLiteralExpr(const LiteralExprPtr &expr) {
+  return Constant{expr->literalVal};
+}
+
+std::optional<Constant>
+Optimizer::visitGroupingExpr(const GroupingExprPtr &expr) {
+  return fold(expr->expression);
+}
+
+std::optional<Constant> Optimizer::visitVarExpr(const VarExprPtr &expr) {
+  if (!propagate || !expr->binding)
+    return std::nullopt;
+  auto it = constants.find(frames.resolve(*expr->binding));
+  if (it == constants.end())
+    return std::nullopt;
+  return Constant{it->second};
+}
+
+std::optional<Constant> Optimizer::visitInputExpr(const InputExprPtr &expr) {
+  return std::nullopt;
+}
+
+std::optional<Constant>
+Optimizer::visitAssignmentExpr(const AssignmentExprPtr &expr) {
+  fold(expr->initializer);
+  define(expr->binding);
+  return std::nullopt;
+}
+
+std::optional<Constant> Optimizer::visitUnaryExpr(const UnaryExprPtr &expr) {
+  auto value = fold(expr->expression);
+  if (!value || value->isBool || expr->op.getType() != Token::Type::MINUS)
+    return std::nullopt;
+  return Constant{static_cast<int>(-int64_t{value->value})};
+}
+
+std::optional<Constant> Optimizer::visitBinaryExpr(const BinaryExprPtr &expr) {
+  auto lhs = fold(expr->lhsExpression);
+  auto rhs = fold(expr->rhsExpression);
+  if (!lhs || !rhs)
+    return std::nullopt;
+  return evaluate(expr->op.getType(), *lhs, *rhs);
+}
+
+std::optional<Constant>
+Optimizer::visitPostfixExpr(const PostfixExprPtr &expr) {
+  // The operand is what gets incremented, it stays as it is
+  std::ignore = visitExpr(expr->expression);
+  return std::nullopt;
+}
+
+std::optional<Constant> Optimizer::visitScopeExpr(const ScopeExprPtr &expr) {
+  frames.enter(expr.get());
+  optimizeStatements(expr->statements);
+  frames.leave();
+  if (auto value = getConstantValue(*expr))
+    return Constant{*value};
+  return std::nullopt;
+}
+
+std::optional<Constant> Optimizer::visitFuncExpr(const FuncExprPtr &expr) {
+  inliner.enterFunction(*expr);
+  frames.enter(expr.get());
+  for (unsigned slot = 0; slot != expr->parameters.size(); ++slot) {
+    defined.emplace(expr.get(), slot);
+    assigned.emplace(expr.get(), slot);
+  }
+  optimizeStatements(std::get<ScopeExprPtr>(expr->body)->statements);
+  frames.leave();
+  inliner.leaveFunction(*expr);
+  return std::nullopt;
+}
+
+std::optional<Constant> Optimizer::visitCallExpr(const CallExprPtr &expr) {
+  for (auto &arg : expr->arguments)
+    fold(arg);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant> Optimizer::visitVarStmt(const VarStmtPtr &stmt) {
+  fold(stmt->initializer);
+  define(stmt->binding);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant> Optimizer::visitIfStmt(const IfStmtPtr &stmt) {
+  auto condition = fold(stmt->condition);
+  auto *elseBranch = stmt->elseBranch ? &*stmt->elseBranch : nullptr;
+  bool isTrue = condition && condition->value;
+  auto *taken = isTrue ? &stmt->thenBranch : elseBranch;
+  auto *skipped = isTrue ? elseBranch : &stmt->thenBranch;
+  if (!condition || (skipped && !isRemovable(*skipped))) {
+    optimize(stmt->thenBranch);
+    if (elseBranch)
+      optimize(*elseBranch);
+    return std::nullopt;
+  }
+
+  if (!taken)
+    return createNullSPV(arena);
+  optimize(*taken);
+  return std::move(*taken);
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitWhileStmt(const WhileStmtPtr &stmt) {
+  auto condition = fold(stmt->condition);
+  if (condition && !condition->value && isRemovable(stmt->body))
+    return createNullSPV(arena);
+  optimize(stmt->body);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitPrintStmt(const PrintStmtPtr &stmt) {
+  fold(stmt->value);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitExprStmt(const ExprStmtPtr &stmt) {
+  // Constants have no side effects
+  if (fold(stmt->expression))
+    return createNullSPV(arena);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  frames.enter(stmt.get());
+  optimizeStatements(stmt->body);
+  frames.leave();
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitBlockStmt(const BlockStmtPtr &stmt) {
+  frames.enter(stmt.get());
+  optimizeStatements(stmt->statements);
+  frames.leave();
+  if (stmt->statements.empty())
+    return createNullSPV(arena);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitReturnStmt(const ReturnStmtPtr &stmt) {
+  fold(stmt->retValue);
+  return std::nullopt;
+}
+
+std::optional<StmtPtrVariant>
+Optimizer::visitNullStmt(const NullStmtPtr &stmt) {
+  return std::nullopt;
+}
+
+std::optional<Constant> Optimizer::fold(ExprPtrVariant &expr) {
+  // The body replacing a call is optimized with the arguments it is given
+  if (inlining && std::holds_alternative<CallExprPtr>(expr))
+    inlineCall(expr);
+  auto value = visitExpr(expr);
+  if (value && !value->isBool && !std::holds_alternative<LiteralExprPtr>(expr))
+    expr = createLiteralEPV(arena, value->value);
+  return value;
+}
+
+void Optimizer::inlineCall(ExprPtrVariant &expr) {
+  auto &call = *std::get<CallExprPtr>(expr);
+  const FuncExpr *callee = call.callee;
+  if (!callee && call.binding) {
+    auto it = functions.find(frames.resolve(*call.binding));
+    if (it != functions.end())
+      callee = it->second;
+  }
+  if (!callee)
+    return;
+  auto replacement =
+      inliner.expand(call, *callee, [&](const Binding &binding) {
+        return assigned.contains(frames.resolve(binding));
+      });
+  if (!replacement)
+    return;
+  expr = std::move(*replacement);
+  // Variables of the body are assigned in the scope replacing the call only
+  WritesCounter counter(writes, frames);
+  counter.visitExpr(expr);
+}
+
+void Optimizer::optimize(StmtPtrVariant &stmt) {
+  if (auto replacement = visitStmt(stmt))
+    stmt = std::move(*replacement);
+}
+
+void Optimizer::optimizeStatements(List<StmtPtrVariant> &statements) {
+  auto kept = statements.begin();
+  bool returned = false;
+  for (auto &stmt : statements) {
+    // Nothing after a return runs
+    if (returned && isRemovable(stmt))
+      continue;
+    optimize(stmt);
+    if (std::holds_alternative<NullStmtPtr>(stmt))
+      continue;
+    if (!returned)
+      recordAssignment(stmt);
+    returned = returned || std::holds_alternative<ReturnStmtPtr>(stmt);
+    if (&*kept != &stmt)
+      *kept = std::move(stmt);
+    ++kept;
+  }
+  statements.erase(kept, statements.end());
+}
+
+// Statements of a frame run in order each time the frame is entered, before
+// anything after them reads the variable
+void Optimizer::recordAssignment(const StmtPtrVariant &stmt) {
+  const std::optional<Binding> *binding = nullptr;
+  const ExprPtrVariant *value = nullptr;
+  if (std::holds_alternative<VarStmtPtr>(stmt)) {
+    const auto &varStmt = std::get<VarStmtPtr>(stmt);
+    binding = &varStmt->binding;
+    value = &varStmt->initializer;
+  } else if (std::holds_alternative<ExprStmtPtr>(stmt)) {
+    const auto &expression = std::get<ExprStmtPtr>(stmt)->expression;
+    if (!std::holds_alternative<AssignmentExprPtr>(expression))
+      return;
+    const auto &assignment = std::get<AssignmentExprPtr>(expression);
+    binding = &assignment->binding;
+    value = &assignment->initializer;
+  }
+  if (!binding || !*binding)
+    return;
+
+  auto var = frames.resolve(**binding);
+  if ((*binding)->depth == 0)
+    assigned.insert(var);
+  if (auto it = writes.find(var); it == writes.end() || it->second != 1)
+    return;
+  if (propagate && std::holds_alternative<LiteralExprPtr>(*value))
+    constants.emplace(var, std::get<LiteralExprPtr>(*value)->literalVal);
+  else if (inlining && std::holds_alternative<FuncExprPtr>(*value))
+    functions.emplace(var, std::get<FuncExprPtr>(*value).get());
+}
+
+void Optimizer::define(const std::optional<Binding> &binding) {
+  if (binding)
+    defined.insert(frames.resolve(*binding));
+}
+
+bool Optimizer::isRemovable(const StmtPtrVariant &stmt) const {
+  RemovalChecker checker(frames, defined);
+  checker.visitStmt(stmt);
+  return checker.isRemovable();
+}
+
+} // namespace prsl::Optimizer
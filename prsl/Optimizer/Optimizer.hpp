@@ -0,0 +1,127 @@
+#pragma once
+
+#include "prsl/AST/ASTVisitor.hpp"
+#include "prsl/AST/NodeTypes.hpp"
+#include "prsl/Compiler/CompilerFlags.hpp"
+#include "prsl/Optimizer/Inliner.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace prsl::Optimizer {
+
+using namespace AST;
+
+// A variable: the node whose frame it lives in and its slot in that frame.
+// Programs, blocks, scopes and functions have frames of their own
+using Variable = std::pair<const void *, unsigned>;
+
+struct VariableHash {
+  size_t operator()(const Variable &var) const noexcept;
+};
+
+// Frames around the visited node, innermost last. Bindings made by Semantics
+// are resolved against them
+class Frames {
+public:
+  void enter(const void *owner) { owners.push_back(owner); }
+  void leave() { owners.pop_back(); }
+  [[nodiscard]] Variable resolve(const Binding &binding) const;
+
+private:
+  std::vector<const void *> owners;
+};
+
+// Value of an expression known before the program runs. Comparisons give
+// bools, which no literal can stand for and which the interpreter keeps apart
+// from ints in arithmetic and equality
+struct Constant {
+  int value;
+  bool isBool{false};
+};
+
+// Simplifies the checked AST before any backend gets it. Constant
+// expressions are folded, branches and loops with constant conditions are
+// pruned, statements after returns are removed, calls of small functions are
+// replaced with their bodies and, from -O2 on, variables assigned a constant
+// once are replaced with it. Code defining something the rest of the program
+// uses is never removed
+//
+// Expression handlers return the value of the expression if it is a
+// constant without side effects, the parent replaces it with a literal if it
+// is an int.
+// Statement handlers return the statement to replace theirs with
+class Optimizer : public ASTVisitor<Optimizer, std::optional<Constant>,
+                                    std::optional<StmtPtrVariant>> {
+public:
+  // Functions of up to inlineBudget nodes are inlined
+  Optimizer(Arena &arena, Compiler::OptimizationLevel level,
+            unsigned inlineBudget);
+
+  void run(StmtPtrVariant &program);
+
+private:
+  friend ASTVisitor;
+
+  std::optional<Constant> visitLiteralExpr(const LiteralExprPtr &expr);
+  std::optional<Constant> visitGroupingExpr(const GroupingExprPtr &expr);
+  std::optional<Constant> visitVarExpr(const VarExprPtr &expr);
+  std::optional<Constant> visitInputExpr(const InputExprPtr &expr);
+  std::optional<Constant> visitAssignmentExpr(const AssignmentExprPtr &expr);
+  std::optional<Constant> visitUnaryExpr(const UnaryExprPtr &expr);
+  std::optional<Constant> visitBinaryExpr(const BinaryExprPtr &expr);
+  std::optional<Constant> visitPostfixExpr(const PostfixExprPtr &expr);
+  std::optional<Constant> visitScopeExpr(const ScopeExprPtr &expr);
+  std::optional<Constant> visitFuncExpr(const FuncExprPtr &expr);
+  std::optional<Constant> visitCallExpr(const CallExprPtr &expr);
+
+  std::optional<StmtPtrVariant> visitVarStmt(const VarStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitIfStmt(const IfStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitWhileStmt(const WhileStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitPrintStmt(const PrintStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitExprStmt(const ExprStmtPtr &stmt);
+  std::optional<StmtPtrVariant>
+  visitFunctionStmt(const FunctionStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitBlockStmt(const BlockStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitReturnStmt(const ReturnStmtPtr &stmt);
+  std::optional<StmtPtrVariant> visitNullStmt(const NullStmtPtr &stmt);
+
+  // Replaces the expression with a literal if it is a constant
+  std::optional<Constant> fold(ExprPtrVariant &expr);
+  // Replaces the call with the body of the function it calls if the function
+  // is known where it is called and small enough
+  void inlineCall(ExprPtrVariant &expr);
+  void optimize(StmtPtrVariant &stmt);
+  // Optimizes the statements of a frame, dropping the ones that do nothing
+  // and the ones after a return
+  void optimizeStatements(List<StmtPtrVariant> &statements);
+  // Remembers the variable of its own frame a statement of a frame assigns,
+  // and the constant or the function it is assigned if it is the only
+  // assignment of the variable
+  void recordAssignment(const StmtPtrVariant &stmt);
+  void define(const std::optional<Binding> &binding);
+  // Whether code that never runs can be dropped without losing a variable
+  // or a named function the rest of the program refers to
+  [[nodiscard]] bool isRemovable(const StmtPtrVariant &stmt) const;
+
+  Arena &arena;
+  bool propagate;
+  bool inlining;
+  Inliner inliner;
+  Frames frames;
+  // Number of assignments to each variable anywhere in the program
+  std::unordered_map<Variable, unsigned, VariableHash> writes;
+  // Variables assigned so far, in the order of the source
+  std::unordered_set<Variable, VariableHash> defined;
+  // Variables assigned by the statements run before the visited one in the
+  // frames around it, and parameters
+  std::unordered_set<Variable, VariableHash> assigned;
+  std::unordered_map<Variable, int, VariableHash> constants;
+  std::unordered_map<Variable, const FuncExpr *, VariableHash> functions;
+};
+
+} // namespace prsl::Optimizer
@@ -0,0 +1,84 @@
+#include "prsl/Parser/ParallelScanner.hpp"
+#include "prsl/Parser/Scanner.hpp"
+
+#include <llvm/Support/Parallel.h>
+#include <llvm/Support/Threading.h>
+
+
+namespace prsl::Scanner {
+
+namespace {
+
+struct Part {
+  std::string_view text;
+  std::vector<Token> tokens{};
+  bool startsInComment{false};
+  bool endsInComment{false};
+};
+
+// Parts end right after a newline. No token goes on over a line end, only
+// multiline comments do
+std::vector<Part> split(std::string_view source, unsigned count) {
+  std::vector<Part> parts;
+  size_t size = source.size() / count + 1;
+  for (size_t begin = 0; begin != source.size();) {
+    size_t end = source.size();
+    if (source.size() - begin > size) {
+      end = source.find('\n', begin + size);
+      end = end == std::string_view::npos ? source.size() : end + 1;
+    }
+    parts.push_back({source.substr(begin, end - begin)});
+    begin = end;
+  }
+  return parts;
+}
+
+// The EOF of the part is left out
+void scan(Part &part, bool inComment) {
+  Scanner scanner(part.text, inComment);
+  part.tokens.clear();
+  part.tokens.reserve(part.text.size() / 4 + 1);
+  for (auto token = scanner.tokenizeOne(); token.getType() != Token::Type::EOF_;
+       token = scanner.tokenizeOne())
+    part.tokens.push_back(token);
+  part.startsInComment = inComment;
+  part.endsInComment = scanner.isInComment();
+}
+
+} // namespace
+
+std::vector<Token> tokenizeParallel(std::string_view source,
+                                    unsigned threads) {
+  auto parts = split(source, threads);
+  if (parts.size() < 2)
+    return Scanner(source).tokenize();
+
+  // Takes effect when the first parallel loop starts the threads
+  llvm::parallel::strategy = llvm::hardware_concurrency(threads);
+
+  // Comments rarely go on over the end of a part, so every part is scanned
+  // as if it did not start inside of one
+  llvm::parallelForEach(parts, [](Part &part) { scan(part, false); });
+
+  // Parts after a comment that does go on are scanned again. The error about
+  // a comment without the end is kept at the end of the source only
+  for (size_t i = 1; i != parts.size(); ++i) {
+    auto &previous = parts[i - 1];
+    if (previous.endsInComment)
+      previous.tokens.pop_back();
+    if (parts[i].startsInComment != previous.endsInComment)
+      scan(parts[i], previous.endsInComment);
+  }
+
+  size_t count = 1;
+  for (const auto &part : parts)
+    count += part.tokens.size();
+  std::vector<Token> tokens;
+  tokens.reserve(count);
+  for (const auto &part : parts)
+    tokens.insert(tokens.end(), part.tokens.begin(), part.tokens.end());
+  tokens.emplace_back(Token::Type::EOF_, "");
+  return tokens;
+}
+
+} // namespace prsl::Scanner
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "prsl/Parser/Token.hpp"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace prsl::Scanner {
+
+using prsl::Types::Token;
+
+// Sources of this size and larger are scanned in parallel unless the number
+// of threads is given
+constexpr size_t parallelThreshold = 4 << 20;
+
+// Splits the source into parts at line ends and scans them on the given
+// number of threads. The tokens are the same as Scanner::tokenize gives
+std::vector<Token> tokenizeParallel(std::string_view source,
+                                    unsigned threads);
+
+} // namespace prsl::Scanner
@@ -11,17 +11,15 @@ using prsl::Types::Token;
 using AST::ExprPtrVariant;
 using AST::StmtPtrVariant;
 
-Parser::Parser(const std::vector<Token> &tokens, Errors::Logger &logger)
-    : tokens(tokens), logger(logger) {
-  this->currentIter = this->tokens.begin();
-}
+Parser::Parser(TokenStream tokens, AST::Arena &arena, Errors::Logger &logger)
+    : tokens(tokens), arena(arena), logger(logger) {}
 
 StmtPtrVariant Parser::parse() { return program(); }
 
 //  <program> ::=
 //    <decl>*
 StmtPtrVariant Parser::program() {
-  std::vector<StmtPtrVariant> statements;
+  auto statements = arena.list<StmtPtrVariant>();
   try {
     while (!isEOF()) {
       statements.emplace_back(decl());
@@ -29,7 +27,7 @@ StmtPtrVariant Parser::program() {
   } catch (const Errors::ParseError &e) {
     synchronize();
   }
-  return createFunctionSPV({}, std::move(statements));
+  return createFunctionSPV(arena, {}, std::move(statements));
 }
 
 // <decl> ::=
@@ -51,7 +49,7 @@ StmtPtrVariant Parser::varDecl() {
   ExprPtrVariant initializer = expr();
   if (match(Token::Type::SEMICOLON))
     advance();
-  return createVarSPV(ident, std::move(initializer));
+  return createVarSPV(arena, ident, std::move(initializer));
 }
 
 // <stmt> ::=
@@ -94,7 +92,7 @@ StmtPtrVariant Parser::ifStmt() {
     elseBranch = stmt();
   }
 
-  return AST::createIfSPV(std::move(condition), std::move(thenBranch),
+  return AST::createIfSPV(arena, std::move(condition), std::move(thenBranch),
                           std::move(elseBranch));
 }
 
@@ -102,23 +100,25 @@ StmtPtrVariant Parser::ifStmt() {
 //   "{" <program> "}"
 StmtPtrVariant Parser::blockStmt() {
   advance();
-  std::vector<StmtPtrVariant> statements;
+  auto statements = arena.list<StmtPtrVariant>();
   while (!match(Token::Type::RIGHT_BRACE) && !isEOF()) {
     statements.emplace_back(decl());
   }
   consumeOrError(Token::Type::RIGHT_BRACE, "Expect '}' after block");
-  return AST::createBlockSPV(std::move(statements));
+  return AST::createBlockSPV(arena, std::move(statements));
 }
 
 // <whileStmt> ::=
 //   "while(" <expr> ")" <stmt>
 StmtPtrVariant Parser::whileStmt() {
+  Token token = peek(); // For diagnostics purposes
   advance();
   consumeOrError(Token::Type::LEFT_PAREN, "Expect '(' after while");
   ExprPtrVariant condition = expr();
   consumeOrError(Token::Type::RIGHT_PAREN, "Expect ')' after while condition");
 
-  return AST::createWhileSPV(std::move(condition), stmt());
+  return AST::createWhileSPV(arena, std::move(token), std::move(condition),
+                             stmt());
 }
 
 // <printStmt> ::=
@@ -127,7 +127,7 @@ StmtPtrVariant Parser::printStmt() {
   advance();
   ExprPtrVariant value = expr();
   consumeOrError(Token::Type::SEMICOLON, "Expect ';' after print statement");
-  return AST::createPrintSPV(std::move(value));
+  return AST::createPrintSPV(arena, std::move(value));
 }
 
 // <returnStmt> ::=
@@ -136,7 +136,7 @@ StmtPtrVariant Parser::returnStmt() {
   auto token = getTokenAdvance();
   ExprPtrVariant value = expr();
   consumeOrError(Token::Type::SEMICOLON, "Expect ';' after return statement");
-  return AST::createReturnSPV(token, std::move(value), true);
+  return AST::createReturnSPV(arena, token, std::move(value), true);
 }
 
 // <exprStmt> ::=
@@ -145,14 +145,14 @@ StmtPtrVariant Parser::exprStmt() {
   auto expression = expr();
   consumeOrError(Token::Type::SEMICOLON,
                  "Expect ';' after expression statement");
-  return AST::createExprSPV(std::move(expression));
+  return AST::createExprSPV(arena, std::move(expression));
 }
 
 // <nullStmt> ::=
 //   ";"
 StmtPtrVariant Parser::nullStmt() {
   advance();
-  return AST::createNullSPV();
+  return AST::createNullSPV(arena);
 }
 
 // <expr> ::=
@@ -169,7 +169,7 @@ ExprPtrVariant Parser::assignmentExpr() {
     advance();
     if (std::holds_alternative<AST::VarExprPtr>(expr)) {
       Token varName = std::get<AST::VarExprPtr>(expr)->ident;
-      return AST::createAssignmentEPV(varName, assignmentExpr());
+      return AST::createAssignmentEPV(arena, varName, assignmentExpr());
     }
 
     throw error("Expect assignment target, got something else");
@@ -194,7 +194,7 @@ ExprPtrVariant Parser::comparisonExpr() {
   auto expr = additionExpr();
   while (match(comparatorTypes)) {
     Token op = getTokenAdvance();
-    expr = createBinaryEPV(std::move(expr), op, additionExpr());
+    expr = createBinaryEPV(arena, std::move(expr), op, additionExpr());
   }
   return expr;
 }
@@ -208,7 +208,7 @@ ExprPtrVariant Parser::additionExpr() {
   auto expr = multiplicationExpr();
   while (match(additionTypes)) {
     Token op = getTokenAdvance();
-    expr = createBinaryEPV(std::move(expr), op, multiplicationExpr());
+    expr = createBinaryEPV(arena, std::move(expr), op, multiplicationExpr());
   }
   return expr;
 }
@@ -222,7 +222,7 @@ ExprPtrVariant Parser::multiplicationExpr() {
   auto expr = unaryExpr();
   while (match(multiplicationTypes)) {
     Token op = getTokenAdvance();
-    expr = createBinaryEPV(std::move(expr), op, unaryExpr());
+    expr = createBinaryEPV(arena, std::move(expr), op, unaryExpr());
   }
   return expr;
 }
@@ -234,7 +234,7 @@ ExprPtrVariant Parser::unaryExpr() {
   if (match(Token::Type::MINUS)) {
     auto op = getTokenAdvance();
     auto expr = postfixExpr();
-    return createUnaryEPV(std::move(expr), op);
+    return createUnaryEPV(arena, std::move(expr), op);
   }
   return postfixExpr();
 }
@@ -246,7 +246,7 @@ ExprPtrVariant Parser::unaryExpr() {
 ExprPtrVariant Parser::postfixExpr() {
   auto expr = callExpr();
   if (match({Token::Type::PLUS_PLUS, Token::Type::MINUS_MINUS})) {
-    return createPostfixEPV(std::move(expr), getTokenAdvance());
+    return createPostfixEPV(arena, std::move(expr), getTokenAdvance());
   }
   return expr;
 }
@@ -262,11 +262,11 @@ ExprPtrVariant Parser::callExpr() {
     }
     auto ident = std::get<AST::VarExprPtr>(expr)->ident;
     advance();
-    std::vector<ExprPtrVariant> args;
+    auto args = arena.list<ExprPtrVariant>();
     if (!match(Token::Type::RIGHT_PAREN))
       args = arguments();
     consumeOrError(Token::Type::RIGHT_PAREN, "Expect ')' after arguments");
-    expr = createCallEPV(std::move(ident), std::move(args));
+    expr = createCallEPV(arena, std::move(ident), std::move(args));
   }
 
   return expr;
@@ -274,8 +274,8 @@ ExprPtrVariant Parser::callExpr() {
 
 // <arguments> ::=
 //   <assignmentExpr> ("," <assignmentExpr>)*
-std::vector<ExprPtrVariant> Parser::arguments() {
-  std::vector<ExprPtrVariant> args;
+AST::List<ExprPtrVariant> Parser::arguments() {
+  auto args = arena.list<ExprPtrVariant>();
   args.emplace_back(assignmentExpr());
   while (match(Token::Type::COMMA)) {
     advance();
@@ -317,7 +317,7 @@ ExprPtrVariant Parser::literalExpr() {
   auto [ptr, ec] = std::from_chars(view.begin(), view.end(), result);
 
   if (ec == std::errc())
-    return AST::createLiteralEPV(result);
+    return AST::createLiteralEPV(arena, result);
 
   throw error("Literal is not a number");
 }
@@ -329,21 +329,21 @@ ExprPtrVariant Parser::groupingExpr() {
   ExprPtrVariant expression = expr();
   consumeOrError(Token::Type::RIGHT_PAREN,
                  "Expect a closing paren after expression");
-  return AST::createGroupingEPV(std::move(expression));
+  return AST::createGroupingEPV(arena, std::move(expression));
 }
 
 // <varExpr> ::=
 //   <ident>
 ExprPtrVariant Parser::varExpr() {
   Token varName = getTokenAdvance();
-  return AST::createVarEPV(varName);
+  return AST::createVarEPV(arena, varName);
 }
 
 // <inputExpr> ::=
 //   "?"
 ExprPtrVariant Parser::inputExpr() {
   advance();
-  return AST::createInputEPV();
+  return AST::createInputEPV(arena);
 }
 
 // <scopeExpr> ::=
@@ -354,7 +354,7 @@ ExprPtrVariant Parser::scopeExpr() {
   auto beginBrace = peek(); // For diagnostics purposes
 #pragma warning(pop)
   advance();
-  std::vector<StmtPtrVariant> statements;
+  auto statements = arena.list<StmtPtrVariant>();
   bool hasReturn{false};
   while (!match(Token::Type::RIGHT_BRACE) && !isEOF()) {
     auto declaration = decl();
@@ -364,9 +364,7 @@ ExprPtrVariant Parser::scopeExpr() {
     statements.push_back(std::move(declaration));
   }
 
-  auto unknownPos = Utils::FilePos::UNKNOWN();
-  auto returnToken =
-      Token{Token::Type::RETURN, "return", unknownPos, unknownPos};
+  auto returnToken = Token{Token::Type::RETURN, "return"};
 
   if (statements.size() &&
       std::holds_alternative<AST::ExprStmtPtr>(statements.back())) {
@@ -380,16 +378,16 @@ ExprPtrVariant Parser::scopeExpr() {
     }
 
     statements.back() =
-        AST::createReturnSPV(returnToken, std::move(expr), isFunction);
+        AST::createReturnSPV(arena, returnToken, std::move(expr), isFunction);
   } else if (!hasReturn) {
-    logger.warning(beginBrace.getStartPos(),
+    logger.warning(logger.locate(beginBrace.getLocation()),
                    "Scope expression implicitly returns 0");
     statements.emplace_back(AST::createReturnSPV(
-        returnToken, AST::createLiteralEPV(0), isFunction));
+        arena, returnToken, AST::createLiteralEPV(arena, 0), isFunction));
   }
 
   consumeOrError(Token::Type::RIGHT_BRACE, "Expect '}' after scope");
-  return AST::createScopeEPV(std::move(statements));
+  return AST::createScopeEPV(arena, std::move(statements));
 }
 
 // <funcExpr> ::=
@@ -397,7 +395,7 @@ ExprPtrVariant Parser::scopeExpr() {
 ExprPtrVariant Parser::funcExpr() {
   auto token = getTokenAdvance();
   consumeOrError(Token::Type::LEFT_PAREN, "Expect '(' after 'func'");
-  std::vector<Token> parameters;
+  auto parameters = arena.list<Token>();
 
   if (match(Token::Type::IDENT)) {
     parameters.emplace_back(getTokenAdvance());
@@ -419,8 +417,8 @@ ExprPtrVariant Parser::funcExpr() {
 
   bool previousIsFunction = isFunction;
   isFunction = true;
-  auto func = std::get<std::unique_ptr<AST::FuncExpr>>(AST::createFuncEPV(
-      std::move(token), std::move(name), std::move(parameters)));
+  auto func = std::get<AST::FuncExprPtr>(AST::createFuncEPV(
+      arena, std::move(token), std::move(name), std::move(parameters)));
   func->body = scopeExpr();
   isFunction = previousIsFunction;
   return std::move(func);
@@ -442,12 +440,9 @@ void Parser::synchronize() {
   }
 }
 
-void Parser::advance() noexcept {
-  if (!isEOF())
-    ++currentIter;
-}
+void Parser::advance() { tokens.advance(); }
 
-Token Parser::getTokenAdvance() noexcept {
+Token Parser::getTokenAdvance() {
   Token token = peek();
   advance();
   return token;
@@ -460,7 +455,7 @@ Token Parser::consumeOrError(Token::Type tType, std::string_view errorMessage) {
 }
 
 [[nodiscard]] Token::Type Parser::getCurrentTokenType() const noexcept {
-  return currentIter->getType();
+  return peek().getType();
 }
 
 [[nodiscard]] bool Parser::isEOF() const noexcept {
@@ -481,14 +476,13 @@ Parser::match(std::initializer_list<Token::Type> types) const noexcept {
                      [currentType](const auto &x) { return x == currentType; });
 }
 
-[[nodiscard]] bool Parser::matchNext(Token::Type type) noexcept {
-  advance();
-  bool res = match(type);
-  --currentIter;
-  return res;
+[[nodiscard]] bool Parser::matchNext(Token::Type type) const noexcept {
+  return tokens.peekNext().getType() == type;
 }
 
-[[nodiscard]] Token Parser::peek() const noexcept { return *currentIter; };
+[[nodiscard]] const Token &Parser::peek() const noexcept {
+  return tokens.peek();
+}
 
 Errors::ParseError Parser::error(const std::string &msg) {
   return Errors::reportParseError(logger, peek(), msg);
@@ -3,6 +3,7 @@
 #include "prsl/AST/NodeTypes.hpp"
 #include "prsl/Debug/Errors.hpp"
 #include "prsl/Debug/Logger.hpp"
+#include "prsl/Parser/TokenStream.hpp"
 
 #include <initializer_list>
 #include <string_view>
@@ -17,7 +18,8 @@ using AST::StmtPtrVariant;
 
 class Parser {
 public:
-  explicit Parser(const std::vector<Token> &tokens, Errors::Logger &logger);
+  // Nodes are allocated in the arena, which has to outlive them
+  Parser(TokenStream tokens, AST::Arena &arena, Errors::Logger &logger);
 
   StmtPtrVariant parse();
 
@@ -50,25 +52,25 @@ private:
   ExprPtrVariant scopeExpr();
   ExprPtrVariant funcExpr();
   ExprPtrVariant callExpr();
-  std::vector<ExprPtrVariant> arguments();
+  AST::List<ExprPtrVariant> arguments();
 
   void synchronize();
-  void advance() noexcept;
-  Token getTokenAdvance() noexcept;
+  void advance();
+  Token getTokenAdvance();
   Token consumeOrError(Token::Type tType, std::string_view errorMessage);
   [[nodiscard]] Token::Type getCurrentTokenType() const noexcept;
   [[nodiscard]] bool isEOF() const noexcept;
   [[nodiscard]] bool match(Token::Type type) const noexcept;
   [[nodiscard]] bool
   match(std::initializer_list<Token::Type> types) const noexcept;
-  [[nodiscard]] bool matchNext(Token::Type type) noexcept;
-  [[nodiscard]] Token peek() const noexcept;
+  [[nodiscard]] bool matchNext(Token::Type type) const noexcept;
+  [[nodiscard]] const Token &peek() const noexcept;
 
   Errors::ParseError error(const std::string &msg);
 
 private:
-  const std::vector<Token> &tokens;
-  std::vector<Token>::const_iterator currentIter;
+  TokenStream tokens;
+  AST::Arena &arena;
   prsl::Errors::Logger &logger;
   bool isFunction{false};
 };
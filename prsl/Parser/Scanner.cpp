@@ -1,30 +1,198 @@
 #include "prsl/Parser/Scanner.hpp"
-#include "prsl/Utils/Utils.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PRSL_SCANNER_SIMD
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PRSL_SCANNER_SIMD
+#endif
 
 namespace prsl::Scanner {
 
-Scanner::Scanner(std::string_view filename, std::string_view source)
-    : filename(filename), start(source.data()), current(source.data()) {}
+namespace {
+
+enum CharClass : uint8_t {
+  SPACE = 1 << 0,
+  DIGIT = 1 << 1,
+  ALNUM = 1 << 2,
+  // Anything a single line comment goes on with
+  COMMENT = 1 << 3,
+};
+
+constexpr std::array<uint8_t, 256> classes = [] {
+  std::array<uint8_t, 256> res{};
+  for (unsigned c = 0; c != res.size(); ++c) {
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+      res[c] |= SPACE;
+    if (c >= '0' && c <= '9')
+      res[c] |= DIGIT | ALNUM;
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+      res[c] |= ALNUM;
+    if (c != '\n')
+      res[c] |= COMMENT;
+  }
+  return res;
+}();
+
+bool is(char c, uint8_t cls) {
+  return classes[static_cast<unsigned char>(c)] & cls;
+}
+
+struct Keyword {
+  std::string_view name;
+  Token::Type type;
+};
+
+// The first character and the length tell the keywords apart
+constexpr size_t keywordHash(std::string_view word) {
+  return (static_cast<unsigned char>(word[0]) + word.size()) % 8;
+}
+
+constexpr std::array<Keyword, 6> keywordList{{
+    {"if", Token::Type::IF},
+    {"else", Token::Type::ELSE},
+    {"while", Token::Type::WHILE},
+    {"print", Token::Type::PRINT},
+    {"func", Token::Type::FUNC},
+    {"return", Token::Type::RETURN},
+}};
+
+constexpr std::array<Keyword, 8> keywords = [] {
+  std::array<Keyword, 8> res{};
+  for (auto keyword : keywordList)
+    res[keywordHash(keyword.name)] = keyword;
+  return res;
+}();
+
+static_assert(
+    [] {
+      for (auto keyword : keywordList)
+        if (keywords[keywordHash(keyword.name)].name != keyword.name)
+          return false;
+      return true;
+    }(),
+    "keywordHash has to be a perfect hash of the keywords");
+
+#ifdef PRSL_SCANNER_SIMD
+
+// Character class masks of a block of characters, bit i is set if the class
+// holds for the i-th character. Blocks are only loaded while they fit before
+// the end of the source
+#if defined(__AVX2__)
+using Block = __m256i;
+constexpr ptrdiff_t blockSize = 32;
+constexpr uint32_t fullMask = 0xFFFFFFFF;
+
+Block load(const char *pos) {
+  return _mm256_loadu_si256(reinterpret_cast<const Block *>(pos));
+}
+Block splat(char c) { return _mm256_set1_epi8(c); }
+Block greater(Block lhs, Block rhs) { return _mm256_cmpgt_epi8(lhs, rhs); }
+Block equal(Block lhs, Block rhs) { return _mm256_cmpeq_epi8(lhs, rhs); }
+Block both(Block lhs, Block rhs) { return _mm256_and_si256(lhs, rhs); }
+Block either(Block lhs, Block rhs) { return _mm256_or_si256(lhs, rhs); }
+uint32_t toMask(Block block) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(block));
+}
+#else
+using Block = __m128i;
+constexpr ptrdiff_t blockSize = 16;
+constexpr uint32_t fullMask = 0xFFFF;
+
+Block load(const char *pos) {
+  return _mm_loadu_si128(reinterpret_cast<const Block *>(pos));
+}
+Block splat(char c) { return _mm_set1_epi8(c); }
+Block greater(Block lhs, Block rhs) { return _mm_cmpgt_epi8(lhs, rhs); }
+Block equal(Block lhs, Block rhs) { return _mm_cmpeq_epi8(lhs, rhs); }
+Block both(Block lhs, Block rhs) { return _mm_and_si128(lhs, rhs); }
+Block either(Block lhs, Block rhs) { return _mm_or_si128(lhs, rhs); }
+uint32_t toMask(Block block) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(block));
+}
+#endif
+
+uint32_t maskOf(Block block, char c) { return toMask(equal(block, splat(c))); }
+
+// Comparisons are signed, characters of 0x80 and above are never in range
+Block inRange(Block block, char first, char last) {
+  return both(greater(block, splat(first - 1)),
+              greater(splat(last + 1), block));
+}
+
+template <uint8_t cls> uint32_t classMask(Block block) {
+  if constexpr (cls == SPACE) {
+    auto blank = either(equal(block, splat(' ')), equal(block, splat('\t')));
+    auto breaks = either(equal(block, splat('\r')), equal(block, splat('\n')));
+    return toMask(either(blank, breaks));
+  } else if constexpr (cls == DIGIT) {
+    return toMask(inRange(block, '0', '9'));
+  } else if constexpr (cls == ALNUM) {
+    auto lower = either(block, splat(0x20));
+    return toMask(either(inRange(block, '0', '9'), inRange(lower, 'a', 'z')));
+  } else {
+    static_assert(cls == COMMENT);
+    return ~maskOf(block, '\n');
+  }
+}
+
+#endif
+
+// Most names, numbers and gaps between tokens are shorter, and end before a
+// block would pay off
+constexpr int scalarRun = 8;
+
+// Skips characters of the class, one by one at first, then a block at a time
+// while blocks fit before the end, then one by one again
+template <uint8_t cls> const char *skip(const char *pos, const char *end) {
+  for (int i = 0; i != scalarRun; ++i, ++pos)
+    if (pos == end || !is(*pos, cls))
+      return pos;
+#ifdef PRSL_SCANNER_SIMD
+  for (; end - pos >= blockSize; pos += blockSize)
+    if (uint32_t rest = ~classMask<cls>(load(pos)) & fullMask)
+      return pos + std::countr_zero(rest);
+#endif
+  while (pos != end && is(*pos, cls))
+    ++pos;
+  return pos;
+}
+
+} // namespace
+
+Scanner::Scanner(std::string_view source) : Scanner(source, false) {}
+
+Scanner::Scanner(std::string_view part, bool inComment)
+    : start(part.data()), current(part.data()),
+      end(part.data() + part.size()), inComment(inComment) {}
 
 std::vector<Token> Scanner::tokenize() {
   std::vector<Token> tokens;
-  while (!isEOL()) {
-    tokens.emplace_back(tokenizeOne());
-  }
-  auto eof_pos = Utils::FilePos::UNKNOWN(filename);
-  tokens.emplace_back(Token::Type::EOF_, "", eof_pos, eof_pos);
+  // Programs average more than four characters per token. Reserved memory
+  // that is never written to costs no page faults, regrowing copies it all
+  tokens.reserve(static_cast<size_t>(end - current) / 4 + 1);
+  do
+    tokens.push_back(tokenizeOne());
+  while (tokens.back().getType() != Token::Type::EOF_);
   return tokens;
 }
 
 Token Scanner::tokenizeOne() {
-  skipWhitespace();
+  if (!skipWhitespaceAndComments())
+    return makeError(Token::Error::UNTERMINATED_COMMENT);
   start = current;
 
   if (isEOL()) {
-    return makeToken(Token::Type::EOF_);
+    return {Token::Type::EOF_, ""};
   }
 
-  char c = advance();
+  char c = *current++;
   switch (c) {
   case '=':
     if (match('='))
@@ -50,26 +218,8 @@ Token Scanner::tokenizeOne() {
     return makeToken(Token::Type::MINUS);
   case '*':
     return makeToken(Token::Type::STAR);
-  case '/': {
-    if (match('/')) {
-      while (peek() != '\n' && !isEOL())
-        advance();
-    } else if (match('*')) {
-      while (!(peek() == '*' && peekNext() == '/') && !isEOL()) {
-        if (peek() == '\n')
-          line++;
-        advance();
-      }
-      if (isEOL()) {
-        return makeError("Multiline comment has no termination");
-      }
-      advance();
-      advance();
-    } else {
-      return makeToken(Token::Type::SLASH);
-    }
-    return tokenizeOne();
-  }
+  case '/':
+    return makeToken(Token::Type::SLASH);
   case '>':
     if (match('='))
       return makeToken(Token::Type::GREATER_EQUAL);
@@ -81,7 +231,7 @@ Token Scanner::tokenizeOne() {
   case '!':
     if (match('='))
       return makeToken(Token::Type::NOT_EQUAL);
-    return makeError("Expect '=' sign");
+    return makeError(Token::Error::EXPECT_EQUAL);
   case '{':
     return makeToken(Token::Type::LEFT_BRACE);
   case '}':
@@ -89,48 +239,48 @@ Token Scanner::tokenizeOne() {
   case '?':
     return makeToken(Token::Type::INPUT);
   default:
-    if (std::isalpha(c)) {
-      return ident();
-    }
-    if (c == '-' ||
-        (std::isdigit(c) && !(c == '0' && std::isdigit(peekNext())))) {
+    if (is(c, DIGIT)) {
+      // Numbers have no leading zeros
+      if (c == '0' && is(peek(), DIGIT))
+        return makeError(Token::Error::UNKNOWN_CHARACTER);
       return number();
     }
+    if (is(c, ALNUM))
+      return ident();
 
-    return makeError("Unknown character");
+    return makeError(Token::Error::UNKNOWN_CHARACTER);
   }
 }
 
 Token Scanner::ident() {
-  while (std::isalnum(peek()))
-    advance();
+  current = skip<ALNUM>(current, end);
 
   std::string_view view = {start, static_cast<size_t>(current - start)};
-  auto it = keywords.find(view);
-  if (it == keywords.end())
+  const auto &keyword = keywords[keywordHash(view)];
+  if (keyword.name != view)
     return makeToken(Token::Type::IDENT);
 
-  return makeToken(it->second);
+  return makeToken(keyword.type);
 }
 
 Token Scanner::number() {
-  while (std::isdigit(peek()))
-    advance();
+  current = skip<DIGIT>(current, end);
 
   return makeToken(Token::Type::NUMBER);
 }
 
-bool Scanner::isEOL() { return *current == '\0'; }
+bool Scanner::isEOL() { return current == end; }
 
-char Scanner::advance() {
-  col += 1;
-  return *(current++);
-}
+bool Scanner::isInComment() const noexcept { return inComment; }
 
-char Scanner::peek() { return *current; }
+char Scanner::peek() {
+  if (isEOL())
+    return '\0';
+  return *current;
+}
 
 char Scanner::peekNext() {
-  if (isEOL())
+  if (end - current < 2)
     return '\0';
   return current[1];
 }
@@ -140,41 +290,62 @@ bool Scanner::match(char expect) {
     return false;
   if (peek() != expect)
     return false;
-  advance();
+  ++current;
   return true;
 }
 
-void Scanner::skipWhitespace() {
+bool Scanner::skipWhitespaceAndComments() {
+  // The error about a comment without the end is given once
+  if (inComment && !isEOL() && !skipBlockComment(current))
+    return false;
   for (;;) {
-    char c = peek();
-    switch (c) {
-    case ' ':
-    case '\r':
-    case '\t':
-      advance();
-      break;
-    case '\n':
-      line++;
-      col = 0;
-      advance();
-      break;
-    default:
-      return;
+    skipWhitespace();
+    if (peek() != '/')
+      return true;
+    if (peekNext() == '/') {
+      current = skip<COMMENT>(current + 2, end);
+    } else if (peekNext() == '*') {
+      if (!skipBlockComment(current + 2))
+        return false;
+    } else {
+      return true;
     }
   }
 }
 
-Token Scanner::makeToken(Token::Type type) {
-  size_t tokenLength = static_cast<size_t>(current - start);
-  auto s_pos =
-      Utils::FilePos{filename, line, static_cast<int>(col - tokenLength)};
-  auto e_pos = Utils::FilePos{filename, line, col};
-  return {type, std::string_view{start, tokenLength}, s_pos, e_pos};
+void Scanner::skipWhitespace() { current = skip<SPACE>(current, end); }
+
+// Skips the rest of a comment from the position on. Leaves the scanner right
+// after the comment, or at the end of the source if it is not terminated
+bool Scanner::skipBlockComment(const char *pos) {
+  inComment = true;
+#ifdef PRSL_SCANNER_SIMD
+  // The '/' of a "*/" can be the first character of the next block
+  while (end - pos > blockSize) {
+    uint32_t closes = maskOf(load(pos), '*') & maskOf(load(pos + 1), '/');
+    if (closes) {
+      current = pos + std::countr_zero(closes) + 2;
+      inComment = false;
+      return true;
+    }
+    pos += blockSize;
+  }
+#endif
+  for (; pos != end; ++pos) {
+    if (*pos == '*' && end - pos >= 2 && pos[1] == '/') {
+      current = pos + 2;
+      inComment = false;
+      return true;
+    }
+  }
+  current = end;
+  return false;
 }
 
-Token Scanner::makeError(std::string_view message) const {
-  auto pos = Utils::FilePos{filename, line, col};
-  return {Token::Type::ERROR, message, pos, pos};
+Token Scanner::makeToken(Token::Type type) {
+  return {type, std::string_view{start, static_cast<size_t>(current - start)}};
 }
 
-} // namespace prsl::Scanner
\ No newline at end of file
+Token Scanner::makeError(Token::Error error) const { return {current, error}; }
+
+} // namespace prsl::Scanner
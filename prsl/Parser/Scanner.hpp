@@ -3,7 +3,6 @@
 #include "prsl/Parser/Token.hpp"
 
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
 namespace prsl::Scanner {
@@ -12,34 +11,40 @@ using prsl::Types::Token;
 
 class Scanner {
 public:
-  explicit Scanner(std::string_view filename, std::string_view source);
+  explicit Scanner(std::string_view source);
+  // Scans a part of a larger source which starts at the beginning of the
+  // line, possibly inside of a multiline comment
+  Scanner(std::string_view part, bool inComment);
+
+  // Tokens of the rest of the source, followed by EOF
   std::vector<Token> tokenize();
+  // Returns an EOF without position at the end of the source
   Token tokenizeOne();
 
+  // Whether the source ended inside of a multiline comment
+  [[nodiscard]] bool isInComment() const noexcept;
+
 private:
   Token ident();
   Token number();
 
   bool isEOL();
-  char advance();
   char peek();
   char peekNext();
   bool match(char expect);
+  // Returns false if a multiline comment is not terminated
+  bool skipWhitespaceAndComments();
   void skipWhitespace();
+  bool skipBlockComment(const char *pos);
 
   Token makeToken(Token::Type type);
-  Token makeError(std::string_view message) const;
+  Token makeError(Token::Error error) const;
 
 private:
   const char *start;
   const char *current;
-  std::string_view filename;
-  int line{1}, col{-1};
-
-  std::unordered_map<std::string_view, Token::Type> keywords = {
-      {"if", Token::Type::IF},       {"else", Token::Type::ELSE},
-      {"while", Token::Type::WHILE}, {"print", Token::Type::PRINT},
-      {"func", Token::Type::FUNC},   {"return", Token::Type::RETURN}};
+  const char *end;
+  bool inComment;
 };
 
-} // namespace prsl::Scanner
\ No newline at end of file
+} // namespace prsl::Scanner
@@ -1,7 +1,7 @@
 #pragma once
 
-#include "prsl/Utils/Utils.hpp"
-
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <string_view>
@@ -10,7 +10,7 @@ namespace prsl::Types {
 
 class Token {
 public:
-  enum class Type {
+  enum class Type : uint8_t {
     COLON,
     COMMA,
     ELSE,
@@ -44,21 +44,41 @@ public:
     WHILE,
   };
 
+  // Errors of the scanner. Their messages take the place of the lexeme
+  enum class Error : uint8_t {
+    NONE,
+    UNKNOWN_CHARACTER,
+    EXPECT_EQUAL,
+    UNTERMINATED_COMMENT,
+  };
+
   /**
    * Constructor for Token class.
    *
    * @param type the type of the token
-   * @param str the string representation of the token
-   * @param line the line number where the token appears
-   * @param line the char number where the token appears
+   * @param str the text of the token. Tokens of the scanner point into the
+   * source, which gives their position. Tokens with other text have none
+   *
+   * @return None
+   *
+   * @throws None
+   */
+  constexpr Token(Type type, std::string_view str) noexcept
+      : text(str.data()), length(static_cast<uint32_t>(str.size())),
+        type(type) {}
+
+  /**
+   * Constructor for error tokens.
+   *
+   * @param where the position in the source where the error is
+   * @param error the error
    *
    * @return None
    *
    * @throws None
    */
-  constexpr Token(Type type, std::string_view str, Utils::FilePos s_pos,
-                  Utils::FilePos e_pos) noexcept
-      : type(type), lexeme(str), s_pos(s_pos), e_pos(e_pos) {}
+  constexpr Token(const char *where, Error error) noexcept
+      : text(where), length(0), type(Type::ERROR), error(error) {}
 
   /**
    * Check if the token represents an error.
@@ -81,29 +101,25 @@ public:
   /**
    * Get the lexeme of the token.
    *
-   * @return the lexeme of the token
-   *
-   * @throws None
-   */
-  constexpr std::string_view getLexeme() const noexcept { return lexeme; }
-
-  /**
-   * Get the start position of the token.
-   *
-   * @return the position of the token
+   * @return the lexeme of the token, the message for errors
    *
    * @throws None
    */
-  constexpr Utils::FilePos getStartPos() const noexcept { return s_pos; }
+  constexpr std::string_view getLexeme() const noexcept {
+    if (type == Type::ERROR)
+      return messages[static_cast<size_t>(error)];
+    return {text, length};
+  }
 
   /**
-   * Get the end position of the token.
+   * Get the start of the token.
    *
-   * @return the position of the token
+   * @return the pointer to the text of the token, its position is resolved
+   * by the lines of the source only when it is reported
    *
    * @throws None
    */
-  constexpr Utils::FilePos getEndPos() const noexcept { return e_pos; }
+  constexpr const char *getLocation() const noexcept { return text; }
 
   /**
    * Converts the token to a string.
@@ -113,23 +129,30 @@ public:
   constexpr std::string toString() const {
     if (type == Token::Type::EOF_)
       return "EOF";
-    return {lexeme.data(), lexeme.size()};
+    return std::string(getLexeme());
   }
 
   constexpr auto operator==(const Token &rhs) const noexcept {
-    return lexeme == rhs.lexeme;
+    return getLexeme() == rhs.getLexeme();
   }
 
   constexpr auto operator<=>(const Token &rhs) const noexcept {
-    return lexeme <=> rhs.lexeme;
+    return getLexeme() <=> rhs.getLexeme();
   }
 
 private:
-  std::string_view lexeme;
-  Utils::FilePos s_pos, e_pos;
+  static constexpr std::array<std::string_view, 4> messages{
+      "", "Unknown character", "Expect '=' sign",
+      "Multiline comment has no termination"};
+
+  const char *text;
+  uint32_t length;
   Type type;
+  Error error{Error::NONE};
 };
 
+static_assert(sizeof(Token) <= 16);
+
 } // namespace prsl::Types
 
 template <> struct std::hash<prsl::Types::Token> {
@@ -0,0 +1,26 @@
+#include "prsl/Parser/TokenStream.hpp"
+
+namespace prsl::Parser {
+
+TokenStream::TokenStream(Scanner::Scanner &scanner)
+    : scanner(&scanner), ring{pull(), pull()} {}
+
+TokenStream::TokenStream(const std::vector<Token> &tokens)
+    : next(tokens.data()), last(tokens.data() + tokens.size() - 1),
+      ring{pull(), pull()} {}
+
+void TokenStream::advance() {
+  if (peek().getType() == Token::Type::EOF_)
+    return;
+  // The slot of the current token takes the one after the next
+  ring[head] = pull();
+  head = (head + 1) % capacity;
+}
+
+Token TokenStream::pull() {
+  if (scanner)
+    return scanner->tokenizeOne();
+  return next == last ? *last : *next++;
+}
+
+} // namespace prsl::Parser
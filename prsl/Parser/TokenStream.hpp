@@ -0,0 +1,41 @@
+#pragma once
+
+#include "prsl/Parser/Scanner.hpp"
+#include "prsl/Parser/Token.hpp"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace prsl::Parser {
+
+using prsl::Types::Token;
+
+// Tokens the parser reads, pulled from the scanner as parsing goes. Only the
+// current token and the one after it are kept, in a ring of two slots
+class TokenStream {
+public:
+  explicit TokenStream(Scanner::Scanner &scanner);
+  // Tokens scanned beforehand, ending with EOF
+  explicit TokenStream(const std::vector<Token> &tokens);
+
+  [[nodiscard]] const Token &peek() const noexcept { return ring[head]; }
+  [[nodiscard]] const Token &peekNext() const noexcept {
+    return ring[(head + 1) % capacity];
+  }
+  // Stays at EOF once it is reached
+  void advance();
+
+private:
+  Token pull();
+
+  static constexpr size_t capacity = 2;
+
+  Scanner::Scanner *scanner{nullptr};
+  const Token *next{nullptr};
+  const Token *last{nullptr};
+  std::array<Token, capacity> ring;
+  size_t head{0};
+};
+
+} // namespace prsl::Parser
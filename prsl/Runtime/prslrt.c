@@ -0,0 +1,172 @@
+// Runtime library of the programs compiled by prsl, instead of a printf and a
+// scanf per operation. Output is buffered and written once the buffer is full
+// and at the end of main, input is read in chunks and parsed by hand. Failed
+// reads and divisions by zero end the program with an error
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+enum { BUFFER_SIZE = 1 << 16, MAX_LINE = sizeof("-2147483648\n") - 1 };
+
+static char output[BUFFER_SIZE];
+static size_t outputSize;
+
+static char input[BUFFER_SIZE];
+static size_t inputPos;
+static size_t inputSize;
+// Offset of the buffer in the whole input and the line the reader is at
+static uint64_t inputBase;
+static uint32_t line = 1;
+static uint64_t lineStart;
+
+// "00", "01", ..., "99", itoa writes two digits at once
+static const char digitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+void prslrt_flush(void) {
+  size_t written = 0;
+  while (written < outputSize) {
+    ssize_t res = write(STDOUT_FILENO, output + written, outputSize - written);
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      break;
+    written += (size_t)res;
+  }
+  outputSize = 0;
+}
+
+// Writes the decimal digits of the value to out, returns the end of them
+static char *formatUnsigned(char *out, uint32_t value) {
+  // Digits are produced from the end into a scratch buffer
+  char digits[10];
+  char *first = digits + sizeof(digits);
+  while (value >= 100) {
+    const char *pair = digitPairs + (value % 100) * 2;
+    value /= 100;
+    *--first = pair[1];
+    *--first = pair[0];
+  }
+  if (value >= 10) {
+    *--first = digitPairs[value * 2 + 1];
+    *--first = digitPairs[value * 2];
+  } else {
+    *--first = (char)('0' + value);
+  }
+
+  while (first != digits + sizeof(digits))
+    *out++ = *first++;
+  return out;
+}
+
+void prslrt_print(int32_t value) {
+  if (BUFFER_SIZE - outputSize < MAX_LINE)
+    prslrt_flush();
+
+  char *out = output + outputSize;
+  uint32_t rest = (uint32_t)value;
+  if (value < 0) {
+    *out++ = '-';
+    rest = 0u - rest;
+  }
+  out = formatUnsigned(out, rest);
+  *out++ = '\n';
+  outputSize = (size_t)(out - output);
+}
+
+// Returns -1 at the end of input
+static int peek(void) {
+  if (inputPos == inputSize) {
+    inputBase += inputSize;
+    ssize_t res;
+    do
+      res = read(STDIN_FILENO, input, sizeof(input));
+    while (res < 0 && errno == EINTR);
+    inputPos = 0;
+    inputSize = res > 0 ? (size_t)res : 0;
+    if (!inputSize)
+      return -1;
+  }
+  return (unsigned char)input[inputPos];
+}
+
+static void append(char **out, const char *str) {
+  while (*str)
+    *(*out)++ = *str++;
+}
+
+// Reports the error as prsl does and exits, the output so far is written out
+// first
+static _Noreturn void report(const char *file, uint32_t row, uint32_t column,
+                             const char *message) {
+  prslrt_flush();
+
+  char text[256];
+  char *out = text;
+  // The name of the source is cut rather than the message
+  while (*file && out != text + 128)
+    *out++ = *file++;
+  *out++ = ':';
+  out = formatUnsigned(out, row);
+  *out++ = ':';
+  out = formatUnsigned(out, column);
+  append(&out, ": error: ");
+  append(&out, message);
+  *out++ = '\n';
+  ssize_t res;
+  do
+    res = write(STDERR_FILENO, text, (size_t)(out - text));
+  while (res < 0 && errno == EINTR);
+  _exit(1);
+}
+
+static _Noreturn void fail(uint64_t offset, const char *message) {
+  report("<stdin>", line, (uint32_t)(offset - lineStart + 1), message);
+}
+
+// Errors of the program itself, such as a division by zero, at a position of
+// its source
+_Noreturn void prslrt_fail(const char *file, int32_t row, int32_t column,
+                           const char *message) {
+  report(file, (uint32_t)row, (uint32_t)column, message);
+}
+
+// As `std::cin >> value`, but malformed input, the end of input and integers
+// out of range are errors
+int32_t prslrt_input(void) {
+  int c = peek();
+  while (c == ' ' || (c >= '\t' && c <= '\r')) {
+    if (c == '\n') {
+      ++line;
+      lineStart = inputBase + inputPos + 1;
+    }
+    ++inputPos;
+    c = peek();
+  }
+  uint64_t start = inputBase + inputPos;
+  if (c < 0)
+    fail(start, "Unexpected end of input, expected an integer");
+
+  int negative = 0;
+  if (c == '-' || c == '+') {
+    negative = c == '-';
+    ++inputPos;
+    c = peek();
+  }
+  if ((unsigned)(c - '0') >= 10)
+    fail(start, "Expected an integer");
+
+  uint64_t value = 0;
+  uint64_t limit = (uint64_t)INT32_MAX + (uint64_t)negative;
+  while ((unsigned)(c - '0') < 10) {
+    value = value * 10 + (uint64_t)(c - '0');
+    if (value > limit)
+      fail(start, "Integer out of range");
+    ++inputPos;
+    c = peek();
+  }
+  return (int32_t)(negative ? 0u - (uint32_t)value : (uint32_t)value);
+}
@@ -16,11 +16,13 @@ void Semantics::visitVarExpr(const VarExprPtr &expr) {
     throw reportRuntimeError(logger, expr->ident,
                              "Can't read variable in its own initializer");
   }
+  expr->binding = envManager.resolve(expr->ident);
 }
 
 void Semantics::visitAssignmentExpr(const AssignmentExprPtr &expr) {
   if (!envManager.contains(expr->varName))
     envManager.define(expr->varName, false);
+  expr->binding = envManager.resolve(expr->varName);
   TreeWalkerVisitor::visitAssignmentExpr(expr);
   envManager.assign(expr->varName, true);
 }
@@ -31,33 +33,45 @@ void Semantics::visitPostfixExpr(const PostfixExprPtr &expr) {
         std::holds_alternative<AssignmentExprPtr>(expression)))
     throw reportRuntimeError(logger, expr->op, "Illegal postfix expression");
   TreeWalkerVisitor::visitPostfixExpr(expr);
+  if (std::holds_alternative<VarExprPtr>(expression))
+    expr->binding = std::get<VarExprPtr>(expression)->binding;
 }
 
 void Semantics::visitScopeExpr(const ScopeExprPtr &stmt) {
-  envManager.withNewEnviron([&]() { TreeWalkerVisitor::visitScopeExpr(stmt); });
+  envManager.withNewEnviron([&]() {
+    TreeWalkerVisitor::visitScopeExpr(stmt);
+    stmt->slotsCount = envManager.slotsCount();
+  });
 }
 
 void Semantics::visitFuncExpr(const FuncExprPtr &expr) {
   auto funcEnv = std::make_shared<decltype(envManager)::EnvType>(nullptr);
+  expr->id = functionsCount++;
   if (expr->name) {
-    functionsManager.set(expr->name->getLexeme(), true);
+    functionsManager.set(expr->name->getLexeme(), expr.get());
   }
   envManager.withNewEnviron(funcEnv, [&]() {
     for (const auto &token : expr->parameters) {
-      envManager.define(token, true);
+      envManager.defineParameter(token, true);
     }
     bool previousInFunction = inFunction;
     inFunction = true;
-    TreeWalkerVisitor::visitFuncExpr(expr);
+    // Function body shares the environment of the parameters, as it does
+    // when the function is called
+    TreeWalkerVisitor::visitScopeExpr(std::get<ScopeExprPtr>(expr->body));
     inFunction = previousInFunction;
+    expr->slotsCount = envManager.slotsCount();
   });
 }
 
 void Semantics::visitCallExpr(const CallExprPtr &expr) {
-  if (!functionsManager.contains(expr->ident.getLexeme()) &&
-      !envManager.contains(expr->ident))
+  if (functionsManager.contains(expr->ident.getLexeme())) {
+    expr->callee = functionsManager.get(expr->ident.getLexeme());
+  } else if (!envManager.contains(expr->ident)) {
     throw reportRuntimeError(logger, expr->ident,
                              "Attempt to access an undef function");
+  }
+  expr->binding = envManager.resolve(expr->ident);
   TreeWalkerVisitor::visitCallExpr(expr);
 }
 
@@ -65,12 +79,26 @@ void Semantics::visitVarStmt(const VarStmtPtr &stmt) {
   if (!envManager.contains(stmt->varName)) {
     envManager.define(stmt->varName, false);
   }
+  stmt->binding = envManager.resolve(stmt->varName);
   TreeWalkerVisitor::visitVarStmt(stmt);
   envManager.assign(stmt->varName, true);
 }
 
 void Semantics::visitBlockStmt(const BlockStmtPtr &stmt) {
-  envManager.withNewEnviron([&]() { TreeWalkerVisitor::visitBlockStmt(stmt); });
+  envManager.withNewEnviron([&]() {
+    TreeWalkerVisitor::visitBlockStmt(stmt);
+    stmt->slotsCount = envManager.slotsCount();
+  });
+}
+
+void Semantics::visitWhileStmt(const WhileStmtPtr &stmt) {
+  stmt->id = loopsCount++;
+  TreeWalkerVisitor::visitWhileStmt(stmt);
+}
+
+void Semantics::visitFunctionStmt(const FunctionStmtPtr &stmt) {
+  TreeWalkerVisitor::visitFunctionStmt(stmt);
+  stmt->slotsCount = envManager.slotsCount();
 }
 
 void Semantics::visitReturnStmt(const ReturnStmtPtr &stmt) {
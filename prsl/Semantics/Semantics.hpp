@@ -12,27 +12,33 @@ namespace prsl::Semantics {
 
 using namespace AST;
 
-class Semantics : public TreeWalkerVisitor {
+class Semantics : public TreeWalkerVisitor<Semantics> {
 public:
   explicit Semantics(Errors::Logger &logger);
   bool dump(const std::filesystem::path &path) const;
 
 private:
-  void visitVarExpr(const VarExprPtr &expr) override;
-  void visitAssignmentExpr(const AssignmentExprPtr &expr) override;
-  void visitPostfixExpr(const PostfixExprPtr &expr) override;
-  void visitScopeExpr(const ScopeExprPtr &expr) override;
-  void visitFuncExpr(const FuncExprPtr &expr) override;
-  void visitCallExpr(const CallExprPtr &expr) override;
+  friend ASTVisitor;
 
-  void visitVarStmt(const VarStmtPtr &stmt) override;
-  void visitBlockStmt(const BlockStmtPtr &stmt) override;
-  void visitReturnStmt(const ReturnStmtPtr &stmt) override;
+  void visitVarExpr(const VarExprPtr &expr);
+  void visitAssignmentExpr(const AssignmentExprPtr &expr);
+  void visitPostfixExpr(const PostfixExprPtr &expr);
+  void visitScopeExpr(const ScopeExprPtr &expr);
+  void visitFuncExpr(const FuncExprPtr &expr);
+  void visitCallExpr(const CallExprPtr &expr);
+
+  void visitVarStmt(const VarStmtPtr &stmt);
+  void visitWhileStmt(const WhileStmtPtr &stmt);
+  void visitFunctionStmt(const FunctionStmtPtr &stmt);
+  void visitBlockStmt(const BlockStmtPtr &stmt);
+  void visitReturnStmt(const ReturnStmtPtr &stmt);
 
 private:
   Errors::Logger &logger;
   Types::EnvironmentManager<bool> envManager;
-  Types::FunctionsManager<bool> functionsManager;
+  Types::FunctionsManager<const FuncExpr *> functionsManager;
+  unsigned functionsCount = 0;
+  unsigned loopsCount = 0;
   bool inFunction = false;
 };
 
@@ -0,0 +1,169 @@
+#include "prsl/Utils/Input.hpp"
+
+#include <llvm/Support/FileSystem.h>
+
+#include <bit>
+#include <cstring>
+#include <limits>
+
+namespace prsl::Utils {
+
+namespace {
+
+constexpr size_t chunkSize = 1 << 16;
+constexpr uint64_t ones = 0x0101010101010101;
+
+uint64_t load(const char *pos) noexcept {
+  uint64_t res;
+  std::memcpy(&res, pos, sizeof(res));
+  if constexpr (std::endian::native == std::endian::big)
+    res = std::byteswap(res);
+  return res;
+}
+
+// Number of digits the eight characters start with, the first character is
+// the lowest byte. A byte is a digit if both it and it plus 6 are in 0x3X.
+// Carries of the addition only reach bytes after a non-digit
+unsigned countDigits(uint64_t chars) noexcept {
+  uint64_t nonDigits = ((chars & 0xF0 * ones) ^ 0x30 * ones) |
+                       (((chars + 0x06 * ones) & 0xF0 * ones) ^ 0x30 * ones);
+  return nonDigits ? std::countr_zero(nonDigits) / 8 : 8;
+}
+
+// Value of eight digits, combining neighbouring digits, then pairs of them,
+// then quads with one multiplication each
+uint32_t parseEight(uint64_t chars) noexcept {
+  chars = ((chars & 0x0F * ones) * (10 << 8 | 1)) >> 8;
+  chars = ((chars & 0x00FF00FF00FF00FF) * (100 << 16 | 1)) >> 16;
+  return static_cast<uint32_t>(
+      ((chars & 0x0000FFFF0000FFFF) * (10000ULL << 32 | 1)) >> 32);
+}
+
+bool isSpace(char c) noexcept { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+} // namespace
+
+Input &Input::get() {
+  static Input input;
+  return input;
+}
+
+Input::Input() : chunk(chunkSize) {
+  begin = cur = end = chunk.data();
+}
+
+std::error_code Input::open(const std::string &path) {
+  // Mapped if it is large enough for mapping to pay off
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return buffer.getError();
+
+  file = std::move(*buffer);
+  name = path;
+  begin = cur = file->getBufferStart();
+  end = file->getBufferEnd();
+  eof = true;
+  return {};
+}
+
+std::optional<int32_t> Input::read() {
+  for (;; ++cur) {
+    if (cur == end && !refill())
+      return fail(cur, "Unexpected end of input, expected an integer");
+    if (*cur == '\n') {
+      ++line;
+      lineStart = offset(cur) + 1;
+    } else if (!isSpace(*cur)) {
+      break;
+    }
+  }
+
+  // The whole number has to be in the window. Refilling moves it, so it is
+  // kept as offsets from cur
+  ptrdiff_t digitsAt;
+  ptrdiff_t lastAt;
+  for (;;) {
+    const char *digits = cur + (*cur == '-' || *cur == '+');
+    const char *last = digits;
+    while (end - last >= 8) {
+      unsigned count = countDigits(load(last));
+      last += count;
+      if (count != 8)
+        break;
+    }
+    if (end - last < 8)
+      while (last != end && static_cast<unsigned char>(*last - '0') < 10)
+        ++last;
+    digitsAt = digits - cur;
+    lastAt = last - cur;
+    if (last != end || !refill())
+      break;
+  }
+  const char *digits = cur + digitsAt;
+  const char *last = cur + lastAt;
+
+  if (digits == last)
+    return fail(cur, "Expected an integer");
+  const char *first = digits;
+  while (first + 1 != last && *first == '0')
+    ++first;
+  if (last - first > 10)
+    return fail(cur, "Integer out of range");
+
+  uint64_t value = 0;
+  const char *pos = first;
+  if (end - pos >= 8) {
+    // Digits after the number are shifted out, zeros shifted in before it
+    auto count = std::min<ptrdiff_t>(last - pos, 8);
+    value = parseEight(load(pos) << (8 - count) * 8);
+    pos += count;
+  }
+  for (; pos != last; ++pos)
+    value = value * 10 + static_cast<unsigned>(*pos - '0');
+
+  bool negative = *cur == '-';
+  if (value > uint64_t{std::numeric_limits<int32_t>::max()} + negative)
+    return fail(cur, "Integer out of range");
+  cur = last;
+  return static_cast<int32_t>(negative ? 0 - value : value);
+}
+
+bool Input::refill() {
+  if (eof)
+    return false;
+
+  // The unread rest moves to the front, the window grows if it is all unread
+  size_t rest = end - cur;
+  size_t start = cur - chunk.data();
+  base += cur - begin;
+  if (rest == chunk.size())
+    chunk.resize(chunk.size() * 2);
+  std::memmove(chunk.data(), chunk.data() + start, rest);
+  begin = cur = chunk.data();
+  end = cur + rest;
+
+  auto read = llvm::sys::fs::readNativeFile(
+      llvm::sys::fs::getStdinHandle(),
+      llvm::MutableArrayRef<char>(chunk.data() + rest, chunk.size() - rest));
+  if (!read || !*read) {
+    if (!read)
+      llvm::consumeError(read.takeError());
+    eof = true;
+    return false;
+  }
+  end += *read;
+  return true;
+}
+
+uint64_t Input::offset(const char *pos) const noexcept {
+  return base + (pos - begin);
+}
+
+std::nullopt_t Input::fail(const char *pos, std::string_view message) {
+  auto col = static_cast<int>(offset(pos) - lineStart) + 1;
+  failure = {FilePos{name, line, col}, std::string(message)};
+  return std::nullopt;
+}
+
+} // namespace prsl::Utils
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "prsl/Utils/Utils.hpp"
+
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace prsl::Utils {
+
+// Standard input of the programs run in process, shared by all the execution
+// modes. Streams are read in large chunks, files given with open are mapped
+// into memory. Integers are parsed eight digits at a time
+class Input {
+public:
+  // Where and why the last read failed
+  struct Failure {
+    FilePos pos;
+    std::string message;
+  };
+
+  static Input &get();
+
+  Input(const Input &) = delete;
+  Input &operator=(const Input &) = delete;
+
+  // Reads the file instead of stdin
+  std::error_code open(const std::string &path);
+
+  // The next integer, skipping the whitespace before it. Nothing is consumed
+  // if there is no integer or it does not fit into 32 bits
+  std::optional<int32_t> read();
+  [[nodiscard]] const Failure &getFailure() const noexcept { return failure; }
+
+private:
+  Input();
+
+  // Reads the next chunk of a stream after the unread rest of the window,
+  // returns false at the end of input
+  bool refill();
+  [[nodiscard]] uint64_t offset(const char *pos) const noexcept;
+  std::nullopt_t fail(const char *pos, std::string_view message);
+
+  std::string name{"<stdin>"};
+  std::unique_ptr<llvm::MemoryBuffer> file;
+  std::vector<char> chunk;
+  // The unread part of the input the window holds
+  const char *begin{nullptr};
+  const char *cur{nullptr};
+  const char *end{nullptr};
+  bool eof{false};
+  // Offset of the window in the whole input and the line the reader is at
+  uint64_t base{0};
+  int line{1};
+  uint64_t lineStart{0};
+  Failure failure;
+};
+
+} // namespace prsl::Utils
@@ -0,0 +1,33 @@
+#include "prsl/Utils/LineTable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+namespace prsl::Utils {
+
+LineTable::LineTable(std::string_view filename, std::string_view source)
+    : filename(filename), source(source) {}
+
+FilePos LineTable::locate(const char *pos) const {
+  // Comparing pointers to different objects is fine with std::less
+  std::less<const char *> less;
+  if (less(pos, source.data()) || less(source.data() + source.size(), pos))
+    return FilePos::UNKNOWN(filename);
+
+  if (lineStarts.empty()) {
+    lineStarts.push_back(0);
+    const char *begin = source.data(), *end = begin + source.size();
+    for (const char *it = begin;
+         (it = static_cast<const char *>(std::memchr(it, '\n', end - it)));)
+      lineStarts.push_back(static_cast<uint32_t>(++it - begin));
+  }
+
+  auto offset = static_cast<uint32_t>(pos - source.data());
+  auto line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+  return {filename, static_cast<int>(line - lineStarts.begin()),
+          static_cast<int>(offset - *std::prev(line)) + 1};
+}
+
+} // namespace prsl::Utils
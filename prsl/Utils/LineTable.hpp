@@ -0,0 +1,28 @@
+#pragma once
+
+#include "prsl/Utils/Utils.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace prsl::Utils {
+
+// Lines and columns of the positions in a source. The starts of the lines
+// are only looked for when a position is first asked for, that is when an
+// error or a warning is reported
+class LineTable {
+public:
+  LineTable(std::string_view filename, std::string_view source);
+
+  // Positions outside of the source are unknown, but in the file
+  [[nodiscard]] FilePos locate(const char *pos) const;
+
+private:
+  std::string_view filename;
+  std::string_view source;
+  // Offsets of the first characters of the lines
+  mutable std::vector<uint32_t> lineStarts;
+};
+
+} // namespace prsl::Utils
@@ -0,0 +1,46 @@
+#include "prsl/Utils/Output.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <iterator>
+
+namespace prsl::Utils {
+
+Output &Output::get() {
+  static Output output;
+  return output;
+}
+
+Output::Output() { buffer.reserve(defaultThreshold); }
+
+// Whatever is left is written out when the process exits
+Output::~Output() { flush(); }
+
+void Output::writeLine(std::string_view line) {
+  buffer.append(line);
+  endLine();
+}
+
+void Output::writeLine(int64_t value) {
+  char digits[20];
+  auto res = std::to_chars(std::begin(digits), std::end(digits), value);
+  buffer.append(digits, res.ptr);
+  endLine();
+}
+
+void Output::flush() {
+  if (buffer.empty())
+    return;
+  std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+  std::fflush(stdout);
+  // Keeps the capacity, so the buffer is allocated once
+  buffer.clear();
+}
+
+void Output::endLine() {
+  buffer.push_back('\n');
+  if (lineBuffered || buffer.size() >= threshold)
+    flush();
+}
+
+} // namespace prsl::Utils
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace prsl::Utils {
+
+// Standard output of the programs run in process, shared by all the execution
+// modes. Lines are collected in a reusable buffer, which is written out once
+// it reaches the threshold, after every line if line buffered, and on flush
+class Output {
+public:
+  static constexpr size_t defaultThreshold = 1 << 16;
+
+  static Output &get();
+
+  Output(const Output &) = delete;
+  Output &operator=(const Output &) = delete;
+
+  void setLineBuffered(bool flag) noexcept { lineBuffered = flag; }
+  // SIZE_MAX keeps everything until the output is flushed
+  void setThreshold(size_t bytes) noexcept { threshold = bytes; }
+
+  void writeLine(std::string_view line);
+  // Formats the value in place, without allocating
+  void writeLine(int64_t value);
+  void flush();
+
+private:
+  Output();
+  ~Output();
+
+  void endLine();
+
+  std::string buffer;
+  size_t threshold{defaultThreshold};
+  bool lineBuffered{false};
+};
+
+} // namespace prsl::Utils
@@ -1,3 +1,4 @@
+#include "prsl/Compiler/Cache/DiskCache.hpp"
 #include "prsl/Compiler/Compiler.hpp"
 #include "prsl/Compiler/CompilerFlags.hpp"
 #include <config.hpp>
@@ -29,10 +30,28 @@ int main(int argc, char *argv[]) {
     ("parse", "run the parser & semantics stage")
     ("codegen", "produce LLVM IR for given code")
     ("interpret", "interpret given code (default)")
-    (",O", po::value<int>()->value_name("<level>"), "Optimization level. [O0, O1, O2, O3]")
+    ("vm", "compile given code to bytecode and run it on the virtual machine")
+    ("jit", "compile given code to native code in memory and run it")
+    ("lazy", "compile each function on its first call in JIT mode")
+    ("tiered", "interpret given code, compiling hot functions to native code")
+    ("flush", po::value<std::string>()->value_name("<policy>"), "When the output of programs run in process is written out: after every line if stdout is a terminal, else when the buffer is full (auto), after every line (line), when the buffer is full (size), or once the program ends (exit). [auto]")
+    ("lex-threads", po::value<unsigned>()->value_name("<count>"), "Number of threads the source is scanned on. [1, or all the hardware has for sources of 4 MiB and larger]")
+    ("input-file", po::value<std::string>()->value_name("<file>"), "Read the input of programs run in process from the file instead of stdin")
+    ("tier-threshold", po::value<unsigned>()->value_name("<count>"), "Calls and loop iterations after which a function is compiled in tiered mode. [1000]")
+    ("tier-stats", "Print function counters and tier-up events after a tiered run")
+    ("cache-dir", po::value<std::string>()->value_name("<dir>"), "Reuse files compiled and native code generated in JIT and tiered modes by earlier runs, keeping them in the directory")
+    ("cache-size", po::value<unsigned>()->value_name("<MiB>"), "Size the cache directory may grow to before least recently used entries are evicted. [64]")
+    ("cache-stats", "Print cache hits, misses and evictions after the run, or the cache contents if no file is given")
+    (",O", po::value<int>()->value_name("<level>"), "Optimization level. From O1 on, constants are folded, code that never runs is removed and calls of small functions are inlined before any mode runs the program, from O2 on, variables assigned a constant once are replaced with it. The IR the virtual machine and LLVM IR are generated from gets copies propagated and values numbered from O1 on, loop invariants hoisted from O2 on. [O0, O1, O2, O3]")
+    ("inline-budget", po::value<unsigned>()->value_name("<nodes>"), "Size of the functions whose calls are replaced with their bodies from O1 on, 0 to inline none. [16 at O1, 40 at O2, 80 at O3]")
+    ("dump-ast", "Print the program after the optimizations of the optimization level")
+    ("dump-ir", "Print the IR of the program after the passes of the optimization level")
     ("filetype", po::value<std::string>()->value_name("<type>"), "Set type of output file. [asm, bc, obj, ll]")
     ("reloc", po::value<std::string>()->value_name("<model>"), "Set relocation model. [default, static, pic]")
     ("target", po::value<std::string>()->value_name("<triple>"), "Target triple for cross compilation.")
+    ("mcpu", po::value<std::string>()->value_name("<cpu>"), "Target CPU, 'native' for the host CPU. [generic]")
+    ("mattr", po::value<std::string>()->value_name("<features>"), "Target features, e.g. '+avx2,-sse4.2', 'native' for the ones of the host CPU")
+    ("multiversion", "Compile functions for the x86-64-v2, v3 and v4 levels as well, picking the best one the running CPU supports")
     ("no-diagnostics-color", "Do not colorize diagnostics")
     (",o", po::value<std::string>()->value_name("<filename>")->default_value("output"), "Name of the output file")
   ;
@@ -61,6 +80,18 @@ int main(int argc, char *argv[]) {
   conflicting_options(vm, "parse", "interpret");
   conflicting_options(vm, "parse", "codegen");
   conflicting_options(vm, "codegen", "interpret");
+  conflicting_options(vm, "parse", "vm");
+  conflicting_options(vm, "codegen", "vm");
+  conflicting_options(vm, "interpret", "vm");
+  conflicting_options(vm, "parse", "jit");
+  conflicting_options(vm, "codegen", "jit");
+  conflicting_options(vm, "interpret", "jit");
+  conflicting_options(vm, "vm", "jit");
+  conflicting_options(vm, "parse", "tiered");
+  conflicting_options(vm, "codegen", "tiered");
+  conflicting_options(vm, "interpret", "tiered");
+  conflicting_options(vm, "vm", "tiered");
+  conflicting_options(vm, "jit", "tiered");
 
   if (vm.count("help")) {
     std::cout << "OVERVIEW: " << PROJECT_NAME << " LLVM compiler\n"
@@ -128,6 +159,63 @@ int main(int argc, char *argv[]) {
     if (vm.count("target")) {
       flags->setTargetTriple(vm["target"].as<std::string>());
     }
+    if (vm.count("mcpu")) {
+      flags->setTargetCPU(vm["mcpu"].as<std::string>());
+    }
+    if (vm.count("mattr")) {
+      flags->setTargetFeatures(vm["mattr"].as<std::string>());
+    }
+    if (vm.count("multiversion")) {
+      flags->setMultiversioning(true);
+    }
+    if (vm.count("flush")) {
+      const auto &policy = vm["flush"].as<std::string>();
+      if (policy == "auto") {
+        flags->setFlushPolicy(prsl::Compiler::FlushPolicy::AUTO);
+      } else if (policy == "line") {
+        flags->setFlushPolicy(prsl::Compiler::FlushPolicy::LINE);
+      } else if (policy == "size") {
+        flags->setFlushPolicy(prsl::Compiler::FlushPolicy::SIZE);
+      } else if (policy == "exit") {
+        flags->setFlushPolicy(prsl::Compiler::FlushPolicy::EXIT);
+      } else {
+        logger.error(PROJECT_NAME, "unknown flush policy");
+        return EXIT_FAILURE;
+      }
+    }
+    if (vm.count("lex-threads")) {
+      flags->setLexThreads(vm["lex-threads"].as<unsigned>());
+    }
+    if (vm.count("input-file")) {
+      flags->setInputFile(vm["input-file"].as<std::string>());
+    }
+    if (vm.count("lazy")) {
+      flags->setLazyCompilation(true);
+    }
+    if (vm.count("tier-threshold")) {
+      flags->setTierThreshold(vm["tier-threshold"].as<unsigned>());
+    }
+    if (vm.count("tier-stats")) {
+      flags->setTierStats(true);
+    }
+    if (vm.count("cache-dir")) {
+      flags->setCacheDir(vm["cache-dir"].as<std::string>());
+    }
+    if (vm.count("cache-size")) {
+      flags->setCacheSizeLimit(uint64_t{vm["cache-size"].as<unsigned>()} << 20);
+    }
+    if (vm.count("cache-stats")) {
+      flags->setCacheStats(true);
+    }
+    if (vm.count("inline-budget")) {
+      flags->setInlineBudget(vm["inline-budget"].as<unsigned>());
+    }
+    if (vm.count("dump-ast")) {
+      flags->setDumpAST(true);
+    }
+    if (vm.count("dump-ir")) {
+      flags->setDumpIR(true);
+    }
 
     // Detect NO_COLOR=1 environment variable
     std::string noColorEnv = []() {
@@ -146,14 +234,29 @@ int main(int argc, char *argv[]) {
     }
 
     auto path = fs::path(vm["inputs"].as<std::string>());
-    flags->setExecutionMode(
-        vm.count("parse")
-            ? prsl::Compiler::ExecutionMode::PARSE
-            : (vm.count("codegen") ? prsl::Compiler::ExecutionMode::COMPILE
-                                   : prsl::Compiler::ExecutionMode::INTERPRET));
+    if (vm.count("parse")) {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::PARSE);
+    } else if (vm.count("codegen")) {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::COMPILE);
+    } else if (vm.count("vm")) {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::VM);
+    } else if (vm.count("jit")) {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::JIT);
+    } else if (vm.count("tiered")) {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::TIERED);
+    } else {
+      flags->setExecutionMode(prsl::Compiler::ExecutionMode::INTERPRET);
+    }
 
     auto compiler = std::make_unique<prsl::Compiler::Compiler>(logger, flags.get());
     compiler->run(path);
+  } else if (vm.count("cache-dir") && vm.count("cache-stats")) {
+    // Without an input file just the contents of the cache are reported
+    uint64_t limit = prsl::Compiler::CompilerFlags().getCacheSizeLimit();
+    if (vm.count("cache-size"))
+      limit = uint64_t{vm["cache-size"].as<unsigned>()} << 20;
+    prsl::Cache::DiskCache cache(vm["cache-dir"].as<std::string>(), limit);
+    cache.report(std::cout);
   } else {
     logger.error(PROJECT_NAME, "no input file");
     return EXIT_FAILURE;